@@ -13,6 +13,7 @@
 #include <WiFi.h>
 
 #include <rui3_at.h> // Click to install library: http://librarymanager/All#RUI3-Arduino-Library
+#include <rui3_p2p_rx.h>
 
 /** Wake up events, more events can be defined in app.h */
 #define NO_EVENT 0
@@ -24,6 +25,12 @@
 /** Communication instance for RAK3172 */
 RUI3 wisduo(Serial1);
 
+/** Keeps the RAK3172 in P2P RX */
+RUI3P2PReceiver p2p_rx(wisduo);
+
+/** Received P2P packets */
+RUI3PacketPool rx_pool;
+
 /** Semaphore used by events to wake up loop task */
 SemaphoreHandle_t g_task_sem = NULL;
 
@@ -47,8 +54,6 @@ uint32_t send_repeat_time = 30000;
 #define P2P_PRLEN 8
 #define P2P_PWR 22
 
-/** Buffer for outgoing AT commands */
-char com_buff[64];
 /** For statistics - number of send packets */
 uint32_t send_counter = 1;
 /** For statistics - number of received packets */
@@ -181,10 +186,8 @@ void setup()
 
 	Serial.println("===========================================");
 	Serial.println("Enable continuous RX with TX enabled");
-	sprintf(com_buff, "AT+PRECV=65533\r\n"); // Want to send AT command
-	wisduo.sendRawCommand(com_buff);
-	wisduo.recvResponse(5000);
-	if (strstr(wisduo.ret, "OK") != NULL)
+	p2p_rx.setPool(&rx_pool);
+	if (p2p_rx.begin(P2P_RX_PERMANENT_TX))
 	{
 		Serial.printf("P2P RX setup\r\n");
 	}
@@ -237,72 +240,29 @@ void loop()
 			g_task_event_type &= N_AT_CMD;
 			// Check what arrived on Serial1
 			wisduo.recvRX(60000);
-			if (strstr(wisduo.ret, "+EVT:RX") != NULL)
+			// RX events are decoded directly into the packet pool
+			if (p2p_rx.event(wisduo.ret))
 			{
-				// Switch on blue LED to show we are receiving
-				digitalWrite(LED_BUILTIN, HIGH);
-				int rx_rssi = 0;
-				int rx_snr = 0;
-				uint8_t rx_data[512] = {0};
-				uint16_t rx_data_len = 0;
-
-				Serial.printf("RX!\r\n");
-				// Parse received RX data
-				// +EVT:RXP2P:-112:1:1234
-				char *data_buff = strtok(wisduo.ret, ":"); // +EVT
-				if (data_buff != NULL)
+				p2p_packet *packet;
+				while ((packet = rx_pool.receive()) != NULL)
 				{
-					data_buff = strtok(NULL, ":"); // RXP2P
-					if (data_buff != NULL)
+					// Switch on blue LED to show we are receiving
+					digitalWrite(LED_BUILTIN, HIGH);
+					// Print out RX packet info
+					Serial.println("===========================================");
+					Serial.printf("RSSI: %d\r\n", packet->rssi);
+					Serial.printf("SNR:  %d\r\n", packet->snr);
+					Serial.printf("DATA: ");
+					for (int idx = 0; idx < packet->len; idx++)
 					{
-						data_buff = strtok(NULL, ":"); // RSSI
-						if (data_buff != NULL)
-						{
-							// get RSSI
-							rx_rssi = strtol(data_buff, NULL, 0);
-
-							// Get next value
-							data_buff = strtok(NULL, ":"); // SNR
-							if (data_buff != NULL)
-							{
-								// get SNR
-								rx_snr = strtol(data_buff, NULL, 0);
-							}
-
-							// Get next value
-							data_buff = strtok(NULL, ":"); // data
-							if (data_buff != NULL)
-							{
-								// get packet data length
-								while (data_buff[rx_data_len] != '\r')
-								{
-									rx_data_len++;
-								}
-								// Serial.printf("RX data length = %d\r\n", rx_data_len);
-								wisduo.asciiArrayToByte((char *)rx_data, data_buff, 512, rx_data_len);
-
-								// Print out RX packet info
-								Serial.println("===========================================");
-								Serial.printf("RSSI: %d\r\n", rx_rssi);
-								Serial.printf("SNR:  %d\r\n", rx_snr);
-								Serial.printf("DATA: ");
-								for (int idx = 0; idx < rx_data_len / 2; idx++)
-								{
-									Serial.printf("%02X", rx_data[idx]);
-								}
-								Serial.println("");
-								rx_counter++;
-							}
-						}
+						Serial.printf("%02X", packet->data[idx]);
 					}
+					Serial.println("");
+					rx_counter++;
+					rx_pool.release(packet);
+					// Switch off blue LED to show we are finished parsing RX data
+					digitalWrite(LED_BUILTIN, LOW);
 				}
-				else
-				{
-					Serial.println("Received from WisDuo:");
-					Serial.printf("%s\r\n", wisduo.ret);
-				}
-				// Switch off blue LED to show we are finished parsing RX data
-				digitalWrite(LED_BUILTIN, LOW);
 			}
 			else
 			{
@@ -322,10 +282,12 @@ void loop()
 			// Send a packet
 			if (wisduo.sendP2PData(tx_buffer))
 			{
-				// Wait for TX finished or error
+				// Wait for TX finished or error, timeout is calculated from the time-on-air
 				Serial.println("Wait for TX result");
-				if (wisduo.recvResponse(60000))
+				if (wisduo.waitTxDone())
 				{
+					// Follow the RX state from the TX done event
+					p2p_rx.event(wisduo.ret);
 					Serial.printf("TX success\r\n");
 					Serial.printf("<< %s\r\n", wisduo.ret);
 					send_counter++;
@@ -341,39 +303,12 @@ void loop()
 				Serial.printf("Response: %s\r\n", wisduo.ret);
 			}
 
-			// Check if we are in RX mode
-			sprintf(com_buff, "AT+PRECV=?\r\n"); // Want to send AT command
-			wisduo.sendRawCommand(com_buff);
-			wisduo.recvResponse(5000);
-			if (strstr(wisduo.ret, "P2P_RX_ON") != NULL)
+			// Start RX again only if the module left RX
+			if (!p2p_rx.rearm())
 			{
-				Serial.printf("P2P RX still active\r\n");
-			}
-			else
-			{
-				sprintf(com_buff, "AT+PRECV=0\r\n"); // Want to send AT command
-				wisduo.sendRawCommand(com_buff);
-				wisduo.recvResponse(5000);
-				if (strstr(wisduo.ret, "OK") != NULL)
-				{
-					Serial.printf("P2P RX stopped\r\n");
-				}
-				else
-				{
-					Serial.printf("Response:\r\n>>>\r\n%s\r\n<<<\r\n", wisduo.ret);
-				}
-				sprintf(com_buff, "AT+PRECV=65533\r\n"); // Want to send AT command
-				wisduo.sendRawCommand(com_buff);
-				wisduo.recvResponse(5000);
-				if (strstr(wisduo.ret, "OK") != NULL)
-				{
-					Serial.printf("P2P RX started\r\n");
-				}
-				else
-				{
-					Serial.printf("Response:\r\n>>>\r\n%s\r\n<<<\r\n", wisduo.ret);
-				}
+				Serial.printf("Response:\r\n>>>\r\n%s\r\n<<<\r\n", wisduo.ret);
 			}
+			Serial.printf("P2P RX restarts %ld, not needed %ld\r\n", p2p_rx.rearms(), p2p_rx.saved());
 			// Clear eventual events coming from the UART callback
 			g_task_event_type = NO_EVENT;
 		}
@@ -298,9 +298,9 @@ void loop()
 	// Send a packet
 	if (wisduo.sendP2PData(buffer))
 	{
-		// Wait for TX finished or error
+		// Wait for TX finished or error, timeout is calculated from the time-on-air
 		Serial.println("Wait for TX result");
-		if (wisduo.recvResponse(60000))
+		if (wisduo.waitTxDone())
 		{
 			Serial.printf("TX success\r\n");
 			send_counter++;
@@ -0,0 +1,62 @@
+/**
+ * @file Arduino.h
+ * @author Bernd Giesecke (bernd@giesecke.tk)
+ * @brief Minimal Arduino API for the host test of the heap free mode
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ * @copyright Copyright (c) 2026
+ *
+ * Only what the library uses. There is no String, with RUI3_NO_HEAP=1 the library must not need it.
+ */
+#ifndef _ARDUINO_H_
+#define _ARDUINO_H_
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <math.h>
+
+unsigned long millis(void);
+unsigned long micros(void);
+void delay(unsigned long ms);
+void yield(void);
+long random(long max);
+long random(long min, long max);
+void randomSeed(unsigned long seed);
+
+class Print
+{
+public:
+	virtual size_t write(uint8_t c) = 0;
+	size_t write(const uint8_t *buffer, size_t size);
+	size_t print(const char *str);
+	size_t println(const char *str = "");
+	size_t printf(const char *format, ...) __attribute__((format(printf, 2, 3)));
+	void flush(void) {}
+	virtual ~Print() {}
+};
+
+class Stream : public Print
+{
+public:
+	virtual int available(void) = 0;
+	virtual int read(void) = 0;
+	virtual int peek(void) = 0;
+	void setTimeout(unsigned long timeout) {}
+};
+
+class HardwareSerial : public Stream
+{
+public:
+	size_t write(uint8_t c) { return 1; }
+	int available(void) { return 0; }
+	int read(void) { return -1; }
+	int peek(void) { return -1; }
+};
+
+extern HardwareSerial Serial;
+
+#endif // _ARDUINO_H_
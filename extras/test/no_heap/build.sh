@@ -0,0 +1,12 @@
+#!/bin/sh
+# Host test of the heap free mode, builds the library with RUI3_NO_HEAP=1 and runs the test
+# Usage: extras/test/no_heap/build.sh [compiler]
+set -e
+TEST_DIR=$(cd "$(dirname "$0")" && pwd)
+SRC_DIR="$TEST_DIR/../../../src"
+CXX=${1:-g++}
+OUT=${TMPDIR:-/tmp}/rui3_no_heap_test
+$CXX -std=gnu++11 -Wall -DRUI3_NO_HEAP=1 -I"$TEST_DIR" -I"$SRC_DIR" \
+	-Wl,--wrap=malloc,--wrap=calloc,--wrap=realloc \
+	-o "$OUT" "$TEST_DIR/no_heap_test.cpp" "$SRC_DIR"/*.cpp
+"$OUT"
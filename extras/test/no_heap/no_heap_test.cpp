@@ -0,0 +1,343 @@
+/**
+ * @file no_heap_test.cpp
+ * @author Bernd Giesecke (bernd@giesecke.tk)
+ * @brief Host test, the library must not allocate memory with RUI3_NO_HEAP=1
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ * @copyright Copyright (c) 2026
+ *
+ * malloc, calloc and realloc are wrapped by the linker (-Wl,--wrap=...), new is replaced.
+ * A simulated WisDuo module answers the AT commands, the test counts all allocations while the library runs.
+ * Build and run with build.sh.
+ */
+#include <Arduino.h>
+#include <stdarg.h>
+#include <new>
+#include "rui3_at.h"
+#include "rui3_rx.h"
+#include "rui3_airtime.h"
+#include "rui3_uplink.h"
+#include "rui3_p2p_rx.h"
+#include "rui3_p2p_pool.h"
+#include "rui3_link.h"
+
+/** Allocations while the library runs */
+static volatile uint32_t allocations = 0;
+
+/** True while the library runs */
+static volatile bool counting = false;
+
+extern "C"
+{
+	void *__real_malloc(size_t size);
+	void *__real_calloc(size_t num, size_t size);
+	void *__real_realloc(void *ptr, size_t size);
+
+	void *__wrap_malloc(size_t size)
+	{
+		if (counting)
+		{
+			allocations++;
+		}
+		return __real_malloc(size);
+	}
+
+	void *__wrap_calloc(size_t num, size_t size)
+	{
+		if (counting)
+		{
+			allocations++;
+		}
+		return __real_calloc(num, size);
+	}
+
+	void *__wrap_realloc(void *ptr, size_t size)
+	{
+		if (counting)
+		{
+			allocations++;
+		}
+		return __real_realloc(ptr, size);
+	}
+}
+
+void *operator new(size_t size)
+{
+	if (counting)
+	{
+		allocations++;
+	}
+	void *ptr = __real_malloc(size);
+	if (ptr == NULL)
+	{
+		throw std::bad_alloc();
+	}
+	return ptr;
+}
+
+void *operator new[](size_t size)
+{
+	return operator new(size);
+}
+
+void operator delete(void *ptr) noexcept
+{
+	free(ptr);
+}
+
+void operator delete[](void *ptr) noexcept
+{
+	free(ptr);
+}
+
+/** Time of the host test, advances only with delay() */
+static unsigned long test_ms = 0;
+
+unsigned long millis(void)
+{
+	return test_ms;
+}
+
+unsigned long micros(void)
+{
+	return test_ms * 1000;
+}
+
+void delay(unsigned long ms)
+{
+	test_ms += ms;
+}
+
+void yield(void)
+{
+	test_ms++;
+}
+
+long random(long max)
+{
+	return max > 0 ? rand() % max : 0;
+}
+
+long random(long min, long max)
+{
+	return min + random(max - min);
+}
+
+void randomSeed(unsigned long seed)
+{
+	srand(seed);
+}
+
+size_t Print::write(const uint8_t *buffer, size_t size)
+{
+	for (size_t idx = 0; idx < size; idx++)
+	{
+		write(buffer[idx]);
+	}
+	return size;
+}
+
+size_t Print::print(const char *str)
+{
+	return write((const uint8_t *)str, strlen(str));
+}
+
+size_t Print::println(const char *str)
+{
+	return print(str) + print("\r\n");
+}
+
+size_t Print::printf(const char *format, ...)
+{
+	char buffer[256];
+	va_list args;
+	va_start(args, format);
+	int len = vsnprintf(buffer, sizeof(buffer), format, args);
+	va_end(args);
+	if (len < 0)
+	{
+		return 0;
+	}
+	return write((const uint8_t *)buffer, strlen(buffer));
+}
+
+HardwareSerial Serial;
+
+/**
+ * @brief Simulated WisDuo module, answers queries from a table and all other commands with OK
+ */
+class TestModule : public Stream
+{
+public:
+	size_t write(uint8_t c)
+	{
+		if ((c == '\r') || (c == '\n'))
+		{
+			if (_cmd_len != 0)
+			{
+				_cmd[_cmd_len] = 0;
+				answer();
+			}
+			_cmd_len = 0;
+			return 1;
+		}
+		if (_cmd_len < sizeof(_cmd) - 1)
+		{
+			_cmd[_cmd_len++] = c;
+		}
+		return 1;
+	}
+
+	int available(void)
+	{
+		return _out_len - _out_pos;
+	}
+
+	int read(void)
+	{
+		if (_out_pos >= _out_len)
+		{
+			return -1;
+		}
+		return (uint8_t)_out[_out_pos++];
+	}
+
+	int peek(void)
+	{
+		if (_out_pos >= _out_len)
+		{
+			return -1;
+		}
+		return (uint8_t)_out[_out_pos];
+	}
+
+	/**
+	 * @brief Send an event line, e.g. a received packet
+	 *
+	 * @param line event without line end
+	 */
+	void event(const char *line)
+	{
+		out(line);
+		out("\r\n");
+	}
+
+private:
+	void out(const char *str)
+	{
+		if (_out_pos == _out_len)
+		{
+			_out_pos = _out_len = 0;
+		}
+		size_t len = strlen(str);
+		if (_out_len + len < sizeof(_out))
+		{
+			memcpy(&_out[_out_len], str, len);
+			_out_len += len;
+		}
+	}
+
+	void answer(void)
+	{
+		static const char *const queries[][2] = {
+			{"AT+BAND=?", "AT+BAND=4"},
+			{"AT+DR=?", "AT+DR=3"},
+			{"AT+CFM=?", "AT+CFM=0"},
+			{"AT+NJS=?", "AT+NJS=1"},
+			{"AT+NWM=?", "AT+NWM=0"},
+			{"AT+P2P=?", "AT+P2P=916100000:7:0:1:8:22"},
+			{"AT+MASK=?", "AT+MASK=0002"},
+			{"AT+TXP=?", "AT+TXP=7"},
+		};
+		for (size_t idx = 0; idx < sizeof(queries) / sizeof(queries[0]); idx++)
+		{
+			if (strcasecmp(_cmd, queries[idx][0]) == 0)
+			{
+				out(queries[idx][1]);
+				out("\r\n");
+				break;
+			}
+		}
+		out("OK\r\n");
+	}
+
+	char _cmd[600];
+	size_t _cmd_len = 0;
+	char _out[2048];
+	size_t _out_len = 0;
+	size_t _out_pos = 0;
+};
+
+static uint32_t handled = 0;
+
+static void packet_handler(const rx_packet &packet)
+{
+	handled++;
+}
+
+int main(void)
+{
+	TestModule module;
+	RUI3 wisduo(module, module);
+	RUI3Uplink uplink(wisduo);
+	RUI3P2PReceiver receiver(wisduo);
+	RUI3PacketPool pool;
+	RUI3LinkQuality link;
+
+	counting = true;
+
+	// LoRaWAN
+	wisduo.setRegion(4);
+	wisduo.getRegion();
+	wisduo.getDataRate();
+	wisduo.initOTAA("AC1F09FFFE000000", "AC1F09FFFE000000", "EFADFF0000004829ACF71E1A6E000000");
+	wisduo.initABP("01360085", "616a6b21d7fcb25012d62b38a5829725", "f55a71bcc94ec6498511007c64a06c02");
+	char list[64];
+	wisduo.getChannelList(list, sizeof(list));
+	at_tuple p2p;
+	wisduo.query("P2P", p2p);
+	wisduo.set("TXP", 7);
+	uint8_t payload[] = {0x01, 0x02, 0x03, 0x04};
+	wisduo.sendData(2, payload, sizeof(payload));
+	uplink.begin();
+	uplink.send(2, payload, sizeof(payload));
+	for (uint8_t idx = 0; idx < 10; idx++)
+	{
+		uplink.loop();
+		delay(1000);
+	}
+	timeOnAir(4, 3, 51);
+
+	// LoRa P2P
+	p2p_settings settings = {916100000, 7, 0, 1, 8, 22};
+	wisduo.initP2P(&settings);
+	wisduo.setP2PFrequency(916300000);
+	wisduo.sendP2PData(payload, sizeof(payload));
+	receiver.setHandler(packet_handler);
+	receiver.begin();
+	module.event("+EVT:RXP2P:-80:5:01020304");
+	receiver.loop();
+	receiver.setPool(&pool);
+	module.event("+EVT:RXP2P:-81:6:0102030405");
+	receiver.loop();
+	p2p_packet *packet = pool.receive();
+	if (packet != NULL)
+	{
+		link.add(1, packet->rssi, packet->snr, 1);
+		pool.release(packet);
+	}
+	link_stats stats;
+	link.stats(1, stats);
+
+	counting = false;
+
+	printf("%u allocations, %u packets handled\n", (unsigned)allocations, (unsigned)handled);
+	if (allocations != 0)
+	{
+		printf("FAILED: the library allocated memory\n");
+		return 1;
+	}
+	printf("PASSED\n");
+	return 0;
+}
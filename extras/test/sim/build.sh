@@ -0,0 +1,17 @@
+#!/bin/sh
+# Host simulation tests with simulated WisDuo modules, builds each test with the library and runs it
+# Usage: extras/test/sim/build.sh [compiler] [test, e.g. uplink]
+set -e
+TEST_DIR=$(cd "$(dirname "$0")" && pwd)
+SRC_DIR="$TEST_DIR/../../../src"
+CXX=${1:-g++}
+for TEST in "$TEST_DIR"/${2:-*}_test.cpp
+do
+	NAME=$(basename "$TEST" .cpp)
+	OUT=${TMPDIR:-/tmp}/rui3_$NAME
+	echo "$NAME"
+	# The Arduino API of the heap free test, it has no String
+	$CXX -std=gnu++11 -Wall -O2 -DRUI3_NO_HEAP=1 -I"$TEST_DIR" -I"$TEST_DIR/../no_heap" -I"$SRC_DIR" \
+		-o "$OUT" "$TEST" "$SRC_DIR"/*.cpp
+	"$OUT"
+done
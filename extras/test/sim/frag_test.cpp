@@ -0,0 +1,161 @@
+/**
+ * @file frag_test.cpp
+ * @author Bernd Giesecke (bernd@giesecke.tk)
+ * @brief Host test, P2P transfer between two simulated modules with lost fragments and lost NACKs
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ * @copyright Copyright (c) 2026
+ *
+ * 5000 bytes are sent with SF7/125 kHz. The goodput and the efficiency are measured with a random packet loss
+ * of 0%, 10% and 30% in both directions. The final NACK is lost once, the sender repeats the last fragment and the
+ * receiver answers it with the final NACK again. Without a receiver the sender fails after P2P_FRAG_RETRIES
+ * NACK timeouts.
+ * Build and run with build.sh.
+ */
+#include "sim.h"
+#include "rui3_p2p_frag.h"
+
+/** Data length */
+#define DATA_LEN 5000
+
+/** Max test time of one transfer in milliseconds */
+#define TRANSFER_TIME 600000
+
+static SimP2PModule module_tx;
+static SimP2PModule module_rx;
+static RUI3 wisduo_tx(module_tx, module_tx);
+static RUI3 wisduo_rx(module_rx, module_rx);
+static RUI3P2PTransfer sender(wisduo_tx);
+static RUI3P2PTransfer receiver(wisduo_rx);
+
+static uint8_t data[DATA_LEN];
+static uint8_t rx_buffer[8192];
+
+/** Final NACKs to lose */
+static uint8_t lose_final = 0;
+
+/** Final NACKs lost */
+static uint8_t lost_final = 0;
+
+static bool drop_final_nack(const sim_tx &tx)
+{
+	// NACK: type, ID, number of fragments, bitmap without missing fragments
+	if ((lose_final == 0) || (strncasecmp(tx.hex, "DA", 2) != 0) || (strspn(&tx.hex[6], "0") != strlen(&tx.hex[6])))
+	{
+		return false;
+	}
+	lose_final--;
+	lost_final++;
+	return true;
+}
+
+/**
+ * @brief Run one transfer
+ *
+ * @param receiver_on false to run without receiver
+ * @return uint8_t status of the sender
+ */
+static uint8_t transfer(bool receiver_on)
+{
+	receiver.listen(rx_buffer, sizeof(rx_buffer));
+	memset(rx_buffer, 0, sizeof(rx_buffer));
+	sender.send(data, sizeof(data));
+	uint32_t start = millis();
+	while (((sender.status() == P2P_FRAG_SENDING) || (sender.status() == P2P_FRAG_WAITING)) &&
+		   (millis() - start < TRANSFER_TIME))
+	{
+		sender.loop();
+		if (receiver_on)
+		{
+			receiver.loop();
+		}
+		delay(1);
+	}
+	// The receiver reads the last events, e.g. the TX done of the final NACK
+	for (uint16_t idx = 0; receiver_on && (idx < 1000); idx++)
+	{
+		receiver.loop();
+		delay(1);
+	}
+	return sender.status();
+}
+
+/**
+ * @brief Print the statistics of the last transfer
+ *
+ * @param name name of the test
+ */
+static void report(const char *name)
+{
+	p2p_transfer_stats stats = sender.stats();
+	printf("%-14s %6lu ms %6lu ms %4u %4u %3u %3u %8.1f %8.1f %6.1f%%\n", name, (unsigned long)stats.elapsed,
+		   (unsigned long)(stats.airtime / 1000), stats.fragments, stats.retransmits, stats.rounds, stats.timeouts,
+		   sender.goodput(), stats.airtime == 0 ? 0.0 : stats.len * 1000000.0 / stats.airtime, sender.efficiency());
+}
+
+int main(void)
+{
+	srand(1);
+	for (uint16_t idx = 0; idx < DATA_LEN; idx++)
+	{
+		data[idx] = idx * 7 + 3;
+	}
+	if (!sender.begin() || !receiver.begin())
+	{
+		printf("FAILED: begin\n");
+		return 1;
+	}
+	bool failed = false;
+	printf("%-14s %9s %9s %4s %4s %3s %3s %8s %8s %7s\n", "test", "elapsed", "airtime", "frag", "retx", "rnd", "to",
+		   "B/s", "B/s air", "eff");
+
+	// Random loss of fragments and NACKs
+	const uint8_t losses[] = {0, 10, 30};
+	for (uint8_t idx = 0; idx < sizeof(losses); idx++)
+	{
+		char name[16];
+		snprintf(name, sizeof(name), "loss %u%%", losses[idx]);
+		sim_radio.loss = losses[idx];
+		uint8_t status = transfer(true);
+		report(name);
+		if ((status != P2P_FRAG_DONE) || (receiver.available() != DATA_LEN) || (memcmp(rx_buffer, data, DATA_LEN) != 0))
+		{
+			printf("FAILED: %s, status %u, %lu bytes received\n", name, status, (unsigned long)receiver.available());
+			failed = true;
+		}
+	}
+	sim_radio.loss = 0;
+
+	// Lost final NACK, the receiver answers the repeated last fragment of the complete transfer
+	lose_final = 1;
+	lost_final = 0;
+	sim_radio.drop = drop_final_nack;
+	uint8_t status = transfer(true);
+	sim_radio.drop = NULL;
+	report("final NACK");
+	if ((status != P2P_FRAG_DONE) || (lost_final != 1) || (sender.stats().timeouts != 1) ||
+		(receiver.available() != DATA_LEN) || (memcmp(rx_buffer, data, DATA_LEN) != 0))
+	{
+		printf("FAILED: lost final NACK, status %u, %u timeouts\n", status, sender.stats().timeouts);
+		failed = true;
+	}
+
+	// No receiver, the sender gives up
+	uint32_t start = millis();
+	status = transfer(false);
+	report("no receiver");
+	printf("Failed after %lu ms\n", (unsigned long)(millis() - start));
+	if ((status != P2P_FRAG_FAILED) || (sender.stats().timeouts != P2P_FRAG_RETRIES + 1))
+	{
+		printf("FAILED: no receiver, status %u, %u timeouts\n", status, sender.stats().timeouts);
+		failed = true;
+	}
+
+	if (failed)
+	{
+		return 1;
+	}
+	printf("PASSED\n");
+	return 0;
+}
@@ -0,0 +1,237 @@
+/**
+ * @file hop_test.cpp
+ * @author Bernd Giesecke (bernd@giesecke.tk)
+ * @brief Host test, frequency hopping between two simulated modules with a jammed channel and a drifting clock
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ * @copyright Copyright (c) 2026
+ *
+ * Master and follower hop over 5 channels with SF7/125 kHz, one channel is jammed by a narrowband interferer. The
+ * master sends 40 bytes in the even slots, the follower 20 bytes in the odd slots of the master time. The clock of the follower starts with an offset
+ * and runs fast. The test checks the initial lock of the follower, the throughput and loss, the quarter-step
+ * correction after a step of the follower clock and the resync after P2P_HOP_SYNC_CYCLES cycles without the master.
+ * Build and run with build.sh.
+ */
+#include "sim.h"
+#include "rui3_p2p_hop.h"
+
+/** Number of channels */
+#define CHANNELS 5
+
+/** Traffic test time in milliseconds */
+#define TRAFFIC_TIME 120000
+
+/** Clock drift of the follower in ppm */
+#define DRIFT_PPM 1000
+
+/** Step of the follower clock in milliseconds, less than half a dwell time */
+#define CLOCK_STEP 40
+
+/** Master packets recorded after the clock step */
+#define STEP_PACKETS 12
+
+static SimP2PModule module_master;
+static SimP2PModule module_follower;
+static RUI3 wisduo_master(module_master, module_master);
+static RUI3 wisduo_follower(module_follower, module_follower);
+static RUI3P2PHopper master(wisduo_master);
+static RUI3P2PHopper follower(wisduo_follower);
+
+static const uint32_t channels[CHANNELS] = {916100000, 916300000, 916500000, 916700000, 916900000};
+
+static uint8_t payload[40] = {0};
+
+/** Clock offset of the follower without the drift */
+static uint32_t follower_offset = 123457;
+
+/** Timing errors of the follower after the clock step */
+static int32_t step_error[STEP_PACKETS];
+
+/** Number of recorded timing errors, STEP_PACKETS to stop recording */
+static uint8_t step_errors = STEP_PACKETS;
+
+static void follower_rx(const rx_packet &packet)
+{
+	if (step_errors < STEP_PACKETS)
+	{
+		step_error[step_errors++] = follower.timingError();
+	}
+}
+
+/**
+ * @brief Clock of the follower, runs DRIFT_PPM fast
+ *
+ * @return unsigned long offset of the follower clock in milliseconds
+ */
+static unsigned long follower_skew(void)
+{
+	return follower_offset + (uint64_t)sim_ms * DRIFT_PPM / 1000000;
+}
+
+/**
+ * @brief Run both ends
+ *
+ * @param time run time in milliseconds
+ * @param master_on false to stop the master
+ * @param until stop early when the follower reaches this sync state, e.g. to measure the lock time
+ * @return uint32_t run time in milliseconds
+ */
+static uint32_t run(uint32_t time, bool master_on, int8_t until = -1)
+{
+	uint32_t start = sim_ms;
+	uint32_t dwell = master.getDwell();
+	while ((sim_ms - start < time) && ((until < 0) || (follower.synced() != (until == 1))))
+	{
+		// Queued at the start of a slot, the packet is sent in the same slot
+		bool queue = (sim_ms % dwell) < dwell / 4;
+		bool even = ((sim_ms / dwell) % 2) == 0;
+		if (master_on)
+		{
+			master.loop();
+			if (queue && even)
+			{
+				master.send(payload, 40);
+			}
+		}
+		sim_skew = follower_skew();
+		follower.loop();
+		if (queue && !even && follower.synced())
+		{
+			follower.send(payload, 20);
+		}
+		sim_skew = 0;
+		delay(1);
+	}
+	return sim_ms - start;
+}
+
+/**
+ * @brief Run the traffic test and print the throughput and the loss
+ *
+ * @param name name of the test
+ * @param jam_freq jammed frequency, 0 for none
+ * @param loss_max max loss in percent
+ * @return true Loss below loss_max, no resync and timing error within the guard time
+ */
+static bool traffic(const char *name, uint32_t jam_freq, float loss_max)
+{
+	p2p_hop_stats master_start = master.stats();
+	p2p_hop_stats follower_start = follower.stats();
+	int32_t error_max = 0;
+	sim_radio.jam_freq = jam_freq;
+	for (uint32_t time = 0; time < TRAFFIC_TIME; time += 100)
+	{
+		run(100, true);
+		if (follower.stats().received == follower_start.received)
+		{
+			// Error of the last lock
+			continue;
+		}
+		int32_t error = follower.timingError() < 0 ? -follower.timingError() : follower.timingError();
+		error_max = error > error_max ? error : error_max;
+	}
+	sim_radio.jam_freq = 0;
+	p2p_hop_stats m = master.stats();
+	p2p_hop_stats f = follower.stats();
+	uint32_t m_sent = m.sent - master_start.sent;
+	uint32_t f_sent = f.sent - follower_start.sent;
+	uint32_t m_received = m.received - master_start.received;
+	uint32_t f_received = f.received - follower_start.received;
+	float loss_mf = m_sent == 0 ? 100.0 : 100.0 * (m_sent - f_received) / m_sent;
+	float loss_fm = f_sent == 0 ? 100.0 : 100.0 * (f_sent - m_received) / f_sent;
+	printf("%-7s master -> follower %lu/%lu loss %.1f%%, follower -> master %lu/%lu loss %.1f%%\n", name,
+		   (unsigned long)f_received, (unsigned long)m_sent, loss_mf, (unsigned long)m_received, (unsigned long)f_sent,
+		   loss_fm);
+	printf("%-7s %.2f packets/s, %.0f bytes/s, deferred %lu, late %lu, max timing error %ld ms\n", name,
+		   (m_received + f_received) * 1000.0 / TRAFFIC_TIME, (f_received * 40 + m_received * 20) * 1000.0 / TRAFFIC_TIME,
+		   (unsigned long)(m.deferred - master_start.deferred + f.deferred - follower_start.deferred),
+		   (unsigned long)(m.late - master_start.late + f.late - follower_start.late), (long)error_max);
+	if ((loss_mf > loss_max) || (loss_fm > loss_max) || (f.resyncs != follower_start.resyncs) ||
+		(error_max > P2P_HOP_GUARD))
+	{
+		printf("FAILED: %s, %lu resyncs\n", name, (unsigned long)(f.resyncs - follower_start.resyncs));
+		return false;
+	}
+	return true;
+}
+
+int main(void)
+{
+	srand(1);
+	bool failed = false;
+	follower.setHandler(follower_rx);
+	delay(12345);
+	sim_skew = 0;
+	bool started = master.begin(channels, CHANNELS, 0xCAFE, true);
+	delay(777);
+	sim_skew = follower_skew();
+	started = started && follower.begin(channels, CHANNELS, 0xCAFE, false);
+	sim_skew = 0;
+	if (!started)
+	{
+		printf("FAILED: begin\n");
+		return 1;
+	}
+	uint32_t dwell = master.getDwell();
+	uint32_t cycle = CHANNELS * dwell;
+	printf("Dwell %lu ms, cycle %lu ms\n", (unsigned long)dwell, (unsigned long)cycle);
+
+	// Initial lock, the master sends on the first channel in every second cycle
+	uint32_t lock = run(4 * cycle, true, 1);
+	printf("Lock after %lu ms, error %ld ms\n", (unsigned long)lock, (long)follower.timingError());
+	if (!follower.synced() || (lock > 3 * cycle))
+	{
+		printf("FAILED: no lock\n");
+		failed = true;
+	}
+
+	// Traffic with a drifting follower clock, without and with a jammed channel
+	failed = !traffic("clear", 0, 5) || failed;
+	failed = !traffic("jammed", channels[2], 30) || failed;
+
+	// Step of the follower clock, the error is corrected by a quarter with each packet of the master
+	follower_offset += CLOCK_STEP;
+	step_errors = 0;
+	run(60000, true);
+	printf("Clock step %d ms, errors", CLOCK_STEP);
+	for (uint8_t idx = 0; idx < step_errors; idx++)
+	{
+		printf(" %ld", (long)step_error[idx]);
+	}
+	printf("\n");
+	if ((step_errors != STEP_PACKETS) || (step_error[0] > -CLOCK_STEP * 3 / 4) ||
+		(step_error[STEP_PACKETS - 1] < -CLOCK_STEP / 4) || (follower.stats().resyncs != 0))
+	{
+		printf("FAILED: clock step not corrected\n");
+		failed = true;
+	}
+
+	// The master is silent, the follower falls back to the first channel
+	uint32_t lost = run(2 * P2P_HOP_SYNC_CYCLES * cycle, false, 0);
+	printf("Master lost after %lu ms, %u cycles of %lu ms\n", (unsigned long)lost, P2P_HOP_SYNC_CYCLES,
+		   (unsigned long)cycle);
+	if (follower.synced() || (follower.stats().resyncs != 1) || (lost < P2P_HOP_SYNC_CYCLES * cycle) ||
+		(lost > P2P_HOP_SYNC_CYCLES * cycle + 2 * dwell) || (follower.frequency() != channels[0]))
+	{
+		printf("FAILED: no resync\n");
+		failed = true;
+	}
+	uint32_t relock = run(4 * cycle, true, 1);
+	p2p_hop_stats before = follower.stats();
+	run(10000, true);
+	printf("Lock again after %lu ms, follower received %lu packets in 10 s\n", (unsigned long)relock,
+		   (unsigned long)(follower.stats().received - before.received));
+	if (!follower.synced() || (relock > 3 * cycle) || (follower.stats().received == before.received))
+	{
+		printf("FAILED: no lock after resync\n");
+		failed = true;
+	}
+
+	if (failed)
+	{
+		return 1;
+	}
+	printf("PASSED\n");
+	return 0;
+}
@@ -0,0 +1,161 @@
+/**
+ * @file lbt_test.cpp
+ * @author Bernd Giesecke (bernd@giesecke.tk)
+ * @brief Host test, delivered packets per second of many P2P nodes with and without listen-before-talk
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ * @copyright Copyright (c) 2026
+ *
+ * 1 to 40 nodes send 20 bytes with SF7/125 kHz every 1 to 3 seconds to one gateway in permanent RX. Each node count
+ * runs once with RUI3LBT and once without CAD (ALOHA), a new packet is queued only after the last one is sent or
+ * dropped. The CAD of the simulated module detects every packet that started before its own TX start. The nodes
+ * share one clock, the command flush is disabled so a node waits only for the OK of its own command.
+ * Build and run with build.sh.
+ */
+#include "sim.h"
+#include "rui3_lbt.h"
+
+/** Test time of one node count in milliseconds */
+#define TEST_TIME 60000
+
+/** Max number of nodes */
+#define NODES_MAX 40
+
+/** Payload length */
+#define PAYLOAD_LEN 20
+
+/** Gateway, receives all packets */
+static SimP2PModule gateway;
+
+/** One node */
+struct Node
+{
+	Node(void) : wisduo(module, module), lbt(wisduo) {}
+	SimP2PModule module;
+	RUI3 wisduo;
+	RUI3LBT lbt;
+	uint32_t next = 0;
+};
+
+/** Result of one node count */
+typedef struct _round_result
+{
+	uint32_t queued;   // Packets queued by the nodes
+	uint32_t sent;	   // Packets sent, LBT only
+	uint32_t failed;   // Packets dropped after LBT_MAX_ATTEMPTS attempts, LBT only
+	uint32_t attempts; // TX attempts, LBT only
+	uint32_t busy;	   // Attempts with a busy channel, LBT only
+	uint32_t received; // Packets received by the gateway
+	float busy_ratio;  // Average busy ratio of the nodes in percent, LBT only
+} round_result;
+
+static uint8_t payload[PAYLOAD_LEN] = {0};
+
+/**
+ * @brief Run one node count
+ *
+ * @param num number of nodes
+ * @param lbt true to send with RUI3LBT, false to send without CAD
+ * @return round_result packets of the node count
+ */
+static round_result run(uint8_t num, bool lbt)
+{
+	round_result result;
+	memset(&result, 0, sizeof(result));
+	// The nodes are attached to the radio for this round only
+	Node nodes[NODES_MAX];
+	sim_radio.reset();
+	gateway.packets = 0;
+	uint32_t start = millis();
+	for (uint8_t idx = 0; idx < num; idx++)
+	{
+		// All nodes share one clock, a node waiting for a response stops the others
+		nodes[idx].wisduo.setCmdFlush(false);
+		if (lbt)
+		{
+			nodes[idx].lbt.begin();
+		}
+		nodes[idx].next = start + random(3000);
+	}
+	while (millis() - start < TEST_TIME)
+	{
+		for (uint8_t idx = 0; idx < num; idx++)
+		{
+			Node &node = nodes[idx];
+			bool ready;
+			if (lbt)
+			{
+				node.lbt.loop();
+				ready = (node.lbt.status() != LBT_BACKOFF) && (node.lbt.status() != LBT_TX);
+			}
+			else
+			{
+				while (node.wisduo.pollLine())
+				{
+				}
+				ready = (int32_t)(millis() - node.module.tx_end) >= 0;
+			}
+			if (ready && ((int32_t)(millis() - node.next) >= 0))
+			{
+				payload[0] = idx;
+				if (lbt ? node.lbt.send(payload, sizeof(payload)) : node.wisduo.sendP2PData(payload, sizeof(payload)))
+				{
+					result.queued++;
+				}
+				node.next = millis() + 1000 + random(2000);
+			}
+		}
+		delay(1);
+	}
+	// Let the last packets end
+	for (uint16_t idx = 0; idx < 1000; idx++)
+	{
+		delay(1);
+	}
+	result.received = gateway.packets;
+	for (uint8_t idx = 0; lbt && (idx < num); idx++)
+	{
+		lbt_stats stats = nodes[idx].lbt.stats();
+		result.sent += stats.sent;
+		result.failed += stats.failed;
+		result.attempts += stats.attempts;
+		result.busy += stats.busy;
+		result.busy_ratio += nodes[idx].lbt.busyRatio() / num;
+	}
+	return result;
+}
+
+int main(void)
+{
+	srand(1);
+	gateway.rx = P2P_RX_PERMANENT;
+	bool failed = false;
+	printf("%5s %6s %7s %7s %7s %7s %7s %6s %7s\n", "nodes", "ALOHA", "LBT", "queued", "failed", "attempt", "busy",
+		   "ratio", "gain");
+	const uint8_t counts[] = {1, 5, 10, 20, 40};
+	for (uint8_t idx = 0; idx < sizeof(counts); idx++)
+	{
+		round_result aloha = run(counts[idx], false);
+		round_result lbt = run(counts[idx], true);
+		float aloha_rate = aloha.received * 1000.0 / TEST_TIME;
+		float lbt_rate = lbt.received * 1000.0 / TEST_TIME;
+		printf("%5u %6.2f %7.2f %7lu %7lu %7lu %7lu %5.1f%% %6.0f%%\n", counts[idx], aloha_rate, lbt_rate,
+			   (unsigned long)lbt.queued, (unsigned long)lbt.failed, (unsigned long)lbt.attempts, (unsigned long)lbt.busy,
+			   lbt.busy_ratio, aloha_rate == 0 ? 0.0 : (lbt_rate / aloha_rate - 1) * 100);
+		// A single node is never blocked, with more nodes LBT delivers at least as many packets as ALOHA
+		if ((lbt.received == 0) || ((counts[idx] == 1) && ((lbt.busy != 0) || (lbt.received != lbt.queued))) ||
+			((counts[idx] > 1) && (lbt.received < aloha.received)))
+		{
+			printf("FAILED: %u nodes, %lu packets with LBT, %lu without\n", counts[idx], (unsigned long)lbt.received,
+				   (unsigned long)aloha.received);
+			failed = true;
+		}
+	}
+	if (failed)
+	{
+		return 1;
+	}
+	printf("PASSED\n");
+	return 0;
+}
@@ -0,0 +1,723 @@
+/**
+ * @file sim.h
+ * @author Bernd Giesecke (bernd@giesecke.tk)
+ * @brief Simulated WisDuo modules and radio channel for the host simulation tests
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ * @copyright Copyright (c) 2026
+ *
+ * Defines the Arduino functions of the host tests, include it only in the test source.
+ * The time advances only with delay() and yield(), all modules share one clock. The clock of the node that runs
+ * can be shifted with sim_skew.
+ * A module answers a command after its command latency. A P2P packet starts when the module accepted AT+PSEND
+ * and is received by all modules that are in RX on the same frequency for the whole packet. Packets that overlap
+ * on the same frequency are lost, a jammed frequency and a random loss rate simulate interference.
+ */
+#ifndef _SIM_H_
+#define _SIM_H_
+#include <Arduino.h>
+#include <stdarg.h>
+#include <strings.h>
+#include "rui3_at.h"
+#include "rui3_airtime.h"
+
+/** Max number of simulated P2P modules */
+#define SIM_MAX_MODULES 48
+
+/** Max number of pending output lines of a module */
+#define SIM_MAX_EVENTS 16
+
+/** Max length of an output line */
+#define SIM_LINE_LEN 560
+
+/** Number of packets kept for the collision check */
+#define SIM_MAX_TX 128
+
+/** Event of a busy channel, same text as LBT_BUSY_EVENT */
+#define SIM_BUSY_EVENT "+EVT:CAD ACTIVITY"
+
+/** Time of the host test, advances only with delay() and yield() */
+static unsigned long sim_ms = 0;
+
+/** Offset of millis() and micros() in milliseconds, set before the library of one node runs to simulate its clock, the modules use sim_ms */
+static unsigned long sim_skew = 0;
+
+/** Called while the library waits, moves the simulation forward */
+static void sim_update(void);
+
+unsigned long millis(void)
+{
+	return sim_ms + sim_skew;
+}
+
+unsigned long micros(void)
+{
+	return (sim_ms + sim_skew) * 1000;
+}
+
+void delay(unsigned long ms)
+{
+	sim_ms += ms;
+}
+
+void yield(void)
+{
+	sim_ms++;
+}
+
+long random(long max)
+{
+	return max > 0 ? rand() % max : 0;
+}
+
+long random(long min, long max)
+{
+	return min + random(max - min);
+}
+
+void randomSeed(unsigned long seed)
+{
+	srand(seed);
+}
+
+size_t Print::write(const uint8_t *buffer, size_t size)
+{
+	for (size_t idx = 0; idx < size; idx++)
+	{
+		write(buffer[idx]);
+	}
+	return size;
+}
+
+size_t Print::print(const char *str)
+{
+	return write((const uint8_t *)str, strlen(str));
+}
+
+size_t Print::println(const char *str)
+{
+	return print(str) + print("\r\n");
+}
+
+size_t Print::printf(const char *format, ...)
+{
+	char buffer[256];
+	va_list args;
+	va_start(args, format);
+	int len = vsnprintf(buffer, sizeof(buffer), format, args);
+	va_end(args);
+	if (len < 0)
+	{
+		return 0;
+	}
+	return write((const uint8_t *)buffer, strlen(buffer));
+}
+
+HardwareSerial Serial;
+
+/**
+ * @brief Check a command
+ *
+ * @param cmd command without line end
+ * @param prefix command prefix, e.g. "AT+PSEND="
+ * @return const char* argument after the prefix, NULL if the command has another prefix
+ */
+static const char *sim_arg(const char *cmd, const char *prefix)
+{
+	size_t len = strlen(prefix);
+	return strncasecmp(cmd, prefix, len) == 0 ? cmd + len : NULL;
+}
+
+/**
+ * @brief Simulated WisDuo module, answers all commands with OK after the command latency
+ */
+class SimModule : public Stream
+{
+public:
+	size_t write(uint8_t c)
+	{
+		if ((c == '\r') || (c == '\n'))
+		{
+			if (_cmd_len != 0)
+			{
+				_cmd[_cmd_len] = 0;
+				commands++;
+				command(_cmd);
+			}
+			_cmd_len = 0;
+			return 1;
+		}
+		if (_cmd_len < sizeof(_cmd) - 1)
+		{
+			_cmd[_cmd_len++] = c;
+		}
+		return 1;
+	}
+
+	int available(void)
+	{
+		poll();
+		return _out_len - _out_pos;
+	}
+
+	int read(void)
+	{
+		poll();
+		if (_out_pos >= _out_len)
+		{
+			return -1;
+		}
+		return (uint8_t)_out[_out_pos++];
+	}
+
+	int peek(void)
+	{
+		poll();
+		if (_out_pos >= _out_len)
+		{
+			return -1;
+		}
+		return (uint8_t)_out[_out_pos];
+	}
+
+	/**
+	 * @brief Send a line at a time
+	 *
+	 * @param at time in milliseconds
+	 * @param line line without line end
+	 */
+	void event(uint32_t at, const char *line)
+	{
+		if (_events == SIM_MAX_EVENTS)
+		{
+			dropped++;
+			return;
+		}
+		// Sorted by time, lines with the same time in the order they were added
+		uint8_t idx = _events;
+		while ((idx > 0) && ((int32_t)(_event[idx - 1].at - at) > 0))
+		{
+			_event[idx] = _event[idx - 1];
+			idx--;
+		}
+		_event[idx].at = at;
+		snprintf(_event[idx].line, SIM_LINE_LEN, "%s\r\n", line);
+		_events++;
+	}
+
+	/** Time from the command until the response in milliseconds */
+	uint32_t latency = 5;
+
+	/** Number of commands */
+	uint32_t commands = 0;
+
+	/** Output lines dropped because too many were pending */
+	uint32_t dropped = 0;
+
+protected:
+	/**
+	 * @brief Handle a command
+	 *
+	 * @param cmd command without line end
+	 */
+	virtual void command(const char *cmd)
+	{
+		reply("OK");
+	}
+
+	/**
+	 * @brief Send a response line after the command latency
+	 *
+	 * @param line line without line end
+	 */
+	void reply(const char *line)
+	{
+		event(sim_ms + latency, line);
+	}
+
+private:
+	/**
+	 * @brief Move the due lines into the output
+	 */
+	void poll(void)
+	{
+		sim_update();
+		if (_out_pos == _out_len)
+		{
+			_out_pos = _out_len = 0;
+		}
+		while ((_events != 0) && ((int32_t)(sim_ms - _event[0].at) >= 0))
+		{
+			size_t len = strlen(_event[0].line);
+			if (_out_len + len > sizeof(_out))
+			{
+				break;
+			}
+			memcpy(&_out[_out_len], _event[0].line, len);
+			_out_len += len;
+			_events--;
+			memmove(&_event[0], &_event[1], _events * sizeof(_event[0]));
+		}
+	}
+
+	char _cmd[600];
+	size_t _cmd_len = 0;
+	char _out[4096];
+	size_t _out_len = 0;
+	size_t _out_pos = 0;
+
+	struct
+	{
+		uint32_t at;
+		char line[SIM_LINE_LEN];
+	} _event[SIM_MAX_EVENTS];
+	uint8_t _events = 0;
+};
+
+class SimP2PModule;
+
+/** Packet on the air */
+typedef struct _sim_tx
+{
+	SimP2PModule *from;		   // Sender
+	uint32_t freq;			   // Frequency in Hz
+	uint32_t start;			   // TX start in milliseconds
+	uint32_t end;			   // TX end in milliseconds
+	bool done;				   // TX done and RX events sent
+	uint64_t listen;		   // Modules in RX on the frequency at the TX start, bit = module index
+	char hex[2 * 256 + 1];	   // Payload as hex string
+} sim_tx;
+
+/**
+ * @brief Radio channel shared by the simulated P2P modules
+ */
+class SimRadio
+{
+public:
+	/**
+	 * @brief Add a module
+	 *
+	 * @param module module
+	 */
+	void attach(SimP2PModule *module)
+	{
+		_module[_modules++] = module;
+	}
+
+	/**
+	 * @brief Remove a module, the packets on the air are forgotten because the module indexes change
+	 *
+	 * @param module module
+	 */
+	void detach(SimP2PModule *module)
+	{
+		for (uint8_t idx = 0; idx < _modules; idx++)
+		{
+			if (_module[idx] == module)
+			{
+				memmove(&_module[idx], &_module[idx + 1], (_modules - idx - 1) * sizeof(_module[0]));
+				_modules--;
+				break;
+			}
+		}
+		_num = 0;
+	}
+
+	/**
+	 * @brief Forget the packets on the air and clear the counters
+	 */
+	void reset(void)
+	{
+		_num = 0;
+		sent = collisions = lost = received = clean = 0;
+	}
+
+	/**
+	 * @brief Start a packet
+	 *
+	 * @param tx packet, from, freq, start, end and hex are set
+	 */
+	void send(const sim_tx &tx);
+
+	/**
+	 * @brief Check if a packet is on the air on a frequency
+	 *
+	 * @param freq frequency in Hz
+	 * @param at time in milliseconds
+	 * @return true Channel is busy
+	 */
+	bool busy(uint32_t freq, uint32_t at)
+	{
+		for (uint8_t idx = 0; idx < _num; idx++)
+		{
+			const sim_tx &tx = _tx[idx];
+			if ((tx.freq == freq) && ((int32_t)(at - tx.start) >= 0) && ((int32_t)(tx.end - at) > 0))
+			{
+				return true;
+			}
+		}
+		return false;
+	}
+
+	/**
+	 * @brief End the packets that are done, send TX done and RX events
+	 */
+	void update(void);
+
+	/** Jammed frequency, packets on it are lost, 0 for none */
+	uint32_t jam_freq = 0;
+
+	/** Random packet loss in percent */
+	uint8_t loss = 0;
+
+	/** Decide the loss of a packet for each receiver, e.g. to lose one type of packet, NULL for none */
+	bool (*drop)(const sim_tx &tx) = NULL;
+
+	/** Packets sent */
+	uint32_t sent = 0;
+
+	/** Packets lost by overlapping packets on the same frequency, counted per receiver */
+	uint32_t collisions = 0;
+
+	/** Packets lost by the jammed frequency or the random loss, counted per receiver */
+	uint32_t lost = 0;
+
+	/** Packets received, counted per receiver */
+	uint32_t received = 0;
+
+	/** Packets without any other packet on the same frequency at the same time */
+	uint32_t clean = 0;
+
+private:
+	SimP2PModule *_module[SIM_MAX_MODULES];
+	uint8_t _modules = 0;
+	sim_tx _tx[SIM_MAX_TX];
+	uint8_t _num = 0;
+};
+
+/** Radio channel of the test */
+static SimRadio sim_radio;
+
+/**
+ * @brief Simulated WisDuo module in LoRa P2P mode
+ */
+class SimP2PModule : public SimModule
+{
+public:
+	SimP2PModule(void)
+	{
+		sim_radio.attach(this);
+	}
+
+	~SimP2PModule(void)
+	{
+		sim_radio.detach(this);
+	}
+
+	/**
+	 * @brief Check if the module receives on a frequency
+	 *
+	 * @param at time in milliseconds
+	 * @param on_freq frequency in Hz
+	 * @return true Module is in RX on the frequency and does not send
+	 */
+	bool listens(uint32_t at, uint32_t on_freq)
+	{
+		return (rx != P2P_RX_OFF) && (freq == on_freq) && ((int32_t)(at - tx_end) >= 0);
+	}
+
+	/**
+	 * @brief Handle the end of an own packet
+	 */
+	void txDone(uint32_t at)
+	{
+		event(at, "+EVT:TXP2P DONE");
+		if (rx != P2P_RX_PERMANENT_TX)
+		{
+			rx = P2P_RX_OFF;
+		}
+	}
+
+	/**
+	 * @brief Handle a received packet
+	 */
+	void rxDone(uint32_t at, const char *hex)
+	{
+		// Room for the line end
+		char line[SIM_LINE_LEN - 2];
+		snprintf(line, sizeof(line), "+EVT:RXP2P:-70:8:%s", hex);
+		event(at, line);
+		packets++;
+		if ((rx != P2P_RX_PERMANENT_TX) && (rx != P2P_RX_PERMANENT))
+		{
+			rx = P2P_RX_OFF;
+		}
+	}
+
+	/** P2P settings */
+	p2p_settings settings = {916100000, 7, 0, 1, 8, 22};
+
+	/** Current frequency */
+	uint32_t freq = 916100000;
+
+	/** RX mode, P2P_RX_OFF if not in RX */
+	uint16_t rx = P2P_RX_OFF;
+
+	/** CAD before TX */
+	bool cad = false;
+
+	/** End of the current TX */
+	uint32_t tx_end = 0;
+
+	/** Packets received */
+	uint32_t packets = 0;
+
+	/** TX with busy channel */
+	uint32_t busy = 0;
+
+protected:
+	void command(const char *cmd)
+	{
+		const char *arg;
+		char line[64];
+		if (strcasecmp(cmd, "AT+P2P=?") == 0)
+		{
+			snprintf(line, sizeof(line), "AT+P2P=%lu:%u:%u:%u:%u:%u", (unsigned long)freq, settings.sf, settings.bw,
+					 settings.cr, settings.ppl, settings.txp);
+			reply(line);
+		}
+		else if ((arg = sim_arg(cmd, "AT+PFREQ=")) != NULL)
+		{
+			freq = strtoul(arg, NULL, 10);
+			settings.freq = freq;
+		}
+		else if ((arg = sim_arg(cmd, "AT+PSF=")) != NULL)
+		{
+			settings.sf = atoi(arg);
+		}
+		else if ((arg = sim_arg(cmd, "AT+PBW=")) != NULL)
+		{
+			settings.bw = atoi(arg) == 500 ? 2 : (atoi(arg) == 250 ? 1 : 0);
+		}
+		else if ((arg = sim_arg(cmd, "AT+PTP=")) != NULL)
+		{
+			settings.txp = atoi(arg);
+		}
+		else if ((arg = sim_arg(cmd, "AT+CAD=")) != NULL)
+		{
+			cad = atoi(arg) == 1;
+		}
+		else if ((arg = sim_arg(cmd, "AT+PRECV=")) != NULL)
+		{
+			rx = atoi(arg);
+		}
+		else if ((arg = sim_arg(cmd, "AT+PSEND=")) != NULL)
+		{
+			uint32_t start = sim_ms + latency;
+			if ((int32_t)(tx_end - start) > 0)
+			{
+				reply("AT_BUSY_ERROR");
+				return;
+			}
+			reply("OK");
+			if (cad && sim_radio.busy(freq, start))
+			{
+				// CAD takes a few symbols, the packet is not sent
+				busy++;
+				event(start + 5, SIM_BUSY_EVENT);
+				return;
+			}
+			sim_tx tx;
+			tx.from = this;
+			tx.freq = freq;
+			tx.start = start;
+			tx.end = start + timeOnAir(settings, strlen(arg) / 2) / 1000 + 1;
+			snprintf(tx.hex, sizeof(tx.hex), "%s", arg);
+			tx_end = tx.end;
+			sim_radio.send(tx);
+			return;
+		}
+		reply("OK");
+	}
+};
+
+void SimRadio::send(const sim_tx &tx)
+{
+	update();
+	if (_num == SIM_MAX_TX)
+	{
+		// Forget the oldest packet
+		memmove(&_tx[0], &_tx[1], (SIM_MAX_TX - 1) * sizeof(sim_tx));
+		_num--;
+	}
+	sim_tx &entry = _tx[_num++];
+	entry = tx;
+	entry.done = false;
+	entry.listen = 0;
+	for (uint8_t idx = 0; idx < _modules; idx++)
+	{
+		if ((_module[idx] != tx.from) && _module[idx]->listens(tx.start, tx.freq))
+		{
+			entry.listen |= (uint64_t)1 << idx;
+		}
+	}
+	sent++;
+}
+
+void SimRadio::update(void)
+{
+	uint32_t now = sim_ms;
+	for (uint8_t idx = 0; idx < _num; idx++)
+	{
+		sim_tx &tx = _tx[idx];
+		if (tx.done || ((int32_t)(now - tx.end) < 0))
+		{
+			continue;
+		}
+		tx.done = true;
+		tx.from->txDone(tx.end);
+		bool collision = false;
+		for (uint8_t other = 0; other < _num; other++)
+		{
+			if ((other != idx) && (_tx[other].freq == tx.freq) && ((int32_t)(_tx[other].end - tx.start) > 0) &&
+				((int32_t)(tx.end - _tx[other].start) > 0))
+			{
+				collision = true;
+			}
+		}
+		if (!collision)
+		{
+			clean++;
+		}
+		for (uint8_t rx = 0; rx < _modules; rx++)
+		{
+			// In RX from the start to the end of the packet, not sending in between
+			if (!(tx.listen & ((uint64_t)1 << rx)) || !_module[rx]->listens(tx.end, tx.freq) ||
+				((int32_t)(_module[rx]->tx_end - tx.start) > 0))
+			{
+				continue;
+			}
+			if (collision)
+			{
+				collisions++;
+			}
+			else if ((tx.freq == jam_freq) || ((int)random(100) < loss) || ((drop != NULL) && drop(tx)))
+			{
+				lost++;
+			}
+			else
+			{
+				received++;
+				_module[rx]->rxDone(tx.end, tx.hex);
+			}
+		}
+	}
+	// Keep the packets for the collision check until all packets that started before their end are done
+	while ((_num != 0) && _tx[0].done)
+	{
+		for (uint8_t idx = 1; idx < _num; idx++)
+		{
+			if (!_tx[idx].done && ((int32_t)(_tx[0].end - _tx[idx].start) > 0))
+			{
+				return;
+			}
+		}
+		memmove(&_tx[0], &_tx[1], (_num - 1) * sizeof(sim_tx));
+		_num--;
+	}
+}
+
+/**
+ * @brief Simulated WisDuo module in LoRaWAN mode, joined, ACK of confirmed uplinks decided by the test
+ */
+class SimLoRaWANModule : public SimModule
+{
+public:
+	/**
+	 * @brief Decide if a confirmed uplink is acknowledged
+	 *
+	 * @param port fPort of the uplink
+	 * @return true ACK received
+	 */
+	bool (*ack)(uint8_t port) = NULL;
+
+	/** Region */
+	uint8_t band = 4;
+
+	/** Datarate */
+	uint8_t dr = 5;
+
+	/** Confirmed uplinks */
+	bool confirmed = true;
+
+	/** Time from the end of the uplink until the end of the RX windows in milliseconds */
+	uint32_t rx_windows = 2000;
+
+	/** Uplinks sent */
+	uint32_t uplinks = 0;
+
+protected:
+	void command(const char *cmd)
+	{
+		const char *arg;
+		char line[32];
+		if (strcasecmp(cmd, "AT+BAND=?") == 0)
+		{
+			snprintf(line, sizeof(line), "AT+BAND=%u", band);
+			reply(line);
+		}
+		else if (strcasecmp(cmd, "AT+DR=?") == 0)
+		{
+			snprintf(line, sizeof(line), "AT+DR=%u", dr);
+			reply(line);
+		}
+		else if (strcasecmp(cmd, "AT+CFM=?") == 0)
+		{
+			snprintf(line, sizeof(line), "AT+CFM=%u", confirmed ? 1 : 0);
+			reply(line);
+		}
+		else if (strcasecmp(cmd, "AT+NJS=?") == 0)
+		{
+			reply("AT+NJS=1");
+		}
+		else if ((arg = sim_arg(cmd, "AT+DR=")) != NULL)
+		{
+			dr = atoi(arg);
+		}
+		else if ((arg = sim_arg(cmd, "AT+CFM=")) != NULL)
+		{
+			confirmed = atoi(arg) == 1;
+		}
+		else if ((arg = sim_arg(cmd, "AT+SEND=")) != NULL)
+		{
+			reply("OK");
+			uint8_t port = atoi(arg);
+			const char *hex = strchr(arg, ':');
+			uint16_t len = hex == NULL ? 0 : strlen(hex + 1) / 2;
+			uint32_t end = sim_ms + latency + timeOnAir(band, dr, len) / 1000 + 1 + rx_windows;
+			uplinks++;
+			if (!confirmed)
+			{
+				event(end, "+EVT:TX_DONE");
+			}
+			else if ((ack != NULL) && ack(port))
+			{
+				event(end, "+EVT:SEND_CONFIRMED_OK");
+			}
+			else
+			{
+				event(end, "+EVT:SEND_CONFIRMED_FAILED");
+			}
+			return;
+		}
+		reply("OK");
+	}
+};
+
+static void sim_update(void)
+{
+	sim_radio.update();
+}
+
+#endif // _SIM_H_
@@ -0,0 +1,122 @@
+/**
+ * @file uplink_test.cpp
+ * @author Bernd Giesecke (bernd@giesecke.tk)
+ * @brief Host test, alarms are sent during the retry backoff of a confirmed uplink
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ * @copyright Copyright (c) 2026
+ *
+ * Telemetry on fPort 1 is never acknowledged and is repeated with a backoff of 30 s to 120 s. Alarms on fPort 2
+ * are acknowledged and are queued at random times. An alarm waits at most for one active attempt of the telemetry,
+ * not for its retries. The telemetry frames still get all their attempts and datarates.
+ * Build and run with build.sh.
+ */
+#include "sim.h"
+#include "rui3_uplink.h"
+
+/** Test time in milliseconds */
+#define TEST_TIME 3600000
+
+/** Telemetry interval in milliseconds */
+#define TELEMETRY_INTERVAL 300000
+
+/** Max alarm latency, one attempt of the telemetry and one of the alarm, in milliseconds */
+#define ALARM_LATENCY_MAX 5000
+
+static SimLoRaWANModule module;
+static RUI3 wisduo(module, module);
+static RUI3Uplink uplink(wisduo);
+
+/** Telemetry frames finished */
+static uint32_t telemetry = 0;
+
+/** Telemetry frames with wrong attempts or datarates */
+static uint32_t telemetry_wrong = 0;
+
+/** True while a telemetry frame is active */
+static bool telemetry_active = false;
+
+/** Alarms finished while a telemetry frame was active */
+static uint32_t alarms_between = 0;
+
+static bool ack(uint8_t port)
+{
+	return port != 1;
+}
+
+static void uplink_done(const uplink_report &report)
+{
+	if (report.port == 1)
+	{
+		telemetry++;
+		telemetry_active = false;
+		// 4 attempts, the datarate is lowered after 2 failed attempts
+		if ((report.result != UPLINK_FAILED) || (report.attempts != 4) || (report.dr[0] != 5) || (report.dr[1] != 5) ||
+			(report.dr[2] != 4) || (report.dr[3] != 4))
+		{
+			printf("Telemetry %u: result %u, %u attempts, DR %u %u %u %u\n", report.seq, report.result, report.attempts,
+				   report.dr[0], report.dr[1], report.dr[2], report.dr[3]);
+			telemetry_wrong++;
+		}
+	}
+	else if (telemetry_active)
+	{
+		alarms_between++;
+	}
+}
+
+int main(void)
+{
+	srand(1);
+	module.ack = ack;
+	if (!uplink.begin())
+	{
+		printf("FAILED: begin\n");
+		return 1;
+	}
+	uplink_retry retry = {4, 30000, 120000, 2, 0};
+	uplink.setRetry(retry);
+	uplink.setCallback(uplink_done);
+
+	uint8_t payload[10] = {0};
+	uint32_t next_telemetry = 0;
+	uint32_t next_alarm = 10000;
+	while (millis() < TEST_TIME)
+	{
+		if ((int32_t)(millis() - next_telemetry) >= 0)
+		{
+			uplink.send(1, payload, sizeof(payload), UPLINK_PRIO_NORMAL, true);
+			telemetry_active = true;
+			next_telemetry += TELEMETRY_INTERVAL;
+		}
+		if ((int32_t)(millis() - next_alarm) >= 0)
+		{
+			uplink.send(2, payload, 2, UPLINK_PRIO_ALARM);
+			next_alarm += 20000 + random(40000);
+		}
+		uplink.loop();
+		delay(10);
+	}
+
+	const uplink_stats &alarms = uplink.stats(UPLINK_PRIO_ALARM);
+	printf("%lu uplinks, %lu telemetry frames, %lu alarms (%lu during telemetry retries)\n", (unsigned long)module.uplinks,
+		   (unsigned long)telemetry, (unsigned long)alarms.sent, (unsigned long)alarms_between);
+	if (alarms.sent != 0)
+	{
+		printf("Alarm latency min %lu mean %lu max %lu ms\n", (unsigned long)alarms.lat_min,
+			   (unsigned long)(alarms.lat_sum / alarms.sent), (unsigned long)alarms.lat_max);
+	}
+	if ((alarms.sent == 0) || (alarms.failed != 0) || (alarms_between == 0) || (alarms.lat_max > ALARM_LATENCY_MAX))
+	{
+		printf("FAILED: alarms wait for the telemetry retries\n");
+		return 1;
+	}
+	if ((telemetry == 0) || (telemetry_wrong != 0) || (module.dr != 5))
+	{
+		printf("FAILED: telemetry retries changed\n");
+		return 1;
+	}
+	printf("PASSED\n");
+	return 0;
+}
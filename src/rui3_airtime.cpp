@@ -0,0 +1,95 @@
+/**
+ * @file rui3_airtime.cpp
+ * @author Bernd Giesecke (bernd@giesecke.tk)
+ * @brief LoRa time-on-air calculation
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#include <Arduino.h>
+#include "rui3_at.h"
+#include "rui3_airtime.h"
+#include "rui3_no_heap.h"
+
+/** Bandwidths in Hz of the P2P bandwidth settings 0 to 9 */
+static const uint32_t p2p_bw_hz[] = {125000, 250000, 500000, 7812, 10417, 15625, 20833, 31250, 41667, 62500};
+
+uint32_t p2pBandwidthHz(uint16_t bw)
+{
+	if (bw < ARRAY_SIZE(p2p_bw_hz))
+	{
+		return p2p_bw_hz[bw];
+	}
+	switch (bw)
+	{
+	case 125:
+	case 250:
+	case 500:
+		return (uint32_t)bw * 1000;
+	default:
+		return 0;
+	}
+}
+
+uint32_t loraTimeOnAir(uint8_t sf, uint32_t bw_hz, uint8_t cr, uint16_t preamble, uint16_t len, bool crc, bool explicit_header)
+{
+	if ((sf < 5) || (sf > 12) || (bw_hz == 0) || (cr < 1) || (cr > 4))
+	{
+		return 0;
+	}
+	// Low data rate optimization is required if a symbol is 16.38 ms or longer
+	bool ldro = ((uint64_t)1000000 << sf) / bw_hz >= 16380;
+
+	// Payload bits that go into the symbols after the first 8
+	int32_t bits = 8 * (int32_t)len + (crc ? 16 : 0) - 4 * sf + (explicit_header ? 20 : 0);
+	// Preamble + sync word in quarter symbols
+	uint32_t quarter_symbols = 4 * (uint32_t)preamble;
+	if (sf < 7)
+	{
+		quarter_symbols += 25;
+	}
+	else
+	{
+		quarter_symbols += 17;
+		bits += 8;
+	}
+	// Header and first payload symbols
+	quarter_symbols += 4 * 8;
+	if (bits > 0)
+	{
+		uint8_t bits_per_block = 4 * (ldro ? sf - 2 : sf);
+		quarter_symbols += 4 * ((bits + bits_per_block - 1) / bits_per_block) * (cr + 4);
+	}
+	return ((uint64_t)quarter_symbols * 1000000 << sf) / (4 * (uint64_t)bw_hz);
+}
+
+uint32_t timeOnAir(const p2p_settings &settings, uint16_t len)
+{
+	return loraTimeOnAir(settings.sf, p2pBandwidthHz(settings.bw), settings.cr + 1, settings.ppl, len);
+}
+
+uint32_t fskTimeOnAir(uint32_t bitrate, uint16_t len)
+{
+	if (bitrate == 0)
+	{
+		return 0;
+	}
+	// 5 bytes preamble, 3 bytes sync word, length byte and 2 bytes CRC
+	return ((uint64_t)(len + 11) * 8 * 1000000) / bitrate;
+}
+
+uint32_t timeOnAir(uint8_t region, uint8_t dr, uint16_t len)
+{
+	if (regionMaxPayload(region, dr) == 0)
+	{
+		return 0;
+	}
+	len += LORAWAN_OVERHEAD;
+	if (regionSF(region, dr) == 0)
+	{
+		return fskTimeOnAir(LORAWAN_FSK_BITRATE, len);
+	}
+	return loraTimeOnAir(regionSF(region, dr), (uint32_t)regionBW(region, dr) * 1000, 1, LORAWAN_PREAMBLE, len);
+}
@@ -0,0 +1,108 @@
+/**
+ * @file rui3_airtime.h
+ * @author Bernd Giesecke (bernd@giesecke.tk)
+ * @brief LoRa time-on-air calculation
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ * @copyright Copyright (c) 2026
+ *
+ * Time-on-air formula of the SX126x datasheet, chapter 6.1.4, calculated with integer math only.
+ */
+#ifndef _RUI3_AIRTIME_H_
+#define _RUI3_AIRTIME_H_
+#include <stdint.h>
+
+struct _p2p_settings;
+
+/** LoRaWAN overhead on top of the application payload: MHDR, FHDR without FOpts, FPort and MIC */
+#define LORAWAN_OVERHEAD 13
+/** LoRaWAN preamble length in symbols */
+#define LORAWAN_PREAMBLE 8
+/** Bitrate of the LoRaWAN FSK datarate */
+#define LORAWAN_FSK_BITRATE 50000
+
+/**
+ * @brief Get the bandwidth in Hz from the P2P bandwidth setting
+ *
+ * ```cpp
+ * uint32_t p2pBandwidthHz(uint16_t bw);
+ * ```
+ * @param bw bandwidth 0=125kHz, 1=250kHz, 2=500kHz, 3=7.8kHz, 4=10.4kHz, 5=15.63kHz, 6=20.83kHz, 7=31.25kHz, 8=41.67kHz, 9=62.5kHz
+ * or the bandwidth in kHz (125, 250, 500)
+ * @return uint32_t bandwidth in Hz, 0 if the setting is invalid
+ */
+uint32_t p2pBandwidthHz(uint16_t bw);
+
+/**
+ * @brief Calculate the time-on-air of a LoRa packet
+ *
+ * ```cpp
+ * uint32_t loraTimeOnAir(uint8_t sf, uint32_t bw_hz, uint8_t cr, uint16_t preamble, uint16_t len, bool crc = true, bool explicit_header = true);
+ * ```
+ * @param sf spreading factor 5 - 12
+ * @param bw_hz bandwidth in Hz
+ * @param cr coding rate 1 = 4/5, 2 = 4/6, 3 = 4/7, 4 = 4/8
+ * @param preamble preamble length in symbols
+ * @param len payload length in bytes
+ * @param crc true if the payload CRC is enabled
+ * @param explicit_header true if the packet has an explicit header
+ * @return uint32_t time-on-air in microseconds, 0 if the parameters are invalid
+ */
+uint32_t loraTimeOnAir(uint8_t sf, uint32_t bw_hz, uint8_t cr, uint16_t preamble, uint16_t len, bool crc = true, bool explicit_header = true);
+
+/**
+ * @brief Calculate the time-on-air of a LoRa P2P packet
+ *
+ * ```cpp
+ * uint32_t timeOnAir(const p2p_settings &settings, uint16_t len);
+ * ```
+ * @param settings P2P settings, SF, BW, CR and preamble length are used
+ * @param len payload length in bytes
+ * @return uint32_t time-on-air in microseconds, 0 if the settings are invalid
+ *
+ * @par Usage
+ * @code
+ * p2p_settings p2p_sett = {916100000, 7, 0, 0, 8, 22};
+ * Serial.printf("10 bytes take %ld us\r\n", timeOnAir(p2p_sett, 10));
+ * @endcode
+ */
+uint32_t timeOnAir(const struct _p2p_settings &settings, uint16_t len);
+
+/**
+ * @brief Calculate the time-on-air of an FSK packet
+ * 5 bytes preamble, 3 bytes sync word, length byte and 2 bytes CRC are added to the payload
+ *
+ * ```cpp
+ * uint32_t fskTimeOnAir(uint32_t bitrate, uint16_t len);
+ * ```
+ * @param bitrate bitrate in b/s
+ * @param len payload length in bytes
+ * @return uint32_t time-on-air in microseconds, 0 if the bitrate is 0
+ *
+ * @par Usage
+ * @code
+ * Serial.printf("240 bytes at 50 kb/s take %ld us\r\n", fskTimeOnAir(50000, 240));
+ * @endcode
+ */
+uint32_t fskTimeOnAir(uint32_t bitrate, uint16_t len);
+
+/**
+ * @brief Calculate the time-on-air of a LoRaWAN uplink
+ *
+ * ```cpp
+ * uint32_t timeOnAir(uint8_t region, uint8_t dr, uint16_t len);
+ * ```
+ * @param region region 0 to 12, e.g. EU868
+ * @param dr datarate
+ * @param len application payload length in bytes, the LoRaWAN overhead is added
+ * @return uint32_t time-on-air in microseconds, 0 if the datarate is invalid or not LoRa or FSK
+ *
+ * @par Usage
+ * @code
+ * Serial.printf("10 bytes at DR0 take %ld us\r\n", timeOnAir(EU868, 0, 10));
+ * @endcode
+ */
+uint32_t timeOnAir(uint8_t region, uint8_t dr, uint16_t len);
+
+#endif // _RUI3_AIRTIME_H_
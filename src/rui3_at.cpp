@@ -10,6 +10,7 @@
  */
 #include <Arduino.h>
 #include "rui3_at.h"
+#include "rui3_no_heap.h"
 
 extern "C"
 {
@@ -17,226 +18,501 @@ extern "C"
 #include "stdlib.h"
 }
 
-char command[1024] = {0};
+char command[AT_CMD_BUFFER_LEN] = {0};
+
+/** Command descriptors, generated from RUI3_AT_COMMANDS */
+const at_cmd at_cmds[AT_CMD_NUM] = {
+#define AT_CMD_DESC(id, mnemonic, arg, resp, cls) {"at+" mnemonic, "at+" mnemonic "=?\r\n", sizeof("at+" mnemonic) - 1, arg, resp, cls},
+	RUI3_AT_COMMANDS(AT_CMD_DESC)
+#undef AT_CMD_DESC
+};
 
 /*
   @param serial Needs to be an already opened Stream ({Software/Hardware}Serial) to write to and read from.
 */
-RUI3::RUI3(Stream &serial1, Stream &serial) : _serial1(serial1), _serial(serial)
+RUI3::RUI3(Stream &serial1, Stream &serial) : _serial(serial), _serial1(serial1)
 {
 	/// \todo test if no need to set the timeouts
 	// _serial1.setTimeout(5000);
 	// _serial.setTimeout(5000);
+	for (uint8_t cls = 0; cls < AT_CLASS_NUM; cls++)
+	{
+		_rto[cls].srtt = 0;
+		_rto[cls].rttvar = 0;
+		_rto[cls].min_rto = AT_MIN_TIMEOUT;
+		_rto[cls].max_rto = AT_DEF_TIMEOUT;
+		_rto[cls].fixed = cls == AT_CLASS_FIXED ? AT_DEF_TIMEOUT : 0;
+		_rto[cls].backoff = 0;
+		_rto[cls].valid = false;
+	}
 }
 
-bool RUI3::getVersion()
+uint16_t RUI3::atPrefix(at_cmd_id cmd)
 {
-	snprintf(command, 1024, "at+ver=?\r\n");
+	memcpy(command, at_cmds[cmd].prefix, at_cmds[cmd].prefix_len);
+	command[at_cmds[cmd].prefix_len] = '=';
+	command[at_cmds[cmd].prefix_len + 1] = 0x00;
+	return at_cmds[cmd].prefix_len + 1;
+}
+
+bool RUI3::atSend(at_cmd_id cmd, uint16_t len)
+{
+	if (at_cmds[cmd].arg == AT_ARG_NONE)
+	{
+		// Drop the '=' again
+		len = at_cmds[cmd].prefix_len;
+	}
+	command[len++] = '\r';
+	command[len++] = '\n';
+	command[len] = 0x00;
 	return sendRawCommand(command);
 }
 
-bool RUI3::getJoinStatus(void)
+bool RUI3::atTransact(at_cmd_id cmd, uint16_t len)
+{
+	if (at_cmds[cmd].arg == AT_ARG_NONE)
+	{
+		// Drop the '=' again
+		len = at_cmds[cmd].prefix_len;
+	}
+	return rawTransact(len, at_cmds[cmd].cls);
+}
+
+bool RUI3::atExec(at_cmd_id cmd, const char *arg)
+{
+	uint16_t len = atPrefix(cmd);
+	if ((arg != NULL) && !cmdAppend(len, arg))
+	{
+		MYLOG(at_cmds[cmd].prefix + 3, "Parameter too long");
+		return false;
+	}
+	return atTransact(cmd, len);
+}
+
+bool RUI3::atExec(at_cmd_id cmd, int32_t value)
+{
+	uint16_t len = atPrefix(cmd);
+	if (!cmdAppendInt(len, value))
+	{
+		return false;
+	}
+	return atTransact(cmd, len);
+}
+
+char *RUI3::atQuery(at_cmd_id cmd)
+{
+	uint32_t timeout = rtoTimeout(AT_CLASS_QUERY);
+	sendRawCommand(at_cmds[cmd].query);
+	uint32_t start = millis();
+	recvCmdResponse(timeout);
+	rtoUpdate(AT_CLASS_QUERY, millis() - start);
+	MYLOG(at_cmds[cmd].prefix + 3, "<< %s", ret);
+	return respValue();
+}
+
+bool RUI3::atExecHex(at_cmd_id cmd, const uint8_t *data, uint16_t len)
+{
+	uint16_t cmd_len = atPrefix(cmd);
+	if (!cmdAppendHex(cmd_len, data, len))
+	{
+		MYLOG(at_cmds[cmd].prefix + 3, "Parameter too long");
+		return false;
+	}
+	return atTransact(cmd, cmd_len);
+}
+
+int32_t RUI3::atQueryValue(at_cmd_id cmd)
+{
+	char *str_ptr = atQuery(cmd);
+	if ((str_ptr == NULL) || (str_ptr[0] < ' '))
+	{
+		return -1;
+	}
+	switch (at_cmds[cmd].resp)
+	{
+	case AT_RESP_INT:
+		return strtol(str_ptr, NULL, 10);
+	case AT_RESP_HEX:
+		return strtoul(str_ptr, NULL, 16);
+	case AT_RESP_CHAR:
+		return str_ptr[0];
+	default:
+		return -1;
+	}
+}
+
+char *RUI3::cmdBuffer(void)
+{
+	return command;
+}
+
+bool RUI3::cmdAppend(uint16_t &len, const char *str)
+{
+	uint16_t str_len = strlen(str);
+	// Keep space for \r\n and the terminating 0
+	if (len + str_len > AT_CMD_BUFFER_LEN - 3)
+	{
+		return false;
+	}
+	memcpy(&command[len], str, str_len + 1);
+	len += str_len;
+	return true;
+}
+
+bool RUI3::cmdAppendInt(uint16_t &len, int32_t value)
 {
-	snprintf(command, 1024, "at+njs=?\r\n");
+	int16_t val_len = at_format_int(&command[len], AT_CMD_BUFFER_LEN - len - 2, value);
+	if (val_len < 0)
+	{
+		return false;
+	}
+	len += val_len;
+	return true;
+}
+
+bool RUI3::cmdAppendUint(uint16_t &len, uint32_t value)
+{
+	int16_t val_len = at_format_uint(&command[len], AT_CMD_BUFFER_LEN - len - 2, value);
+	if (val_len < 0)
+	{
+		return false;
+	}
+	len += val_len;
+	return true;
+}
+
+bool RUI3::cmdAppendHex(uint16_t &len, const uint8_t *data, uint16_t data_len)
+{
+	int16_t val_len = at_format_hex(&command[len], AT_CMD_BUFFER_LEN - len - 2, data, data_len);
+	if (val_len < 0)
+	{
+		return false;
+	}
+	len += val_len;
+	return true;
+}
+
+uint16_t RUI3::rawPrefix(const char *cmd)
+{
+	if (((cmd[0] == 'a') || (cmd[0] == 'A')) && ((cmd[1] == 't') || (cmd[1] == 'T')) && (cmd[2] == '+'))
+	{
+		cmd += 3;
+	}
+	uint16_t cmd_len = strlen(cmd);
+	if (cmd_len > MAX_CMD_LEN)
+	{
+		MYLOG("raw", "Command name too long");
+		return 0;
+	}
+	memcpy(command, "at+", 3);
+	memcpy(&command[3], cmd, cmd_len);
+	command[cmd_len + 3] = '=';
+	command[cmd_len + 4] = 0x00;
+	return cmd_len + 4;
+}
+
+bool RUI3::rawTransact(uint16_t len, uint8_t cls)
+{
+	command[len++] = '\r';
+	command[len++] = '\n';
+	command[len] = 0x00;
+	uint32_t timeout = rtoTimeout(cls);
 	sendRawCommand(command);
-	recvResponse();
-	MYLOG("NJS", "<< %s", ret);
-	if (strstr(ret, "AT+NJS=1") != NULL)
+	uint32_t start = millis();
+	recvCmdResponse(timeout);
+	rtoUpdate(cls, millis() - start);
+	MYLOG("raw", "<< %s", ret);
+	if (strstr(ret, "OK") != NULL)
 	{
 		return true;
 	}
 	return false;
 }
 
-String RUI3::getChannelList()
+char *RUI3::queryRaw(const char *cmd)
 {
-	snprintf(command, 1024, "at+mask=?\r\n");
+	uint16_t len = rawPrefix(cmd);
+	if (len == 0)
+	{
+		return NULL;
+	}
+	command[len++] = '?';
+	command[len++] = '\r';
+	command[len++] = '\n';
+	command[len] = 0x00;
+	uint32_t timeout = rtoTimeout(AT_CLASS_RAW);
 	sendRawCommand(command);
-	recvResponse();
-	MYLOG("MASK", "<< %s", ret);
+	uint32_t start = millis();
+	recvCmdResponse(timeout);
+	rtoUpdate(AT_CLASS_RAW, millis() - start);
+	MYLOG("raw", "<< %s", ret);
+	return respValue();
+}
+
+uint32_t RUI3::rtoTimeout(uint8_t cls)
+{
+	at_rto &rto = _rto[cls];
+	if (rto.fixed != 0)
+	{
+		return rto.fixed;
+	}
+	if (!rto.valid)
+	{
+		return rto.max_rto;
+	}
+	// Same as the TCP retransmission timeout: smoothed time + 4 * variation, doubled after each timeout
+	uint32_t timeout = ((rto.srtt >> 3) + rto.rttvar) << rto.backoff;
+	if (timeout < rto.min_rto)
+	{
+		return rto.min_rto;
+	}
+	if (timeout > rto.max_rto)
+	{
+		return rto.max_rto;
+	}
+	return timeout;
+}
+
+void RUI3::rtoUpdate(uint8_t cls, uint32_t elapsed)
+{
+	at_rto &rto = _rto[cls];
+	if (_resp_timeout)
+	{
+		// No sample from a timeout, only increase the next timeout
+		if (rto.backoff < 8)
+		{
+			rto.backoff++;
+		}
+		MYLOG("rto", "Class %d timeout, backoff %d", cls, rto.backoff);
+		return;
+	}
+	rto.backoff = 0;
+	if (!rto.valid)
+	{
+		rto.srtt = elapsed << 3;
+		rto.rttvar = elapsed << 1;
+		rto.valid = true;
+		return;
+	}
+	// srtt += (elapsed - srtt) / 8, rttvar += (|elapsed - srtt| - rttvar) / 4
+	int32_t err = (int32_t)elapsed - (int32_t)(rto.srtt >> 3);
+	rto.srtt += err;
+	if (err < 0)
+	{
+		err = -err;
+	}
+	rto.rttvar += err - (rto.rttvar >> 2);
+}
+
+void RUI3::setCmdTimeout(uint8_t cls, uint32_t timeout)
+{
+	if (cls < AT_CLASS_NUM)
+	{
+		_rto[cls].fixed = timeout;
+	}
+}
+
+void RUI3::setCmdTimeoutLimits(uint8_t cls, uint32_t min_timeout, uint32_t max_timeout)
+{
+	if ((cls < AT_CLASS_NUM) && (min_timeout <= max_timeout))
+	{
+		_rto[cls].min_rto = min_timeout;
+		_rto[cls].max_rto = max_timeout;
+	}
+}
+
+uint32_t RUI3::getCmdTimeout(uint8_t cls)
+{
+	if (cls >= AT_CLASS_NUM)
+	{
+		return 0;
+	}
+	return rtoTimeout(cls);
+}
+
+uint32_t RUI3::getCmdLatency(uint8_t cls)
+{
+	if ((cls >= AT_CLASS_NUM) || !_rto[cls].valid)
+	{
+		return 0;
+	}
+	return _rto[cls].srtt >> 3;
+}
+
+char *RUI3::respValue(void)
+{
+	char *str_ptr = strstr(ret, "=");
+	if (str_ptr != NULL)
+	{
+		return str_ptr + 1;
+	}
+	return NULL;
+}
+
+bool RUI3::set(const char *cmd, const char *value)
+{
+	uint16_t len = rawPrefix(cmd);
+	if (len == 0)
+	{
+		return false;
+	}
+	if (!cmdAppend(len, value))
+	{
+		return false;
+	}
+	return rawTransact(len);
+}
+
+bool RUI3::getVersion()
+{
+	return sendRawCommand(at_cmds[AT_CMD_VER].query);
+}
+
+bool RUI3::getJoinStatus(void)
+{
+	if (atQueryValue(AT_CMD_NJS) == 1)
+	{
+		return true;
+	}
+	return false;
+}
+
+#if RUI3_NO_HEAP == 0
+String RUI3::getChannelList()
+{
+	atQuery(AT_CMD_MASK);
 	String result = String(ret);
 	result.trim();
 	return result;
 }
+#endif
 
-bool RUI3::setDataRate(int rate)
+bool RUI3::getChannelList(char *list, uint16_t list_len)
 {
-	if ((rate < 0) || (rate > 15))
+	char *str_ptr = atQuery(AT_CMD_MASK);
+	if (str_ptr == NULL)
 	{
 		return false;
 	}
-	snprintf(command, 1024, "at+dr=%d\r\n", rate);
-	sendRawCommand(command);
-	recvResponse();
-	MYLOG("dr", "<< %s", ret);
-	if (strstr(ret, "OK") != NULL)
+	uint16_t len = 0;
+	while ((str_ptr[len] != '\r') && (str_ptr[len] != '\n') && (str_ptr[len] != 0x00))
 	{
-		return true;
+		len++;
 	}
-	else
+	if (len >= list_len)
 	{
 		return false;
 	}
+	memcpy(list, str_ptr, len);
+	list[len] = 0x00;
+	return true;
 }
 
-uint8_t RUI3::getDataRate(void)
+bool RUI3::getChannelMask(channel_mask &mask)
 {
-	snprintf(command, 1024, "at+dr=?\r\n");
-	sendRawCommand(command);
-	recvResponse();
-	MYLOG("dr?", "<< %s", ret);
-	char *str_ptr = strstr(ret, "=");
-	if (str_ptr != NULL)
+	char *str_ptr = atQuery(AT_CMD_MASK);
+	uint8_t mask_bytes[2];
+	if ((str_ptr == NULL) || (at_parse_hex(str_ptr, mask_bytes, 2) != 2))
 	{
-		uint8_t _dr = strtol(str_ptr + 1, NULL, 10);
-		if ((_dr >= 0) && (_dr <= 15))
-		{
-			return _dr;
-		}
+		return false;
 	}
-	return NO_RESPONSE;
+	mask.bits = (mask_bytes[0] << 8) | mask_bytes[1];
+	return true;
 }
 
-bool RUI3::setClass(int classMode)
+bool RUI3::setChannelMask(const channel_mask &mask)
 {
-	switch (classMode)
+	if (mask.bits == 0)
 	{
-	case 0:
-		snprintf(command, 1024, "at+class=a\r\n");
-		break;
-	case 1:
-		snprintf(command, 1024, "at+class=b\r\n");
-		break;
-	case 2:
-		snprintf(command, 1024, "at+class=c\r\n");
-		break;
-	default:
-		MYLOG("class", "Parameter error");
+		MYLOG("mask", "Parameter error");
 		return false;
-		break;
 	}
-	sendRawCommand(command);
-	recvResponse();
-	MYLOG("class","<< %s", ret);
-	if (strstr(ret, "OK") != NULL)
+	uint8_t mask_bytes[2] = {(uint8_t)(mask.bits >> 8), (uint8_t)mask.bits};
+	return atExecHex(AT_CMD_MASK, mask_bytes, 2);
+}
+
+bool RUI3::setSubBand(uint8_t sub_band)
+{
+	channel_mask mask;
+	mask.clear();
+	mask.enableSubBand(sub_band);
+	return setChannelMask(mask);
+}
+
+bool RUI3::setDataRate(int rate)
+{
+	if ((rate < 0) || (rate > 15))
 	{
-		return true;
+		return false;
 	}
-	else
+	if (!atExec(AT_CMD_DR, (int32_t)rate))
 	{
 		return false;
 	}
+	_dr = rate;
+	return true;
 }
 
-uint8_t RUI3::getClass(void)
+uint8_t RUI3::getDataRate(void)
 {
-	snprintf(command, 1024, "at+class=?\r\n");
-	sendRawCommand(command);
-	recvResponse();
-	MYLOG("class?","<< %s", ret);
-	char *str_ptr = strstr(ret, "=");
-	if (str_ptr != NULL)
+	int32_t dr = atQueryValue(AT_CMD_DR);
+	if ((dr >= 0) && (dr <= 15))
 	{
-		switch (str_ptr[1])
-		{
-		case 'A':
-			return 0;
-			break;
-		case 'B':
-			return 1;
-			break;
-		case 'C':
-			return 2;
-			break;
-		default:
-			return NO_RESPONSE;
-			break;
-		}
+		_dr = dr;
+		return dr;
 	}
 	return NO_RESPONSE;
 }
 
-bool RUI3::setRegion(int region)
+bool RUI3::setClass(int classMode)
 {
-	if (region > 12)
+	if ((classMode < 0) || (classMode > 2))
 	{
-		MYLOG("band","Parameter error");
+		MYLOG("class", "Parameter error");
 		return false;
 	}
-#if defined DEBUG_MODE
-	String REGION;
-	switch (region)
-	{
-	case 0:
-		REGION = "EU433";
-		break;
-	case 1:
-		REGION = "CN470";
-		break;
-	case 2:
-		REGION = "RU864";
-		break;
-	case 3:
-		REGION = "IN865";
-		break;
-	case 4:
-		REGION = "EU868";
-		break;
-	case 5:
-		REGION = "US915";
-		break;
-	case 6:
-		REGION = "AU915";
-		break;
-	case 7:
-		REGION = "KR920";
-		break;
-	case 8:
-		REGION = "AS923-1";
-		break;
-	case 9:
-		REGION = "AS923-2";
-		break;
-	case 10:
-		REGION = "AS923-3";
-		break;
-	case 11:
-		REGION = "AS923-4";
-		break;
-	case 12:
-		REGION = "LA915";
-		break;
-	}
-	Serial.println("Requested work region: " + REGION);
-#endif
-	snprintf(command, 1024, "at+band=%d\r\n", region);
-	sendRawCommand(command);
-	recvResponse();
-	MYLOG("band","<< %s", ret);
-	if (strstr(ret, "OK") != NULL)
+	char class_arg[2] = {"abc"[classMode], 0x00};
+	return atExec(AT_CMD_CLASS, class_arg);
+}
+
+uint8_t RUI3::getClass(void)
+{
+	switch (atQueryValue(AT_CMD_CLASS))
+	{
+	case 'A':
+		return 0;
+	case 'B':
+		return 1;
+	case 'C':
+		return 2;
+	default:
+		return NO_RESPONSE;
+	}
+}
+
+bool RUI3::setRegion(int region)
+{
+	if ((region < 0) || (region >= RUI3_NUM_REGIONS))
 	{
-		return true;
+		MYLOG("band","Parameter error");
+		return false;
 	}
-	else
+	MYLOG("band", "Requested work region: %s", regionParams(region)->name);
+	if (!atExec(AT_CMD_BAND, (int32_t)region))
 	{
 		return false;
 	}
+	_region = region;
+	return true;
 }
 
 uint8_t RUI3::getRegion(void)
 {
-	snprintf(command, 1024, "at+band=?\r\n");
-	sendRawCommand(command);
-	recvResponse();
-	MYLOG("band?","<< %s", ret);
-	char *str_ptr = strstr(ret, "=");
-	if (str_ptr != NULL)
+	int32_t region = atQueryValue(AT_CMD_BAND);
+	if ((region >= 0) && (region < RUI3_NUM_REGIONS))
 	{
-		uint8_t _region = strtol(str_ptr + 1, NULL, 10);
-		if ((_region >= 0) && (_region <= 12))
-		{
-			return _region;
-		}
+		_region = region;
+		return region;
 	}
 	return NO_RESPONSE;
 }
@@ -250,13 +526,19 @@ bool RUI3::sleep(int mode)
 	}
 	if (mode == 0)
 	{
-		snprintf(command, 1024, "at+sleep\r\n");
+		uint16_t len = at_cmds[AT_CMD_SLEEP].prefix_len;
+		memcpy(command, at_cmds[AT_CMD_SLEEP].prefix, len);
+		command[len++] = '\r';
+		command[len++] = '\n';
+		command[len] = 0x00;
+		sendRawCommand(command);
 	}
 	else
 	{
-		snprintf(command, 1024, "at+sleep=%d\r\n", mode);
+		uint16_t len = atPrefix(AT_CMD_SLEEP);
+		cmdAppendInt(len, mode);
+		atSend(AT_CMD_SLEEP, len);
 	}
-	sendRawCommand(command);
 	return true;
 }
 
@@ -267,33 +549,20 @@ bool RUI3::setLPM(int mode)
 		MYLOG("lpm","Parameter error");
 		return false;
 	}
-	snprintf(command, 1024, "at+lpm=%d\r\n", mode);
-	sendRawCommand(command);
-	recvResponse();
-	MYLOG("lpm","<< %s", ret);
-	if ((strstr(ret, "Initialization OK") != NULL) || (strstr(ret, "OK") != NULL))
-	{
-		return true;
-	}
-
-	return false;
+	return atExec(AT_CMD_LPM, (int32_t)mode);
 }
 
 uint8_t RUI3::getLPM(void)
 {
-	snprintf(command, 1024, "at+lpm=?\r\n");
-	sendRawCommand(command);
-	recvResponse();
-	MYLOG("lpm?","<< %s", ret);
-	if (strstr(ret, "AT+LPM=1") != NULL)
+	switch (atQueryValue(AT_CMD_LPM))
 	{
+	case 1:
 		return LPM_ON;
-	}
-	else if (strstr(ret, "AT+LPM=0") != NULL)
-	{
+	case 0:
 		return LPM_OFF;
+	default:
+		return NO_RESPONSE;
 	}
-	return NO_RESPONSE;
 }
 
 bool RUI3::setLPMLevel(int mode)
@@ -303,117 +572,73 @@ bool RUI3::setLPMLevel(int mode)
 		MYLOG("lpmlvl","Parameter error");
 		return false;
 	}
-	snprintf(command, 1024, "at+lpmlvl=%d\r\n", mode);
-	sendRawCommand(command);
-
-	recvResponse();
-	MYLOG("lpmlvl","<< %s", ret);
-	if ((strstr(ret, "Initialization OK") != NULL) || (strstr(ret, "OK") != NULL))
-	{
-		return true;
-	}
-
-	return false;
+	return atExec(AT_CMD_LPMLVL, (int32_t)mode);
 }
 
 uint8_t RUI3::getLPMLevel(void)
 {
-	snprintf(command, 1024, "at+lpmlvl=?\r\n");
-	sendRawCommand(command);
-	recvResponse();
-	MYLOG("lpmlvl?","<< %s", ret);
-	if (strstr(ret, "AT+LPMLVL=1") != NULL)
+	switch (atQueryValue(AT_CMD_LPMLVL))
 	{
+	case 1:
 		return LPM_LVL_1;
-	}
-	else if (strstr(ret, "AT+LPMLVL=2") != NULL)
-	{
+	case 2:
 		return LPM_LVL_2;
+	default:
+		return NO_RESPONSE;
 	}
-	return NO_RESPONSE;
 }
 
 void RUI3::reset(void)
 {
-	snprintf(command, 1024, "atz\r\n");
-	sendRawCommand(command);
+	sendRawCommand("atz\r\n");
 }
 
 bool RUI3::setWorkingMode(int mode)
 {
-	switch (mode)
+	if ((mode != LoRaP2P) && (mode != LoRaWAN) && (mode != FSKP2P))
 	{
-	case 0:
-		snprintf(command, 1024, "at+nwm=0\r\n");
-		sendRawCommand(command);
-		break;
-	case 1:
-		snprintf(command, 1024, "at+nwm=1\r\n");
-		sendRawCommand(command);
-		break;
-	default:
 		return false;
 	}
-
-	recvResponse();
-	MYLOG("nwm","<< %s", ret);
-	if ((strstr(ret, "Initialization OK") != NULL) || (strstr(ret, "OK") != NULL))
+	if (!atExec(AT_CMD_NWM, (int32_t)mode))
 	{
-		return true;
+		return false;
 	}
-
-	return false;
+	// The module resets, the radio settings have to be read again
+	_p2p_valid = false;
+	_fsk_valid = false;
+	_fsk_mode = mode == FSKP2P;
+	return true;
 }
 
 uint8_t RUI3::getWorkingMode(void)
 {
-	snprintf(command, 1024, "at+nwm=?\r\n");
-	sendRawCommand(command);
-	recvResponse();
-	MYLOG("nwm?","<< %s", ret);
-	if (strstr(ret, "AT+NWM=1") != NULL)
+	switch (atQueryValue(AT_CMD_NWM))
 	{
+	case 1:
+		_fsk_mode = false;
 		return LoRaWAN;
+	case 2:
+		_fsk_mode = true;
+		return FSKP2P;
+	default:
+		_fsk_mode = false;
+		return LoRaP2P;
 	}
-	return LoRaP2P;
 }
 
 bool RUI3::setJoinMode(int mode)
 {
-	switch (mode)
+	if ((mode != ABP) && (mode != OTAA))
 	{
-	case 0:
-		snprintf(command, 1024, "at+njm=0\r\n");
-		sendRawCommand(command);
-		break;
-	case 1:
-		snprintf(command, 1024, "at+njm=1\r\n");
-		sendRawCommand(command);
-		break;
-	default:
 		Serial.println("Wrong mode");
 		return false;
 	}
-	recvResponse();
-	MYLOG("njm","<< %s", ret);
-
-	if (strstr(ret, "OK") != NULL)
-	{
-		return true;
-	}
-	else
-	{
-		return false;
-	}
+	return atExec(AT_CMD_NJM, (int32_t)mode);
 }
 
 uint8_t RUI3::getJoinMode(void)
 {
-	snprintf(command, 1024, "at+njm=?\r\n");
-	sendRawCommand(command);
-	recvResponse();
-	MYLOG("njm?","<< %s", ret);
-	if (strstr(ret, "AT+NJM=1") != NULL)
+	if (atQueryValue(AT_CMD_NJM) == 1)
 	{
 		return OTAA;
 	}
@@ -422,68 +647,59 @@ uint8_t RUI3::getJoinMode(void)
 
 bool RUI3::joinLoRaNetwork(int timeout)
 {
-	snprintf(command, 1024, "at+join\r\n");
-	sendRawCommand(command);
-	recvResponse();
-	MYLOG("join","<< %s", ret);
+	return atExec(AT_CMD_JOIN, (const char *)NULL);
+}
 
-	if (strstr(ret, "OK") != NULL)
+bool RUI3::parseCredential(const char *hex, uint8_t *data, uint16_t len)
+{
+	if (strlen(hex) != len * 2)
 	{
-		return true;
+		return false;
 	}
+	return at_parse_hex(hex, data, len) == len;
+}
 
-	return false;
+#if RUI3_NO_HEAP == 0
+bool RUI3::initOTAA(const String &devEUI, const String &appEUI, const String &appKEY)
+{
+	return initOTAA(devEUI.c_str(), appEUI.c_str(), appKEY.c_str());
 }
+#endif
 
-bool RUI3::initOTAA(String devEUI, String appEUI, String appKEY)
+bool RUI3::initOTAA(const char *devEUI, const char *appEUI, const char *appKEY)
 {
-	if (devEUI.length() == 16)
+	uint8_t dev_eui[8];
+	uint8_t app_eui[8];
+	uint8_t app_key[16];
+	if (!parseCredential(devEUI, dev_eui, 8))
 	{
-		_devEUI = devEUI;
-	}
-	else
-	{
-		MYLOG("otaa","The parameter devEUI is set incorrectly!");
+		MYLOG("otaa", "The parameter devEUI is set incorrectly!");
 		return false;
 	}
-	if (appEUI.length() == 16)
-	{
-		_appEUI = appEUI;
-	}
-	else
+	if (!parseCredential(appEUI, app_eui, 8))
 	{
 		MYLOG("otaa", "The parameter appEUI is set incorrectly!");
 		return false;
 	}
-	if (appKEY.length() == 32)
-	{
-		_appKEY = appKEY;
-	}
-	else
+	if (!parseCredential(appKEY, app_key, 16))
 	{
 		MYLOG("otaa", "The parameter appKEY is set incorrectly!");
 		return false;
 	}
+	return initOTAA(dev_eui, app_eui, app_key);
+}
 
-	snprintf(command, 1024, "at+deveui=%s\r\n", _devEUI.c_str());
-	sendRawCommand(command);
-	recvResponse();
-	MYLOG("otaa","<< %s", ret);
-	if (strstr(ret, "OK") != NULL)
-	{
-		snprintf(command, 1024, "at+appeui=%s\r\n", _appEUI.c_str());
-		sendRawCommand(command);
+bool RUI3::initOTAA(const uint8_t (&devEUI)[8], const uint8_t (&appEUI)[8], const uint8_t (&appKEY)[16])
+{
+	memcpy(_devEUI, devEUI, sizeof(_devEUI));
+	memcpy(_appEUI, appEUI, sizeof(_appEUI));
+	memcpy(_appKEY, appKEY, sizeof(_appKEY));
 
-		recvResponse();
-		MYLOG("otaa","<< %s", ret);
-		if (strstr(ret, "OK") != NULL)
+	if (atExecHex(AT_CMD_DEVEUI, _devEUI, sizeof(_devEUI)))
+	{
+		if (atExecHex(AT_CMD_APPEUI, _appEUI, sizeof(_appEUI)))
 		{
-			snprintf(command, 1024, "at+appkey=%s\r\n", _appKEY.c_str());
-			sendRawCommand(command);
-
-			recvResponse();
-			MYLOG("otaa","<< %s", ret);
-			if (strstr(ret, "OK") != NULL)
+			if (atExecHex(AT_CMD_APPKEY, _appKEY, sizeof(_appKEY)))
 			{
 				return true;
 			}
@@ -499,14 +715,10 @@ bool RUI3::getDevEUI(char *eui, uint16_t array_len)
 	{
 		return false;
 	}
-	snprintf(command, 1024, "at+deveui=?\r\n");
-	sendRawCommand(command);
-	recvResponse();
-	MYLOG("deveui?","<< %s", ret);
-	char *str_ptr = strstr(ret, "=");
+	char *str_ptr = atQuery(AT_CMD_DEVEUI);
 	if (str_ptr != NULL)
 	{
-		asciiArrayToByte(eui, str_ptr + 1, 8, 16);
+		asciiArrayToByte(eui, str_ptr, 8, 16);
 		return true;
 	}
 	return false;
@@ -518,14 +730,10 @@ bool RUI3::getAppEUI(char *eui, uint16_t array_len)
 	{
 		return false;
 	}
-	snprintf(command, 1024, "at+appeui=?\r\n");
-	sendRawCommand(command);
-	recvResponse();
-	MYLOG("appeui?","<< %s", ret);
-	char *str_ptr = strstr(ret, "=");
+	char *str_ptr = atQuery(AT_CMD_APPEUI);
 	if (str_ptr != NULL)
 	{
-		asciiArrayToByte(eui, str_ptr + 1, 8, 16);
+		asciiArrayToByte(eui, str_ptr, 8, 16);
 		return true;
 	}
 	return false;
@@ -537,64 +745,58 @@ bool RUI3::getAppKey(char *key, uint16_t array_len)
 	{
 		return false;
 	}
-	snprintf(command, 1024, "at+appkey=?\r\n");
-	sendRawCommand(command);
-	recvResponse();
-	MYLOG("appkey?","<< %s", ret);
-	char *str_ptr = strstr(ret, "=");
+	char *str_ptr = atQuery(AT_CMD_APPKEY);
 	if (str_ptr != NULL)
 	{
-		return asciiArrayToByte(key, str_ptr + 1, 16, 34);
+		return asciiArrayToByte(key, str_ptr, 16, 34);
 	}
 	return false;
 }
 
-bool RUI3::initABP(String devADDR, String nwksKEY, String appsKEY)
+#if RUI3_NO_HEAP == 0
+bool RUI3::initABP(const String &devADDR, const String &nwksKEY, const String &appsKEY)
 {
-	if (devADDR.length() == 8)
-	{
-		_devADDR = devADDR;
-	}
-	else
+	return initABP(devADDR.c_str(), nwksKEY.c_str(), appsKEY.c_str());
+}
+#endif
+
+bool RUI3::initABP(const char *devADDR, const char *nwksKEY, const char *appsKEY)
+{
+	uint8_t dev_addr[4];
+	uint8_t nwks_key[16];
+	uint8_t apps_key[16];
+	if (!parseCredential(devADDR, dev_addr, 4))
 	{
-		MYLOG("abp","The parameter devADDR is set incorrectly!");
+		MYLOG("abp", "The parameter devADDR is set incorrectly!");
 		return false;
 	}
-	if (nwksKEY.length() == 32)
+	if (!parseCredential(nwksKEY, nwks_key, 16))
 	{
-		_nwksKEY = nwksKEY;
-	}
-	else
-	{
-		MYLOG("abp","The parameter nwksKEY is set incorrectly!");
+		MYLOG("abp", "The parameter nwksKEY is set incorrectly!");
 		return false;
 	}
-	if (appsKEY.length() == 32)
-	{
-		_appsKEY = appsKEY;
-	}
-	else
+	if (!parseCredential(appsKEY, apps_key, 16))
 	{
-		MYLOG("abp","The parameter appsKEY is set incorrectly!");
+		MYLOG("abp", "The parameter appsKEY is set incorrectly!");
 		return false;
 	}
-	snprintf(command, 1024, "at+devaddr=%s\r\n", _devADDR.c_str());
-	sendRawCommand(command);
-	recvResponse();
-	MYLOG("abp","<< %s", ret);
-	if (strstr(ret, "OK") != NULL)
+	return initABP(((uint32_t)dev_addr[0] << 24) | ((uint32_t)dev_addr[1] << 16) | ((uint32_t)dev_addr[2] << 8) | dev_addr[3], nwks_key, apps_key);
+}
+
+bool RUI3::initABP(uint32_t devADDR, const uint8_t (&nwksKEY)[16], const uint8_t (&appsKEY)[16])
+{
+	_devADDR[0] = devADDR >> 24;
+	_devADDR[1] = devADDR >> 16;
+	_devADDR[2] = devADDR >> 8;
+	_devADDR[3] = devADDR;
+	memcpy(_nwksKEY, nwksKEY, sizeof(_nwksKEY));
+	memcpy(_appsKEY, appsKEY, sizeof(_appsKEY));
+
+	if (atExecHex(AT_CMD_DEVADDR, _devADDR, sizeof(_devADDR)))
 	{
-		snprintf(command, 1024, "at+nwkskey=%s\r\n", _nwksKEY.c_str());
-		sendRawCommand(command);
-		recvResponse();
-		MYLOG("abp","<< %s", ret);
-		if (strstr(ret, "OK") != NULL)
+		if (atExecHex(AT_CMD_NWKSKEY, _nwksKEY, sizeof(_nwksKEY)))
 		{
-			snprintf(command, 1024, "at+appskey=%s\r\n", _appsKEY.c_str());
-			sendRawCommand(command);
-			recvResponse();
-			MYLOG("abp","<< %s", ret);
-			if (strstr(ret, "OK") != NULL)
+			if (atExecHex(AT_CMD_APPSKEY, _appsKEY, sizeof(_appsKEY)))
 			{
 				return true;
 			}
@@ -605,14 +807,10 @@ bool RUI3::initABP(String devADDR, String nwksKEY, String appsKEY)
 
 uint32_t RUI3::getDevAddress(void)
 {
-	snprintf(command, 1024, "at+devaddr=?\r\n");
-	sendRawCommand(command);
-	recvResponse();
-	MYLOG("devaddr?","<< %s", ret);
-	char *str_ptr = strstr(ret, "=");
+	char *str_ptr = atQuery(AT_CMD_DEVADDR);
 	if (str_ptr != NULL)
 	{
-		uint32_t _addr = strtol(str_ptr + 1, NULL, 16);
+		uint32_t _addr = strtoul(str_ptr, NULL, 16);
 		return _addr;
 	}
 	return NO_RESPONSE;
@@ -624,14 +822,10 @@ bool RUI3::getAppsKey(char *key, uint16_t array_len)
 	{
 		return false;
 	}
-	snprintf(command, 1024, "at+appskey=?\r\n");
-	sendRawCommand(command);
-	recvResponse();
-	MYLOG("appskey?","<< %s", ret);
-	char *str_ptr = strstr(ret, "=");
+	char *str_ptr = atQuery(AT_CMD_APPSKEY);
 	if (str_ptr != NULL)
 	{
-		return asciiArrayToByte(key, str_ptr + 1, 16, 32);
+		return asciiArrayToByte(key, str_ptr, 16, 32);
 	}
 	return false;
 }
@@ -642,92 +836,179 @@ bool RUI3::getNwsKey(char *key, uint16_t array_len)
 	{
 		return false;
 	}
-	snprintf(command, 1024, "at+nwkskey=?\r\n");
-	sendRawCommand(command);
-	recvResponse();
-	MYLOG("nwkskey","<< %s", ret);
-	char *str_ptr = strstr(ret, "=");
+	char *str_ptr = atQuery(AT_CMD_NWKSKEY);
 	if (str_ptr != NULL)
 	{
-		return asciiArrayToByte(key, str_ptr + 1, 16, 32);
+		return asciiArrayToByte(key, str_ptr, 16, 32);
 	}
 	return false;
 }
 
 bool RUI3::setConfirmed(int type)
 {
-	switch (type)
+	if ((type != UNCONF) && (type != CONF))
 	{
-	case 0:
-		snprintf(command, 1024, "at+cfm=0\r\n");
-		sendRawCommand(command);
-		break;
-	case 1:
-		snprintf(command, 1024, "at+cfm=1\r\n");
-		sendRawCommand(command);
-		break;
-	default:
 		return false;
 	}
-	recvResponse();
-	MYLOG("cfm","<< %s", ret);
-	if (strstr(ret, "OK") != NULL)
+	return atExec(AT_CMD_CFM, (int32_t)type);
+}
+
+uint8_t RUI3::getConfirmed(void)
+{
+	if (atQueryValue(AT_CMD_CFM) == 1)
 	{
-		return true;
+		return CONF;
 	}
-	else
+	return UNCONF;
+}
+
+bool RUI3::sendData(int port, char *datahex)
+{
+	if (_region == NO_RESPONSE)
 	{
+		// Needed for the TX done timeout, query before the command buffer is filled
+		getRegion();
+	}
+	uint16_t len = atPrefix(AT_CMD_SEND);
+	if (!cmdAppendInt(len, port) || !cmdAppend(len, ":") || !cmdAppend(len, datahex))
+	{
+		MYLOG("send", "Payload too long");
 		return false;
 	}
+	return sendTransact(len, strlen(datahex) / 2);
 }
 
-uint8_t RUI3::getConfirmed(void)
+bool RUI3::sendData(uint8_t port, const uint8_t *data, uint16_t data_len)
 {
-	snprintf(command, 1024, "at+cfm=?\r\n");
-	sendRawCommand(command);
-	recvResponse();
-	MYLOG("cfm?","<< %s", ret);
-	if (strstr(ret, "AT+CFM=1") != NULL)
+	if (_region == NO_RESPONSE)
 	{
-		return CONF;
+		getRegion();
 	}
-	return UNCONF;
+	uint16_t len = atPrefix(AT_CMD_SEND);
+	if (!cmdAppendUint(len, port) || !cmdAppend(len, ":") || !cmdAppendHex(len, data, data_len))
+	{
+		MYLOG("send", "Payload too long");
+		return false;
+	}
+	return sendTransact(len, data_len);
 }
 
-bool RUI3::sendData(int port, char *datahex)
+bool RUI3::sendTransact(uint16_t len, uint16_t payload_len)
 {
-	snprintf(command, 1024, "at+send=%d:%s\r\n", port, datahex);
-	sendRawCommand(command);
+	if (!atTransact(AT_CMD_SEND, len))
+	{
+		return false;
+	}
+	_tx_airtime = timeOnAir(_region, _dr == NO_RESPONSE ? 0 : _dr, payload_len);
+	if (_tx_airtime == 0)
+	{
+		_tx_timeout = TX_DONE_TIMEOUT;
+		return true;
+	}
+	// A downlink in RX2 ends after the RX2 window opened, up to the max payload at the RX2 datarate
+	uint8_t rx2_dr = regionRX2DR(_region);
+	uint32_t rx2_airtime = timeOnAir(_region, rx2_dr, regionMaxPayload(_region, rx2_dr));
+	_tx_timeout = _tx_airtime / 1000 + 1 + LORAWAN_RX_WINDOWS + rx2_airtime / 1000 + 1 + TX_DONE_MARGIN;
+	return true;
+}
 
-	recvResponse();
-	MYLOG("send","<< %s", ret);
-	if (strstr(ret, "OK") != NULL)
+bool RUI3::recvCmdResponse(uint32_t timeout)
+{
+	_cmd_resp = true;
+	bool result = recvResponse(timeout);
+	_cmd_resp = false;
+	return result;
+}
+
+bool RUI3::evtDeferred(const char *line)
+{
+	if (strncmp(line, "+EVT:", 5) != 0)
+	{
+		return false;
+	}
+	if (_cmd_resp)
 	{
+		// Events that arrive before the response of a command belong to the application
 		return true;
 	}
-	else
+	// recvResponse() and waitTxDone() wait for the end of a transmission
+	return (strstr(line, "+EVT:TX_DONE") == NULL) && (strstr(line, "+EVT:SEND_CONFIRMED_") == NULL) &&
+		   (strstr(line, "+EVT:TXP2P DONE") == NULL);
+}
+
+void RUI3::evtPush(const char *line, uint16_t len)
+{
+	while ((len > 0) && ((line[len - 1] == '\r') || (line[len - 1] == '\n')))
+	{
+		len--;
+	}
+	if (_evt_len + len + 1 > AT_EVT_BUFFER_LEN)
+	{
+		MYLOG("evt", "Event buffer full, event dropped");
+		return;
+	}
+	memcpy(&_evt[_evt_len], line, len);
+	_evt_len += len;
+	_evt[_evt_len++] = '\n';
+}
+
+bool RUI3::evtPop(void)
+{
+	if (_evt_len == 0)
 	{
 		return false;
 	}
+	uint16_t len = 0;
+	while (_evt[len] != '\n')
+	{
+		len++;
+	}
+	memcpy(ret, _evt, len);
+	ret[len] = 0x00;
+	_evt_len -= len + 1;
+	memmove(_evt, &_evt[len + 1], _evt_len);
+	return true;
 }
 
 bool RUI3::recvResponse(uint32_t timeout)
 {
 	ret[0] = 0x00;
+	_line_len = 0;
 	uint16_t ret_index = 0;
+	uint16_t line_start = 0;
 	bool rx_ok = false;
+	_resp_timeout = false;
 	time_t start_listen = millis();
 	while ((millis() - start_listen) < timeout)
 	{
-		if (_serial1.available())
+		// Read a complete line, the TX done timeouts leave no time for a delay per character
+		bool line_end = false;
+		while (_serial1.available() && (ret_index < ARRAY_SIZE(ret) - 1))
 		{
 			rx_ok = true;
-			ret[ret_index] = _serial1.read();
-			if ((ret[ret_index] != '\r') || (ret[ret_index] != '\n'))
+			ret[ret_index++] = _serial1.read();
+			ret[ret_index] = 0x00;
+			if (ret[ret_index - 1] == '\n')
 			{
-				ret_index++;
+				line_end = true;
+				break;
 			}
-			ret[ret_index] = 0x00;
+		}
+		if (line_end)
+		{
+			while ((ret[line_start] == '\r') || (ret[line_start] == '\n'))
+			{
+				line_start++;
+			}
+			if (evtDeferred(&ret[line_start]))
+			{
+				// Not part of the response, e.g. a P2P packet received before the OK
+				evtPush(&ret[line_start], ret_index - line_start);
+				ret_index = line_start;
+				ret[ret_index] = 0x00;
+				continue;
+			}
+			line_start = ret_index;
 		}
 
 		if ((strstr(ret, "+EVT:TX_DONE") != NULL) || (strstr(ret, "+EVT:SEND_CONFIRMED_OK") != NULL))
@@ -746,24 +1027,79 @@ bool RUI3::recvResponse(uint32_t timeout)
 		}
 
 		if ((strstr(ret, "AT_COMMAND_NOT_FOUND") != NULL) || (strstr(ret, "AT_PARAM_ERROR") != NULL) ||
-			(strstr(ret, "SEND_CONFIRMED_FAILED") != NULL) || (strstr(ret, "AT_NO_NETWORK_JOINED") != NULL))
+			(strstr(ret, "SEND_CONFIRMED_FAILED") != NULL) || (strstr(ret, "AT_NO_NETWORK_JOINED") != NULL) ||
+			(strstr(ret, "AT_ERROR") != NULL) || (strstr(ret, "AT_BUSY_ERROR") != NULL))
 		{
 			return false;
 		}
-		delay(20);
+		if (!_serial1.available())
+		{
+			// Short poll interval, the response time is measured for the adaptive timeouts
+			delay(1);
+		}
 	}
 	MYLOG("rcv+resp","<< %s", ret);
+	_resp_timeout = true;
 
 	if (!rx_ok)
 	{
-		snprintf(ret, 1024, "NO_RESPONSE");
+		strcpy(ret, "NO_RESPONSE");
+	}
+	return false;
+}
+
+bool RUI3::waitTxDone(void)
+{
+	return recvResponse(_tx_timeout);
+}
+
+uint32_t RUI3::getTxTimeout(void)
+{
+	return _tx_timeout;
+}
+
+uint32_t RUI3::getTxAirtime(void)
+{
+	return _tx_airtime;
+}
+
+bool RUI3::pollLine(void)
+{
+	if ((_line_len == 0) && evtPop())
+	{
+		return true;
+	}
+	while (_serial1.available())
+	{
+		char rx_char = _serial1.read();
+		if ((rx_char == '\r') || (rx_char == '\n'))
+		{
+			if (_line_len == 0)
+			{
+				// Skip empty lines
+				continue;
+			}
+			ret[_line_len] = 0x00;
+			_line_len = 0;
+			return true;
+		}
+		if (_line_len < ARRAY_SIZE(ret) - 1)
+		{
+			ret[_line_len++] = rx_char;
+		}
 	}
 	return false;
 }
 
 void RUI3::recvRX(uint32_t timeout)
 {
+	// A packet received while a command waited for its response comes first
+	if ((_evt_len != 0) && (strncmp(_evt, "+EVT:RX", 7) == 0) && evtPop())
+	{
+		return;
+	}
 	ret[0] = 0x00;
+	_line_len = 0;
 	uint16_t ret_index = 0;
 	bool rx_ok = false;
 	volatile bool wait_eol = false;
@@ -820,7 +1156,7 @@ void RUI3::recvRX(uint32_t timeout)
 		{
 			if ((millis() - start_listen) > 120000)
 			{
-				snprintf(ret, 1024, "FAILED_RX");
+				strcpy(ret, "FAILED_RX");
 				cont_while = false;
 				break;
 			}
@@ -829,7 +1165,7 @@ void RUI3::recvRX(uint32_t timeout)
 		{
 			if ((millis() - start_listen) > timeout)
 			{
-				snprintf(ret, 1024, "NO_RX");
+				strcpy(ret, "NO_RX");
 				cont_while = false;
 				break;
 			}
@@ -839,7 +1175,7 @@ void RUI3::recvRX(uint32_t timeout)
 
 	if (!rx_ok)
 	{
-		snprintf(ret, 1024, "NO_RX");
+		strcpy(ret, "NO_RX");
 	}
 	return;
 }
@@ -847,6 +1183,7 @@ void RUI3::recvRX(uint32_t timeout)
 void RUI3::flushRX(uint32_t timeout)
 {
 	ret[0] = 0x00;
+	_line_len = 0;
 	uint16_t ret_index = 0;
 	time_t start_listen = millis();
 	while ((millis() - start_listen) < timeout)
@@ -879,164 +1216,345 @@ void RUI3::flushRX(uint32_t timeout)
 	return;
 }
 
+
 bool RUI3::initP2P(p2p_settings *p2p_settings)
 {
-	snprintf(command, 1024, "at+p2p=%ld:%d:%d:%d:%d:%d\r\n", p2p_settings->freq, p2p_settings->sf, p2p_settings->bw, p2p_settings->cr, p2p_settings->ppl, p2p_settings->txp);
-	sendRawCommand(command);
-	recvResponse();
-	MYLOG("p2p","<< %s", ret);
-	if (strstr(ret, "OK") != NULL)
+	uint16_t len = atPrefix(AT_CMD_P2P);
+	cmdAppendUint(len, p2p_settings->freq);
+	cmdAppend(len, ":");
+	cmdAppendUint(len, p2p_settings->sf);
+	cmdAppend(len, ":");
+	cmdAppendUint(len, p2p_settings->bw);
+	cmdAppend(len, ":");
+	cmdAppendUint(len, p2p_settings->cr);
+	cmdAppend(len, ":");
+	cmdAppendUint(len, p2p_settings->ppl);
+	cmdAppend(len, ":");
+	cmdAppendUint(len, p2p_settings->txp);
+	if (!atTransact(AT_CMD_P2P, len))
+	{
+		_p2p_valid = false;
+		return false;
+	}
+	_p2p = *p2p_settings;
+	_p2p_valid = true;
+	return true;
+}
+
+bool RUI3::getP2P(p2p_settings *p2p_settings)
+{
+	// AT+P2P=916100000:7:0:1:8:22
+	char *data_buff = atQuery(AT_CMD_P2P);
+	at_tuple tuple;
+	if ((data_buff == NULL) || !at_parse_tuple(data_buff, tuple) || (tuple.num < 6))
+	{
+		return false;
+	}
+	p2p_settings->freq = tuple.val[0];
+	p2p_settings->sf = tuple.val[1];
+	p2p_settings->bw = tuple.val[2];
+	p2p_settings->cr = tuple.val[3];
+	p2p_settings->ppl = tuple.val[4];
+	p2p_settings->txp = tuple.val[5];
+	_p2p = *p2p_settings;
+	_p2p_valid = true;
+	return true;
+}
+
+bool RUI3::getP2PSettings(p2p_settings *p2p_settings)
+{
+	if (!_p2p_valid)
+	{
+		return getP2P(p2p_settings);
+	}
+	*p2p_settings = _p2p;
+	return true;
+}
+
+bool RUI3::updateP2P(p2p_settings *p2p_settings)
+{
+	if (!_p2p_valid)
+	{
+		return initP2P(p2p_settings);
+	}
+	uint8_t changed = (p2p_settings->freq != _p2p.freq) + (p2p_settings->sf != _p2p.sf) + (p2p_settings->bw != _p2p.bw) +
+					  (p2p_settings->cr != _p2p.cr) + (p2p_settings->ppl != _p2p.ppl) + (p2p_settings->txp != _p2p.txp);
+	if (changed > 1)
+	{
+		return initP2P(p2p_settings);
+	}
+	// At most one of them sends a command
+	return setP2PFrequency(p2p_settings->freq) && setP2PSF(p2p_settings->sf) && setP2PBandwidth(p2p_settings->bw) &&
+		   setP2PCR(p2p_settings->cr) && setP2PPreamble(p2p_settings->ppl) && setP2PTXPower(p2p_settings->txp);
+}
+
+template <typename T>
+bool RUI3::setP2PField(at_cmd_id cmd, int32_t value, T &field, T cached)
+{
+	if (_p2p_valid && (field == cached))
 	{
 		return true;
 	}
-	else
+	if (!atExec(cmd, value))
 	{
 		return false;
 	}
+	field = cached;
+	return true;
 }
 
-bool RUI3::getP2P(p2p_settings *p2p_settings)
+template <typename T>
+bool RUI3::setFSKField(at_cmd_id cmd, T value, T &field)
 {
-	// AT+P2P=916100000:7:0:1:8:22
+	if (_fsk_valid && (field == value))
+	{
+		return true;
+	}
+	if (!atExec(cmd, (int32_t)value))
+	{
+		return false;
+	}
+	field = value;
+	return true;
+}
 
-	snprintf(command, 1024, "at+p2p=?\r\n");
-	sendRawCommand(command);
-	recvResponse();
-	MYLOG("p2p?","<< %s", ret);
-	char *data_buff = strstr(ret, "AT+P2P=");
-	if (data_buff != NULL)
+bool RUI3::setP2PFrequency(uint32_t freq)
+{
+	if (_fsk_mode)
 	{
-		char *param;
-		param = strtok(ret + 7, ":");
+		return setFSKField(AT_CMD_PFREQ, freq, _fsk.freq);
+	}
+	return setP2PField(AT_CMD_PFREQ, (int32_t)freq, _p2p.freq, freq);
+}
 
-		if (param != NULL)
+bool RUI3::setP2PSF(uint16_t sf)
+{
+	return setP2PField(AT_CMD_PSF, sf, _p2p.sf, sf);
+}
+
+bool RUI3::setP2PBandwidth(uint16_t bw)
+{
+	// AT+PBW takes the bandwidth in kHz
+	uint32_t khz = p2pBandwidthHz(bw) / 1000;
+	if ((khz != 125) && (khz != 250) && (khz != 500))
+	{
+		if (!_p2p_valid)
 		{
-			/* check frequency */
-			p2p_settings->freq = strtol(param, NULL, 0);
-			/* check SF */
-			param = strtok(NULL, ":");
-			if (param != NULL)
-			{
-				p2p_settings->sf = strtol(param, NULL, 0);
-				// Check Bandwidth
-				param = strtok(NULL, ":");
-				if (param != NULL)
-				{
-					p2p_settings->bw = strtol(param, NULL, 0);
-					// Check CR
-					param = strtok(NULL, ":");
-					if (param != NULL)
-					{
-						p2p_settings->cr = strtol(param, NULL, 0);
-						// Check Preamble length
-						param = strtok(NULL, ":");
-						if (param != NULL)
-						{
-							p2p_settings->ppl = strtol(param, NULL, 0);
-							// Check TX power
-							param = strtok(NULL, ":");
-							if (param != NULL)
-							{
-								p2p_settings->txp = strtol(param, NULL, 0);
-							}
-						}
-					}
-				}
-			}
+			return false;
+		}
+		if (_p2p.bw == bw)
+		{
+			return true;
 		}
+		p2p_settings settings = _p2p;
+		settings.bw = bw;
+		return initP2P(&settings);
 	}
-	else
+	return setP2PField(AT_CMD_PBW, (int32_t)khz, _p2p.bw, bw);
+}
+
+bool RUI3::setP2PCR(uint16_t cr)
+{
+	return setP2PField(AT_CMD_PCR, cr, _p2p.cr, cr);
+}
+
+bool RUI3::setP2PPreamble(uint16_t ppl)
+{
+	return setP2PField(AT_CMD_PPL, ppl, _p2p.ppl, ppl);
+}
+
+bool RUI3::setP2PTXPower(uint16_t txp)
+{
+	if (_fsk_mode)
+	{
+		return setFSKField(AT_CMD_PTP, txp, _fsk.txp);
+	}
+	return setP2PField(AT_CMD_PTP, txp, _p2p.txp, txp);
+}
+
+bool RUI3::sendFSK(fsk_settings *fsk_settings, bool all)
+{
+	struct
+	{
+		at_cmd_id cmd;
+		uint32_t value;
+		uint32_t cached;
+	} fields[] = {
+		{AT_CMD_PFREQ, fsk_settings->freq, _fsk.freq},
+		{AT_CMD_PBR, fsk_settings->bitrate, _fsk.bitrate},
+		{AT_CMD_PFDEV, fsk_settings->fdev, _fsk.fdev},
+		// AT+PBW takes the bandwidth in Hz in FSK mode
+		{AT_CMD_PBW, fsk_settings->bw, _fsk.bw},
+		{AT_CMD_PTP, fsk_settings->txp, _fsk.txp},
+	};
+	for (uint8_t idx = 0; idx < sizeof(fields) / sizeof(fields[0]); idx++)
+	{
+		if (!all && (fields[idx].value == fields[idx].cached))
+		{
+			continue;
+		}
+		if (!atExec(fields[idx].cmd, (int32_t)fields[idx].value))
+		{
+			_fsk_valid = false;
+			return false;
+		}
+	}
+	_fsk = *fsk_settings;
+	_fsk_valid = true;
+	// Only the FSK mode accepts the FSK settings
+	_fsk_mode = true;
+	return true;
+}
+
+bool RUI3::initFSK(fsk_settings *fsk_settings)
+{
+	return sendFSK(fsk_settings, true);
+}
+
+bool RUI3::updateFSK(fsk_settings *fsk_settings)
+{
+	return sendFSK(fsk_settings, !_fsk_valid);
+}
+
+bool RUI3::getFSK(fsk_settings *fsk_settings)
+{
+	int32_t freq = atQueryValue(AT_CMD_PFREQ);
+	int32_t bitrate = atQueryValue(AT_CMD_PBR);
+	int32_t fdev = atQueryValue(AT_CMD_PFDEV);
+	int32_t bw = atQueryValue(AT_CMD_PBW);
+	int32_t txp = atQueryValue(AT_CMD_PTP);
+	if ((freq <= 0) || (bitrate <= 0) || (fdev < 0) || (bw <= 0) || (txp < 0))
 	{
 		return false;
 	}
+	fsk_settings->freq = freq;
+	fsk_settings->bitrate = bitrate;
+	fsk_settings->fdev = fdev;
+	fsk_settings->bw = bw;
+	fsk_settings->txp = txp;
+	_fsk = *fsk_settings;
+	_fsk_valid = true;
+	// Only the FSK mode accepts the FSK settings
+	_fsk_mode = true;
 	return true;
 }
 
-bool RUI3::sendP2PData(char *datahex)
+void RUI3::p2pCheckSettings(void)
 {
-	snprintf(command, 1024, "at+psend=%s\r\n", datahex);
-	sendRawCommand(command);
-	recvResponse();
-	MYLOG("psend","<< %s", ret);
-	if (strstr(ret, "OK") != NULL)
+	if (_fsk_mode && !_fsk_valid)
 	{
-		return true;
+		fsk_settings settings;
+		getFSK(&settings);
 	}
-	else
+	else if (!_fsk_mode && !_p2p_valid)
 	{
-		return false;
+		p2p_settings settings;
+		getP2P(&settings);
 	}
 }
 
-bool RUI3::setP2PCAD(bool enable)
+bool RUI3::sendP2PData(char *datahex)
 {
-	if (enable)
+	p2pCheckSettings();
+	if (!atExec(AT_CMD_PSEND, datahex))
 	{
-		snprintf(command, 1024, "at+cad=1\r\n");
+		return false;
 	}
-	else
+	p2pTxTimeout(strlen(datahex) / 2);
+	return true;
+}
+
+bool RUI3::sendP2PData(const uint8_t *data, uint16_t data_len)
+{
+	p2pCheckSettings();
+	if (!atExecHex(AT_CMD_PSEND, data, data_len))
 	{
-		snprintf(command, 1024, "at+cad=0\r\n");
+		return false;
 	}
-	sendRawCommand(command);
-	recvResponse();
-	MYLOG("cad","<< %s", ret);
-	if (strstr(ret, "OK") != NULL)
+	p2pTxTimeout(data_len);
+	return true;
+}
+
+uint32_t RUI3::getP2PAirtime(uint16_t payload_len)
+{
+	if (_fsk_mode)
 	{
-		return true;
+		return _fsk_valid ? fskTimeOnAir(_fsk.bitrate, payload_len) : 0;
 	}
-	else
+	return _p2p_valid ? timeOnAir(_p2p, payload_len) : 0;
+}
+
+void RUI3::p2pTxTimeout(uint16_t payload_len)
+{
+	_tx_airtime = getP2PAirtime(payload_len);
+	_tx_timeout = _tx_airtime == 0 ? TX_DONE_TIMEOUT : _tx_airtime / 1000 + 1 + TX_DONE_MARGIN + (_p2p_cad ? CAD_TX_MARGIN : 0);
+}
+
+bool RUI3::setP2PReceive(uint16_t timeout)
+{
+	return atExec(AT_CMD_PRECV, (int32_t)timeout);
+}
+
+bool RUI3::setP2PCAD(bool enable)
+{
+	if (!atExec(AT_CMD_CAD, (int32_t)(enable ? 1 : 0)))
 	{
 		return false;
 	}
+	_p2p_cad = enable;
+	return true;
 }
 
 bool RUI3::getP2PCAD(void)
 {
-	snprintf(command, 1024, "at+cad=?\r\n");
-	sendRawCommand(command);
-	recvResponse();
-	MYLOG("cad?","<< %s", ret);
-	if (strstr(ret, "AT+CAD=1") != NULL)
-	{
-		return true;
-	}
-	return false;
+	_p2p_cad = atQueryValue(AT_CMD_CAD) == 1;
+	return _p2p_cad;
 }
 
 bool RUI3::setUARTConfig(int Baud)
 {
-	snprintf(command, 1024, "at+baud=%d\r\n", Baud);
-	sendRawCommand(command);
+	uint16_t len = atPrefix(AT_CMD_BAUD);
+	cmdAppendInt(len, Baud);
+	atSend(AT_CMD_BAUD, len);
 
 	return true;
 }
 
-bool RUI3::sendRawCommand(char *cmd)
+bool RUI3::sendRawCommand(const char *cmd)
 {
-	// Flush out the buffer first
-	_serial1.print("\r\n");
-	flushRX(1000);
+	if (_cmd_flush)
+	{
+		// Flush out the buffer first, a stale response arrives within the response time of a query
+		uint32_t timeout = rtoTimeout(AT_CLASS_QUERY);
+		_serial1.print("\r\n");
+		flushRX(timeout < AT_FLUSH_TIMEOUT ? timeout : AT_FLUSH_TIMEOUT);
+	}
 
 	MYLOG("raw",">> %s", cmd);
 
 	_serial1.print(cmd);
 	_serial1.flush();
-	delay(50);
 	return true;
 }
 
+void RUI3::setCmdFlush(bool enable)
+{
+	_cmd_flush = enable;
+}
+
+bool RUI3::getCmdFlush(void)
+{
+	return _cmd_flush;
+}
+
 bool RUI3::byteArrayToAscii(char *b_array, char *a_array, uint16_t b_array_len, uint16_t a_array_len)
 {
-	if (a_array_len < (b_array_len * 2) - 1)
+	if (a_array_len <= (b_array_len * 2))
 	{
-		Serial.printf("a_array_size %ld b_array_size %ld\r\n", a_array_len, b_array_len);
+		MYLOG("hex", "a_array_size %d b_array_size %d", a_array_len, b_array_len);
 		return false;
 	}
-	for (int index = 0; index < b_array_len; index++)
-	{
-		sprintf(&a_array[index * 2], "%02X", b_array[index]);
-	}
+	at_format_hex(a_array, a_array_len, (uint8_t *)b_array, b_array_len);
 	return true;
 }
 
@@ -1049,18 +1567,23 @@ bool RUI3::asciiArrayToByte(char *b_array, char *a_array, uint16_t b_array_len,
 
 	if (b_array_len < (a_array_len / 2) - 1)
 	{
-		Serial.printf("a_array_size %ld b_array_size %ld\r\n", a_array_len, b_array_len);
+		MYLOG("hex", "a_array_size %d b_array_size %d", a_array_len, b_array_len);
 		return false;
 	}
 
 	char doublet[3];
-	for (int index = 0; index < a_array_len; index++)
+	int index = 0;
+	// a_array_len is the number of HEX characters, never write more than b_array_len bytes
+	for (; (index < a_array_len / 2) && (index < b_array_len); index++)
 	{
 		doublet[0] = a_array[index * 2];
 		doublet[1] = a_array[(index * 2) + 1];
 		doublet[2] = 0x00;
 		b_array[index] = strtol(doublet, NULL, 16);
-		b_array[index + 1] = 0x00;
+	}
+	if (index < b_array_len)
+	{
+		b_array[index] = 0x00;
 	}
 	return true;
 }
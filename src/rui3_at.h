@@ -13,6 +13,10 @@
 #ifndef _RUI3_H_
 #define _RUI3_H_
 #include "Arduino.h"
+#include "rui3_commands.h"
+#include "rui3_format.h"
+#include "rui3_regions.h"
+#include "rui3_airtime.h"
 
 /** No response from WisDuo */
 #define NO_RESPONSE 255
@@ -31,6 +35,8 @@
 #define LoRaWAN 1
 /** LoRa P2P mode */
 #define LoRaP2P 0
+/** FSK P2P mode */
+#define FSKP2P 2
 
 /** OTAA join mode */
 #define OTAA 1
@@ -63,19 +69,57 @@
 /** LPM level 2 (only RAK3172)*/
 #define LPM_LVL_2 2
 
+/** P2P RX off */
+#define P2P_RX_OFF 0
+/** P2P RX until AT+PRECV=0, TX is possible and the module goes back to RX after TX */
+#define P2P_RX_PERMANENT_TX 65533
+/** P2P RX until AT+PRECV=0, the module leaves RX for TX */
+#define P2P_RX_PERMANENT 65534
+/** P2P RX until one packet is received */
+#define P2P_RX_SINGLE 65535
+
 /** LPM off */
 #define LPM_OFF 0
 /** LPM level 1 */
 #define LPM_ON 1
 
 #define MAX_CMD_LEN (32)
+/** Size of the buffer for outgoing AT commands */
+#define AT_CMD_BUFFER_LEN 1024
 #define MAX_ARGUMENT 25
 
+/** Size of the buffer for events read while waiting for a response, e.g. one P2P RX event with 255 bytes */
+#ifndef AT_EVT_BUFFER_LEN
+#define AT_EVT_BUFFER_LEN 640
+#endif
+
+/** Time added to the time-on-air for the TX done event of a P2P packet in milliseconds */
+#ifndef TX_DONE_MARGIN
+#define TX_DONE_MARGIN 100
+#endif
+/** Time added to the TX done timeout of a P2P packet if CAD is enabled in milliseconds */
+#ifndef CAD_TX_MARGIN
+#define CAD_TX_MARGIN 1000
+#endif
+/** TX done timeout in milliseconds if the time-on-air is not known */
+#ifndef TX_DONE_TIMEOUT
+#define TX_DONE_TIMEOUT 60000
+#endif
+/** Time of the LoRaWAN RX windows after the uplink in milliseconds (RX2 delay + RX2 window), the time-on-air of a max RX2 downlink is added */
+#ifndef LORAWAN_RX_WINDOWS
+#define LORAWAN_RX_WINDOWS 3000
+#endif
+
 // Debug output set to 0 to disable app debug output
 #ifndef DEBUG_MODE
 #define DEBUG_MODE 0
 #endif
 
+// Heap free mode, set to 1 to remove all functions that use String or dynamic memory
+#ifndef RUI3_NO_HEAP
+#define RUI3_NO_HEAP 0
+#endif
+
 #if DEBUG_MODE > 0
 #define MYLOG(tag, ...)                  \
 	do                                   \
@@ -108,6 +152,98 @@ typedef struct _p2p_settings
 	uint16_t txp;  // TX power 5 - 22
 } p2p_settings;
 
+/** Structure for FSK P2P settings */
+typedef struct _fsk_settings
+{
+	uint32_t freq;	  // Frequency in Hz, 150000000-960000000 Hz
+	uint32_t bitrate; // Bitrate in b/s, 600-300000
+	uint32_t fdev;	  // Frequency deviation in Hz, 600-200000
+	uint32_t bw;	  // RX bandwidth in Hz, 4800-467000
+	uint16_t txp;	  // TX power 5 - 22
+} fsk_settings;
+
+/** Number of sub-bands that can be set in the channel mask */
+#define MAX_SUB_BANDS 16
+
+/**
+ * @brief Channel mask as used by AT+MASK
+ * RUI3 enables and disables the channels in blocks of 8 channels (sub-bands).
+ * Bit 0 is sub-band 1 (channels 0 to 7), bit 1 is sub-band 2 (channels 8 to 15), ...
+ * Only used in the regions US915, AU915 and CN470
+ */
+struct channel_mask
+{
+	uint16_t bits; // Enabled sub-bands, bit 0 = sub-band 1
+
+	/** Disable all sub-bands */
+	void clear(void)
+	{
+		bits = 0;
+	}
+
+	/**
+	 * @brief Enable a sub-band
+	 * @param sub_band sub-band 1 to 16
+	 */
+	void enableSubBand(uint8_t sub_band)
+	{
+		if ((sub_band > 0) && (sub_band <= MAX_SUB_BANDS))
+		{
+			bits |= 1 << (sub_band - 1);
+		}
+	}
+
+	/**
+	 * @brief Disable a sub-band
+	 * @param sub_band sub-band 1 to 16
+	 */
+	void disableSubBand(uint8_t sub_band)
+	{
+		if ((sub_band > 0) && (sub_band <= MAX_SUB_BANDS))
+		{
+			bits &= ~(1 << (sub_band - 1));
+		}
+	}
+
+	/**
+	 * @brief Check if a sub-band is enabled
+	 * @param sub_band sub-band 1 to 16
+	 * @return true if the sub-band is enabled
+	 */
+	bool isSubBandEnabled(uint8_t sub_band) const
+	{
+		if ((sub_band == 0) || (sub_band > MAX_SUB_BANDS))
+		{
+			return false;
+		}
+		return (bits & (1 << (sub_band - 1))) != 0;
+	}
+
+	/**
+	 * @brief Check if a 125kHz channel is enabled
+	 * @param channel channel number, 0 to 95 for CN470, 0 to 63 for US915 and AU915
+	 * @return true if the sub-band of the channel is enabled
+	 */
+	bool isChannelEnabled(uint8_t channel) const
+	{
+		return isSubBandEnabled((channel / 8) + 1);
+	}
+
+	/**
+	 * @brief Number of enabled sub-bands
+	 * @return uint8_t number of enabled sub-bands
+	 */
+	uint8_t numSubBands(void) const
+	{
+		uint8_t num = 0;
+		for (uint16_t mask = bits; mask != 0; mask &= mask - 1)
+		{
+			num++;
+		}
+		return num;
+	}
+};
+
 // #define DEBUG_MODE
 
 /**
@@ -230,14 +366,14 @@ public:
 	uint8_t getLPMLevel(void);
 
 	/**    
-	 * @brief Set the device to LoRaWAN mode or LoRa P2P mode    
+	 * @brief Set the device to LoRaWAN mode, LoRa P2P mode or FSK P2P mode    
 	 * See [AT+NWM](https://docs.rakwireless.com/RUI3/Serial-Operating-Modes/AT-Command-Manual/#at-nwm)    
 	 * When switching the device mode, the device will perform a reset
 	 *    
 	 * ```cpp    
 	 * bool setWorkingMode(int mode);    
 	 * ```    
-	 * @param mode 0 = LoRa P2P, 1 = LoRaWAN mode    
+	 * @param mode 0 = LoRa P2P, 1 = LoRaWAN mode, 2 = FSK P2P    
 	 * @return true Success    
 	 * @return false No response or error response
 	 *    
@@ -258,7 +394,7 @@ public:
 	 * ```cpp    
 	 * uint8_t getWorkingMode(void);    
 	 * ```    
-	 * @return uint8_t 0 = LoRa P2P, 1 = LoRaWAN mode 255 = no response from WisDuo
+	 * @return uint8_t 0 = LoRa P2P, 1 = LoRaWAN mode, 2 = FSK P2P, 255 = no response from WisDuo
 	 *    
 	 * @par Usage    
 	 * @code    
@@ -516,12 +652,13 @@ public:
 	 */
 	uint8_t getConfirmed(void);
 
+#if RUI3_NO_HEAP == 0
 	/**    
 	 * @brief Set LoRaWAN credentials for OTAA join mode    
 	 * Before using this command, you must call setJoinMode(0)
 	 *    
 	 * ```cpp    
-	 * bool initOTAA(String devEUI, String appEUI, String appKEY);    
+	 * bool initOTAA(const String &devEUI, const String &appEUI, const String &appKEY);    
 	 * ```    
 	 * @param devEUI device EUI as string see [AT+DEVEUI](https://docs.rakwireless.com/RUI3/Serial-Operating-Modes/AT-Command-Manual/#at-deveui)    
 	 * @param appEUI application EUI as string see [AT+APPEUI](https://docs.rakwireless.com/RUI3/Serial-Operating-Modes/AT-Command-Manual/#at-appeui)    
@@ -540,7 +677,79 @@ public:
 	 * }    
 	 * @endcode
 	 */
-	bool initOTAA(String devEUI, String appEUI, String appKEY);
+	bool initOTAA(const String &devEUI, const String &appEUI, const String &appKEY);
+#endif
+
+	/**
+	 * @brief Set LoRaWAN credentials for OTAA join mode from char arrays
+	 * Same as initOTAA(String devEUI, String appEUI, String appKEY), but without dynamic memory allocation
+	 *
+	 * ```cpp
+	 * bool initOTAA(const char *devEUI, const char *appEUI, const char *appKEY);
+	 * ```
+	 * @param devEUI device EUI as HEX string with 16 characters
+	 * @param appEUI application EUI as HEX string with 16 characters
+	 * @param appKEY application key as HEX string with 32 characters
+	 * @return true Success
+	 * @return false Wrong parameter length, no response or error response
+	 *
+	 * @par Usage
+	 * @code
+	 * if (!wisduo.initOTAA("AC1F09FFFE000000", "AC1F09FFFE000000", "EFADFF0000004829ACF71E1A6E000000"))
+	 * {
+	 * 		Serial.println("Set OTAA credentials failed.");
+	 * }
+	 * @endcode
+	 */
+	bool initOTAA(const char *devEUI, const char *appEUI, const char *appKEY);
+
+	/**
+	 * @brief Set LoRaWAN credentials for OTAA join mode from byte arrays
+	 * The size of the arrays is checked by the compiler
+	 *
+	 * ```cpp
+	 * bool initOTAA(const uint8_t (&devEUI)[8], const uint8_t (&appEUI)[8], const uint8_t (&appKEY)[16]);
+	 * ```
+	 * @param devEUI device EUI, 8 bytes
+	 * @param appEUI application EUI, 8 bytes
+	 * @param appKEY application key, 16 bytes
+	 * @return true Success
+	 * @return false No response or error response
+	 *
+	 * @par Usage
+	 * @code
+	 * uint8_t dev_eui[8] = {0xAC, 0x1F, 0x09, 0xFF, 0xFE, 0x00, 0x00, 0x00};
+	 * uint8_t app_eui[8] = {0xAC, 0x1F, 0x09, 0xFF, 0xFE, 0x00, 0x00, 0x00};
+	 * uint8_t app_key[16] = {0xEF, 0xAD, 0xFF, 0x00, 0x00, 0x00, 0x48, 0x29, 0xAC, 0xF7, 0x1E, 0x1A, 0x6E, 0x00, 0x00, 0x00};
+	 * wisduo.initOTAA(dev_eui, app_eui, app_key);
+	 * @endcode
+	 */
+	bool initOTAA(const uint8_t (&devEUI)[8], const uint8_t (&appEUI)[8], const uint8_t (&appKEY)[16]);
+
+	/**
+	 * @brief Set LoRaWAN credentials for OTAA join mode from keys created with hexKey()
+	 *
+	 * ```cpp
+	 * bool initOTAA(const rui3_key<8> &devEUI, const rui3_key<8> &appEUI, const rui3_key<16> &appKEY);
+	 * ```
+	 * @param devEUI device EUI
+	 * @param appEUI application EUI
+	 * @param appKEY application key
+	 * @return true Success
+	 * @return false No response or error response
+	 *
+	 * @par Usage
+	 * @code
+	 * constexpr rui3_key<8> dev_eui = hexKey("AC1F09FFFE000000");
+	 * constexpr rui3_key<8> app_eui = hexKey("AC1F09FFFE000000");
+	 * constexpr rui3_key<16> app_key = hexKey("EFADFF0000004829ACF71E1A6E000000");
+	 * wisduo.initOTAA(dev_eui, app_eui, app_key);
+	 * @endcode
+	 */
+	bool initOTAA(const rui3_key<8> &devEUI, const rui3_key<8> &appEUI, const rui3_key<16> &appKEY)
+	{
+		return initOTAA(devEUI.bytes, appEUI.bytes, appKEY.bytes);
+	}
 
 	/**    
 	 * @brief Get the DevEUI    
@@ -638,12 +847,13 @@ public:
 	 */
 	bool getAppKey(char *key, uint16_t array_len);
 
+#if RUI3_NO_HEAP == 0
 	/**    
 	 * @brief Set credentials for ABP join mode    
 	 * Before using this command, you must call setJoinMode(1)
 	 *    
 	 * ```cpp    
-	 * bool initABP(String devADDR, String nwksKEY, String appsKEY);    
+	 * bool initABP(const String &devADDR, const String &nwksKEY, const String &appsKEY);    
 	 * ```    
 	 * @param devADDR device address as HEX string see [AT+DEVADDR](https://docs.rakwireless.com/RUI3/Serial-Operating-Modes/AT-Command-Manual/#at-devaddr)    
 	 * @param nwksKEY network Session Key as a HEX string see [AT+NWKSKEY](https://docs.rakwireless.com/RUI3/Serial-Operating-Modes/AT-Command-Manual/#at-nwkskey)    
@@ -662,7 +872,72 @@ public:
 	 * }    
 	 * @endcode
 	 */
-	bool initABP(String devADDR, String nwksKEY, String appsKEY);
+	bool initABP(const String &devADDR, const String &nwksKEY, const String &appsKEY);
+#endif
+
+	/**
+	 * @brief Set credentials for ABP join mode from char arrays
+	 * Same as initABP(String devADDR, String nwksKEY, String appsKEY), but without dynamic memory allocation
+	 *
+	 * ```cpp
+	 * bool initABP(const char *devADDR, const char *nwksKEY, const char *appsKEY);
+	 * ```
+	 * @param devADDR device address as HEX string with 8 characters
+	 * @param nwksKEY network session key as HEX string with 32 characters
+	 * @param appsKEY application session key as HEX string with 32 characters
+	 * @return true Success
+	 * @return false Wrong parameter length, no response or error response
+	 *
+	 * @par Usage
+	 * @code
+	 * if (!wisduo.initABP("01360085", "616a6b21d7fcb25012d62b38a5829725", "f55a71bcc94ec6498511007c64a06c02"))
+	 * {
+	 * 		Serial.println("Set ABP credentials failed.");
+	 * }
+	 * @endcode
+	 */
+	bool initABP(const char *devADDR, const char *nwksKEY, const char *appsKEY);
+
+	/**
+	 * @brief Set credentials for ABP join mode from binary values
+	 * The size of the arrays is checked by the compiler
+	 *
+	 * ```cpp
+	 * bool initABP(uint32_t devADDR, const uint8_t (&nwksKEY)[16], const uint8_t (&appsKEY)[16]);
+	 * ```
+	 * @param devADDR device address
+	 * @param nwksKEY network session key, 16 bytes
+	 * @param appsKEY application session key, 16 bytes
+	 * @return true Success
+	 * @return false No response or error response
+	 */
+	bool initABP(uint32_t devADDR, const uint8_t (&nwksKEY)[16], const uint8_t (&appsKEY)[16]);
+
+	/**
+	 * @brief Set credentials for ABP join mode from keys created with hexKey()
+	 *
+	 * ```cpp
+	 * bool initABP(const rui3_key<4> &devADDR, const rui3_key<16> &nwksKEY, const rui3_key<16> &appsKEY);
+	 * ```
+	 * @param devADDR device address
+	 * @param nwksKEY network session key
+	 * @param appsKEY application session key
+	 * @return true Success
+	 * @return false No response or error response
+	 *
+	 * @par Usage
+	 * @code
+	 * constexpr rui3_key<4> dev_addr = hexKey("01360085");
+	 * constexpr rui3_key<16> nwks_key = hexKey("616a6b21d7fcb25012d62b38a5829725");
+	 * constexpr rui3_key<16> apps_key = hexKey("f55a71bcc94ec6498511007c64a06c02");
+	 * wisduo.initABP(dev_addr, nwks_key, apps_key);
+	 * @endcode
+	 */
+	bool initABP(const rui3_key<4> &devADDR, const rui3_key<16> &nwksKEY, const rui3_key<16> &appsKEY)
+	{
+		return initABP(((uint32_t)devADDR.bytes[0] << 24) | ((uint32_t)devADDR.bytes[1] << 16) | ((uint32_t)devADDR.bytes[2] << 8) | devADDR.bytes[3],
+					   nwksKEY.bytes, appsKEY.bytes);
+	}
 
 	/**    
 	 * @brief Get the DevAddr    
@@ -830,6 +1105,7 @@ public:
 	 */
 	bool getJoinStatus(void);
 
+#if RUI3_NO_HEAP == 0
 	/**    
 	 * @brief Get the current channel list settings    
 	 * This feature works only in Regions US915, AU915 or CN470    
@@ -841,6 +1117,105 @@ public:
 	 * @return String List of enabled channels
 	 */
 	String getChannelList(void);
+#endif
+
+	/**
+	 * @brief Get the current channel list settings into a char array
+	 * Same as getChannelList(void), but without dynamic memory allocation
+	 * This feature works only in Regions US915, AU915 or CN470
+	 * See [AT+MASK](https://docs.rakwireless.com/RUI3/Serial-Operating-Modes/AT-Command-Manual/#at-mask)
+	 *
+	 * ```cpp
+	 * bool getChannelList(char *list, uint16_t list_len);
+	 * ```
+	 * @param list char array for the channel mask
+	 * @param list_len size of the char array
+	 * @return true Success
+	 * @return false No response, error response or the char array is too small
+	 *
+	 * @par Usage
+	 * @code
+	 * char mask[8];
+	 * if (wisduo.getChannelList(mask, ARRAY_SIZE(mask)))
+	 * {
+	 * 	Serial.printf("Channel mask %s\r\n", mask);
+	 * }
+	 * @endcode
+	 */
+	bool getChannelList(char *list, uint16_t list_len);
+
+	/**
+	 * @brief Get the current channel mask
+	 * This feature works only in Regions US915, AU915 or CN470
+	 * See [AT+MASK](https://docs.rakwireless.com/RUI3/Serial-Operating-Modes/AT-Command-Manual/#at-mask)
+	 *
+	 * ```cpp
+	 * bool getChannelMask(channel_mask &mask);
+	 * ```
+	 * @param mask structure for the channel mask
+	 * @return true Success
+	 * @return false No response or error response
+	 *
+	 * @par Usage
+	 * @code
+	 * channel_mask mask;
+	 * if (wisduo.getChannelMask(mask))
+	 * {
+	 * 	for (uint8_t sub_band = 1; sub_band <= 8; sub_band++)
+	 * 	{
+	 * 		Serial.printf("Sub-band %d %s\r\n", sub_band, mask.isSubBandEnabled(sub_band) ? "on" : "off");
+	 * 	}
+	 * }
+	 * @endcode
+	 */
+	bool getChannelMask(channel_mask &mask);
+
+	/**
+	 * @brief Set the channel mask
+	 * This feature works only in Regions US915, AU915 or CN470
+	 * See [AT+MASK](https://docs.rakwireless.com/RUI3/Serial-Operating-Modes/AT-Command-Manual/#at-mask)
+	 *
+	 * ```cpp
+	 * bool setChannelMask(const channel_mask &mask);
+	 * ```
+	 * @param mask channel mask, at least one sub-band must be enabled
+	 * @return true Success
+	 * @return false Empty mask, no response or error response
+	 *
+	 * @par Usage
+	 * @code
+	 * channel_mask mask;
+	 * mask.clear();
+	 * mask.enableSubBand(2);
+	 * if (!wisduo.setChannelMask(mask))
+	 * {
+	 * 	Serial.printf("Response: %s\r\n", wisduo.ret);
+	 * }
+	 * @endcode
+	 */
+	bool setChannelMask(const channel_mask &mask);
+
+	/**
+	 * @brief Restrict the device to a single sub-band (8 channels)
+	 * Use the sub-band of the gateway to speed up the join process
+	 * This feature works only in Regions US915, AU915 or CN470
+	 *
+	 * ```cpp
+	 * bool setSubBand(uint8_t sub_band);
+	 * ```
+	 * @param sub_band sub-band 1 to 16 (1 to 8 for US915 and AU915, 1 to 12 for CN470)
+	 * @return true Success
+	 * @return false Invalid sub-band, no response or error response
+	 *
+	 * @par Usage
+	 * @code
+	 * if (!wisduo.setSubBand(2)) // Gateways with channels 8 to 15 (TTN US915)
+	 * {
+	 * 	Serial.printf("Response: %s\r\n", wisduo.ret);
+	 * }
+	 * @endcode
+	 */
+	bool setSubBand(uint8_t sub_band);
 
 	/**    
 	 * @brief Send data in LoRaWAN mode    
@@ -877,6 +1252,30 @@ public:
 	 */
 	bool sendData(int port, char *datahex);
 
+	/**
+	 * @brief Send a byte array in LoRaWAN mode
+	 * Same as sendData(int port, char *datahex), the payload is converted to HEX directly into the command buffer
+	 *
+	 * ```cpp
+	 * bool sendData(uint8_t port, const uint8_t *data, uint16_t data_len);
+	 * ```
+	 * @param port fPort number (1-223)
+	 * @param data payload
+	 * @param data_len payload length
+	 * @return true Success
+	 * @return false No response or error response
+	 *
+	 * @par Usage
+	 * @code
+	 * uint8_t payload[] = {0x01, 0x74, 0x01, 0x6e};
+	 * if (wisduo.sendData(1, payload, sizeof(payload)))
+	 * {
+	 * 	wisduo.waitTxDone();
+	 * }
+	 * @endcode
+	 */
+	bool sendData(uint8_t port, const uint8_t *data, uint16_t data_len);
+
 	/**    
 	 * @brief Initialize LoRa P2P mode    
 	 * See [AT+P2P](https://docs.rakwireless.com/RUI3/Serial-Operating-Modes/AT-Command-Manual/#at-p2p)
@@ -966,69 +1365,301 @@ public:
 	 */
 	bool getP2P(p2p_settings *p2p_settings);
 
-	/**    
-	 * @brief Send a data packet over LoRa P2P    
-	 * See [AT+PSEND](https://docs.rakwireless.com/RUI3/Serial-Operating-Modes/AT-Command-Manual/#at-psend)
-	 *    
-	 * ```cpp    
-	 * bool sendP2PData(char *datahex);    
-	 * ```    
-	 * @param datahex payload in byte array    
-	 * @return true Success    
-	 * @return false No response or error response    
-	 *     
-	 * @par Usage    
-	 * @code    
-	 * char buffer[] = "0174016e06688c0767011a087327560902fd98";    
-	 * if (wisduo.sendData(1, buffer))    
-	 * {    
-	 * 	// Wait for TX finished or error    
-	 * 	if (wisduo.recvResponse(60000))    
-	 * 	{    
-	 * 		Serial.printf("TX success - RX: %s\r\n", wisduo.ret);    
-	 * 	}    
-	 * 	else    
-	 * 	{    
-	 * 		Serial.printf("TX failed: %s\r\n", wisduo.ret);    
-	 * 	}    
-	 * }    
-	 * else    
-	 * {    
-	 * 	Serial.println("Error while trying to send a packet");    
-	 * }    
+	/**
+	 * @brief Get the P2P settings without a query to the module
+	 * The settings are cached from initP2P(), getP2P(), updateP2P() and the single parameter setters
+	 *
+	 * ```cpp
+	 * bool getP2PSettings(p2p_settings *p2p_settings);
+	 * ```
+	 * @param p2p_settings pointer to settings for P2P configuration
+	 * @return true Success
+	 * @return false Settings not known and the query failed
+	 */
+	bool getP2PSettings(p2p_settings *p2p_settings);
+
+	/**
+	 * @brief Change the P2P settings, only the changed parameters are sent
+	 * If one parameter changed it is sent with its own command, if more parameters changed all are sent with AT+P2P
+	 *
+	 * ```cpp
+	 * bool updateP2P(p2p_settings *p2p_settings);
+	 * ```
+	 * @param p2p_settings pointer to the structure with the P2P settings
+	 * @return true Success
+	 * @return false No response or error response
+	 *
+	 * @par Usage
+	 * @code
+	 * p2p_settings p2p_sett;
+	 * wisduo.getP2PSettings(&p2p_sett);
+	 * p2p_sett.freq = 916300000;
+	 * wisduo.updateP2P(&p2p_sett); // Sends only AT+PFREQ=916300000
 	 * @endcode
 	 */
-	bool sendP2PData(char *datahex);
+	bool updateP2P(p2p_settings *p2p_settings);
 
-	/**    
-	 * @brief Enable or disable P2P Channel Activitity Detection    
-	 * See [AT+CAD](https://docs.rakwireless.com/RUI3/Serial-Operating-Modes/AT-Command-Manual/#at-cad)
-	 *    
-	 * @param enable true = CAD enabled, false = CAD disabled    
-	 * @return true Success    
+	/**
+	 * @brief Set the P2P frequency, in FSK P2P mode the FSK frequency
+	 * See [AT+PFREQ](https://docs.rakwireless.com/RUI3/Serial-Operating-Modes/AT-Command-Manual/#at-pfreq)
+	 *
+	 * ```cpp
+	 * bool setP2PFrequency(uint32_t freq);
+	 * ```
+	 * @param freq frequency in Hz, 150000000-960000000 Hz
+	 * @return true Success or frequency already set
 	 * @return false No response or error response
-	 *    
-	 * @par Usage    
-	 * @code    
-	 * if (wisduo.setP2PCAD(true))    
-	 * {    
-	 * 	Serial.printf("CAD enabled\r\n");    
-	 * }    
-	 * else    
-	 * {    
-	 * 	Serial.printf("Response: %d\r\n", wisduo.ret);    
-	 * }    
+	 *
+	 * @par Usage
+	 * @code
+	 * // Channel hopping, one short command per hop
+	 * wisduo.setP2PFrequency(916100000 + hop * 200000);
 	 * @endcode
 	 */
-	bool setP2PCAD(bool enable);
+	bool setP2PFrequency(uint32_t freq);
 
-	/**    
-	 * @brief Get CAD status (enabled/disabled)
-	 *    
-	 * @return true CAD enabled    
-	 * @return false CAD disabled
-	 *    
-	 * @par Usage    
+	/**
+	 * @brief Set the P2P spreading factor
+	 * See [AT+PSF](https://docs.rakwireless.com/RUI3/Serial-Operating-Modes/AT-Command-Manual/#at-psf)
+	 *
+	 * ```cpp
+	 * bool setP2PSF(uint16_t sf);
+	 * ```
+	 * @param sf spreading factor 6 - 12
+	 * @return true Success or spreading factor already set
+	 * @return false No response or error response
+	 */
+	bool setP2PSF(uint16_t sf);
+
+	/**
+	 * @brief Set the P2P bandwidth
+	 * See [AT+PBW](https://docs.rakwireless.com/RUI3/Serial-Operating-Modes/AT-Command-Manual/#at-pbw)
+	 * AT+PBW supports 125, 250 and 500 kHz, the other bandwidths are set with AT+P2P
+	 *
+	 * ```cpp
+	 * bool setP2PBandwidth(uint16_t bw);
+	 * ```
+	 * @param bw bandwidth 0=125kHz, 1=250kHz, 2=500kHz, 3=7.8kHz, 4=10.4kHz, 5=15.63kHz, 6=20.83kHz, 7=31.25kHz, 8=41.67kHz, 9=62.5kHz
+	 * @return true Success or bandwidth already set
+	 * @return false No response or error response
+	 */
+	bool setP2PBandwidth(uint16_t bw);
+
+	/**
+	 * @brief Set the P2P coding rate
+	 * See [AT+PCR](https://docs.rakwireless.com/RUI3/Serial-Operating-Modes/AT-Command-Manual/#at-pcr)
+	 *
+	 * ```cpp
+	 * bool setP2PCR(uint16_t cr);
+	 * ```
+	 * @param cr coding rate 0 = 4/5, 1 = 4/6, 2 = 4/7, 3 = 4/8
+	 * @return true Success or coding rate already set
+	 * @return false No response or error response
+	 */
+	bool setP2PCR(uint16_t cr);
+
+	/**
+	 * @brief Set the P2P preamble length
+	 * See [AT+PPL](https://docs.rakwireless.com/RUI3/Serial-Operating-Modes/AT-Command-Manual/#at-ppl)
+	 *
+	 * ```cpp
+	 * bool setP2PPreamble(uint16_t ppl);
+	 * ```
+	 * @param ppl preamble length 2-65535
+	 * @return true Success or preamble length already set
+	 * @return false No response or error response
+	 */
+	bool setP2PPreamble(uint16_t ppl);
+
+	/**
+	 * @brief Set the P2P TX power, in FSK P2P mode the FSK TX power
+	 * See [AT+PTP](https://docs.rakwireless.com/RUI3/Serial-Operating-Modes/AT-Command-Manual/#at-ptp)
+	 *
+	 * ```cpp
+	 * bool setP2PTXPower(uint16_t txp);
+	 * ```
+	 * @param txp TX power 5 - 22
+	 * @return true Success or TX power already set
+	 * @return false No response or error response
+	 */
+	bool setP2PTXPower(uint16_t txp);
+
+	/**
+	 * @brief Initialize FSK P2P mode, the module has to be in FSK P2P mode (setWorkingMode(FSKP2P))
+	 * See [AT+PBR](https://docs.rakwireless.com/RUI3/Serial-Operating-Modes/AT-Command-Manual/#at-pbr)
+	 * and [AT+PFDEV](https://docs.rakwireless.com/RUI3/Serial-Operating-Modes/AT-Command-Manual/#at-pfdev)
+	 *
+	 * FSK configuration is set in a structure:
+	 * @code
+	 * typedef struct _fsk_settings
+	 * {
+	 * 	uint32_t freq;	  // Frequency in Hz, 150000000-960000000 Hz
+	 * 	uint32_t bitrate; // Bitrate in b/s, 600-300000
+	 * 	uint32_t fdev;	  // Frequency deviation in Hz, 600-200000
+	 * 	uint32_t bw;	  // RX bandwidth in Hz, 4800-467000
+	 * 	uint16_t txp;	  // TX power 5 - 22
+	 * } fsk_settings;
+	 * @endcode
+	 * ```cpp
+	 * bool initFSK(fsk_settings *fsk_settings);
+	 * ```
+	 * @param fsk_settings pointer to the structure with the FSK settings
+	 * @return true Success
+	 * @return false No response or error response
+	 *
+	 * @par Usage
+	 * @code
+	 * fsk_settings fsk_sett = {916100000, 50000, 25000, 117000, 22};
+	 * if (wisduo.getWorkingMode() != FSKP2P)
+	 * {
+	 * 	wisduo.setWorkingMode(FSKP2P);
+	 * 	// ... wait for the module reset
+	 * }
+	 * if (!wisduo.initFSK(&fsk_sett))
+	 * {
+	 * 	Serial.printf("Response: %s\r\n", wisduo.ret);
+	 * }
+	 * @endcode
+	 */
+	bool initFSK(fsk_settings *fsk_settings);
+
+	/**
+	 * @brief Change the FSK settings, only the changed parameters are sent
+	 *
+	 * ```cpp
+	 * bool updateFSK(fsk_settings *fsk_settings);
+	 * ```
+	 * @param fsk_settings pointer to the structure with the FSK settings
+	 * @return true Success
+	 * @return false No response or error response
+	 */
+	bool updateFSK(fsk_settings *fsk_settings);
+
+	/**
+	 * @brief Get the current FSK settings
+	 *
+	 * ```cpp
+	 * bool getFSK(fsk_settings *fsk_settings);
+	 * ```
+	 * @param fsk_settings pointer to settings for the FSK configuration
+	 * @return true Success
+	 * @return false No response or error response
+	 *
+	 * @par Usage
+	 * @code
+	 * fsk_settings fsk_sett;
+	 * if (wisduo.getFSK(&fsk_sett))
+	 * {
+	 * 	Serial.printf("Bitrate %ld b/s, deviation %ld Hz\r\n", fsk_sett.bitrate, fsk_sett.fdev);
+	 * }
+	 * @endcode
+	 */
+	bool getFSK(fsk_settings *fsk_settings);
+
+	/**    
+	 * @brief Send a data packet over LoRa P2P    
+	 * See [AT+PSEND](https://docs.rakwireless.com/RUI3/Serial-Operating-Modes/AT-Command-Manual/#at-psend)
+	 *    
+	 * ```cpp    
+	 * bool sendP2PData(char *datahex);    
+	 * ```    
+	 * @param datahex payload in byte array    
+	 * @return true Success    
+	 * @return false No response or error response    
+	 *     
+	 * @par Usage    
+	 * @code    
+	 * char buffer[] = "0174016e06688c0767011a087327560902fd98";    
+	 * if (wisduo.sendData(1, buffer))    
+	 * {    
+	 * 	// Wait for TX finished or error    
+	 * 	if (wisduo.recvResponse(60000))    
+	 * 	{    
+	 * 		Serial.printf("TX success - RX: %s\r\n", wisduo.ret);    
+	 * 	}    
+	 * 	else    
+	 * 	{    
+	 * 		Serial.printf("TX failed: %s\r\n", wisduo.ret);    
+	 * 	}    
+	 * }    
+	 * else    
+	 * {    
+	 * 	Serial.println("Error while trying to send a packet");    
+	 * }    
+	 * @endcode
+	 */
+	bool sendP2PData(char *datahex);
+
+	/**
+	 * @brief Send a byte array over LoRa P2P
+	 * Same as sendP2PData(char *datahex), the payload is converted to HEX directly into the command buffer
+	 *
+	 * ```cpp
+	 * bool sendP2PData(const uint8_t *data, uint16_t data_len);
+	 * ```
+	 * @param data payload
+	 * @param data_len payload length
+	 * @return true Success
+	 * @return false Payload too long, no response or error response
+	 *
+	 * @par Usage
+	 * @code
+	 * uint8_t payload[] = {0x01, 0x74, 0x01, 0x6e};
+	 * if (wisduo.sendP2PData(payload, sizeof(payload)))
+	 * {
+	 * 	wisduo.waitTxDone();
+	 * }
+	 * @endcode
+	 */
+	bool sendP2PData(const uint8_t *data, uint16_t data_len);
+
+	/**
+	 * @brief Start or stop P2P RX
+	 * See [AT+PRECV](https://docs.rakwireless.com/RUI3/Serial-Operating-Modes/AT-Command-Manual/#at-precv)
+	 *
+	 * ```cpp
+	 * bool setP2PReceive(uint16_t timeout);
+	 * ```
+	 * @param timeout RX time in milliseconds 1 to 65532, or P2P_RX_OFF, P2P_RX_PERMANENT_TX, P2P_RX_PERMANENT, P2P_RX_SINGLE
+	 * @return true Success
+	 * @return false No response or error response
+	 *
+	 * @par Usage
+	 * @code
+	 * wisduo.setP2PReceive(P2P_RX_PERMANENT_TX); // RX, module returns to RX after each TX
+	 * @endcode
+	 */
+	bool setP2PReceive(uint16_t timeout);
+
+	/**    
+	 * @brief Enable or disable P2P Channel Activitity Detection    
+	 * See [AT+CAD](https://docs.rakwireless.com/RUI3/Serial-Operating-Modes/AT-Command-Manual/#at-cad)
+	 *    
+	 * @param enable true = CAD enabled, false = CAD disabled    
+	 * @return true Success    
+	 * @return false No response or error response
+	 *    
+	 * @par Usage    
+	 * @code    
+	 * if (wisduo.setP2PCAD(true))    
+	 * {    
+	 * 	Serial.printf("CAD enabled\r\n");    
+	 * }    
+	 * else    
+	 * {    
+	 * 	Serial.printf("Response: %d\r\n", wisduo.ret);    
+	 * }    
+	 * @endcode
+	 */
+	bool setP2PCAD(bool enable);
+
+	/**    
+	 * @brief Get CAD status (enabled/disabled)
+	 *    
+	 * @return true CAD enabled    
+	 * @return false CAD disabled
+	 *    
+	 * @par Usage    
 	 * @code    
 	 * if (wisduo.getP2PCAD())    
 	 * {    
@@ -1045,6 +1676,8 @@ public:
 	/**    
 	 * @brief Get response to an AT command from the device    
 	 * The last response to an AT command is stored in _**`RUI3::ret`**_ for further parsing. See the example codes for detailed usage.
+	 * Events other than the end of a transmission, e.g. a received P2P packet, are not added to the response,
+	 * they are kept for pollLine() and recvRX().
 	 *    
 	 * ```cpp    
 	 * bool recvResponse(uint32_t timeout = 10000);    
@@ -1070,10 +1703,149 @@ public:
 	 */
 	bool recvResponse(uint32_t timeout = 10000);
 
+	/**
+	 * @brief Wait for the end of the last transmission started with sendData() or sendP2PData()
+	 * The timeout is calculated from the time-on-air of the packet, a lost TX done event is detected within milliseconds.
+	 * For LoRaWAN the time of the RX windows and the time-on-air of a max downlink at the RX2 datarate are added.
+	 * The datarate set with setDataRate() or read with getDataRate() is used, DR0 if the datarate is not known. Retransmissions of confirmed packets are not included.
+	 * If CAD is enabled (setP2PCAD() or getP2PCAD()), CAD_TX_MARGIN is added for the channel activity detection.
+	 *
+	 * ```cpp
+	 * bool waitTxDone(void);
+	 * ```
+	 * @return true TX finished
+	 * @return false No TX done event within the expected time or error response
+	 *
+	 * @par Usage
+	 * @code
+	 * if (wisduo.sendP2PData(buffer))
+	 * {
+	 * 	if (!wisduo.waitTxDone())
+	 * 	{
+	 * 		Serial.printf("No TX done after %ld ms: %s\r\n", wisduo.getTxTimeout(), wisduo.ret);
+	 * 	}
+	 * }
+	 * @endcode
+	 */
+	bool waitTxDone(void);
+
+	/**
+	 * @brief Set a fixed response timeout for a command class
+	 * By default the timeouts are calculated from the measured response times, like the TCP retransmission timeout.
+	 * The timeout is the smoothed response time plus 4 times its variation, doubled after each timeout
+	 * and limited by setCmdTimeoutLimits(). Until the first response is measured the upper limit is used.
+	 *
+	 * ```cpp
+	 * void setCmdTimeout(uint8_t cls, uint32_t timeout);
+	 * ```
+	 * @param cls command class AT_CLASS_QUERY, AT_CLASS_SET, AT_CLASS_TX, AT_CLASS_RAW or AT_CLASS_FIXED
+	 * @param timeout fixed timeout in milliseconds, 0 to use the adaptive timeout
+	 *
+	 * @par Usage
+	 * @code
+	 * wisduo.setCmdTimeout(AT_CLASS_RAW, 5000); // e.g. for commands with a slow response
+	 * @endcode
+	 */
+	void setCmdTimeout(uint8_t cls, uint32_t timeout);
+
+	/**
+	 * @brief Set the limits of the adaptive response timeout of a command class
+	 *
+	 * ```cpp
+	 * void setCmdTimeoutLimits(uint8_t cls, uint32_t min_timeout, uint32_t max_timeout);
+	 * ```
+	 * @param cls command class, see setCmdTimeout()
+	 * @param min_timeout lower limit in milliseconds, default AT_MIN_TIMEOUT
+	 * @param max_timeout upper limit in milliseconds, default AT_DEF_TIMEOUT
+	 */
+	void setCmdTimeoutLimits(uint8_t cls, uint32_t min_timeout, uint32_t max_timeout);
+
+	/**
+	 * @brief Get the current response timeout of a command class
+	 *
+	 * ```cpp
+	 * uint32_t getCmdTimeout(uint8_t cls);
+	 * ```
+	 * @param cls command class, see setCmdTimeout()
+	 * @return uint32_t timeout in milliseconds, 0 if the class is invalid
+	 */
+	uint32_t getCmdTimeout(uint8_t cls);
+
+	/**
+	 * @brief Get the smoothed response time of a command class
+	 *
+	 * ```cpp
+	 * uint32_t getCmdLatency(uint8_t cls);
+	 * ```
+	 * @param cls command class, see setCmdTimeout()
+	 * @return uint32_t response time in milliseconds, 0 if nothing was measured yet
+	 *
+	 * @par Usage
+	 * @code
+	 * Serial.printf("Queries take %ld ms, timeout %ld ms\r\n", wisduo.getCmdLatency(AT_CLASS_QUERY), wisduo.getCmdTimeout(AT_CLASS_QUERY));
+	 * @endcode
+	 */
+	uint32_t getCmdLatency(uint8_t cls);
+
+	/**
+	 * @brief Get the TX done timeout of the last transmission
+	 *
+	 * ```cpp
+	 * uint32_t getTxTimeout(void);
+	 * ```
+	 * @return uint32_t timeout in milliseconds used by waitTxDone()
+	 */
+	uint32_t getTxTimeout(void);
+
+	/**
+	 * @brief Get the time-on-air of the last transmission
+	 *
+	 * ```cpp
+	 * uint32_t getTxAirtime(void);
+	 * ```
+	 * @return uint32_t time-on-air in microseconds, 0 if not known
+	 */
+	uint32_t getTxAirtime(void);
+
+	/**
+	 * @brief Get the time-on-air of a P2P packet with the current LoRa or FSK P2P settings
+	 *
+	 * ```cpp
+	 * uint32_t getP2PAirtime(uint16_t payload_len);
+	 * ```
+	 * @param payload_len payload length in bytes
+	 * @return uint32_t time-on-air in microseconds, 0 if the P2P settings are not known
+	 */
+	uint32_t getP2PAirtime(uint16_t payload_len);
+
+	/**
+	 * @brief Read received characters without waiting
+	 * Call it frequently to catch events like +EVT:TX_DONE without blocking. Characters are collected in
+	 * _**`RUI3::ret`**_ until a line is complete. Any command or recvResponse() discards an incomplete line.
+	 * Events read while a command waited for its response are returned first. Up to AT_EVT_BUFFER_LEN bytes
+	 * of events are kept, if more arrive during one command they are dropped.
+	 *
+	 * ```cpp
+	 * bool pollLine(void);
+	 * ```
+	 * @return true A complete line without the line end is in _**`RUI3::ret`**_
+	 * @return false No complete line yet
+	 *
+	 * @par Usage
+	 * @code
+	 * if (wisduo.pollLine())
+	 * {
+	 * 	Serial.printf("Event: %s\r\n", wisduo.ret);
+	 * }
+	 * @endcode
+	 */
+	bool pollLine(void);
+
 	/**    
 	 * @brief Get RX packet after LoRaWAN TX or LoRa P2P receive command    
 	 * The last received RX packet is stored in _**`RUI3::ret`**_ for further parsing. See the example codes for detailed usage.         
 	 * In case of LoRa P2P, `recvRX()` can be used to catch any received packet during the specified timeout.         
+	 * A packet received while a command waited for its response is returned first.
 	 * In case of LoRaWAN Class A, the received data is in _**`RUI3::ret`**_ after the `recvResponse()` call.         
 	 * LoRaWAN Class B and C RX is not implemented, but would work similar to LoRa P2P     
 	 *    
@@ -1211,7 +1983,7 @@ public:
 	 * See [RUI3 AT command manual](https://docs.rakwireless.com/RUI3/Serial-Operating-Modes/AT-Command-Manual)
 	 *    
 	 * ```cpp    
-	 * bool sendRawCommand(char *command);    
+	 * bool sendRawCommand(const char *command);    
 	 * ```    
 	 * @param command char array with any of the RUI3 AT commands    
 	 * @return true Success    
@@ -1233,7 +2005,39 @@ public:
 	 * }    
 	 * @endcode
 	 */
-	bool sendRawCommand(char *command);
+	bool sendRawCommand(const char *command);
+
+	/**
+	 * @brief Enable or disable the flush before each command
+	 * By default an empty line is sent before each command and the RX buffer is read until the module answers
+	 * or for the adaptive query timeout, at most AT_FLUSH_TIMEOUT (1 second). This clears an incomplete command and
+	 * stale responses, but it drops unread events and the wait is added to every command.
+	 * Disable it only while all responses and events are read, e.g. with pollLine().
+	 *
+	 * ```cpp
+	 * void setCmdFlush(bool enable);
+	 * ```
+	 * @param enable true to flush before each command (default), false to send the command immediately
+	 *
+	 * @par Usage
+	 * @code
+	 * wisduo.setCmdFlush(false);
+	 * // ... commands in a fast sequence
+	 * wisduo.setCmdFlush(true);
+	 * @endcode
+	 */
+	void setCmdFlush(bool enable);
+
+	/**
+	 * @brief Check if the RX buffer is flushed before each command
+	 *
+	 * ```cpp
+	 * bool getCmdFlush(void);
+	 * ```
+	 * @return true Flush before each command
+	 * @return false Commands are sent immediately
+	 */
+	bool getCmdFlush(void);
 
 	/**    
 	 * @brief Convert a byte array into a ASCII HEX string array
@@ -1298,26 +2102,440 @@ public:
 	 */
 	bool asciiArrayToByte(char *b_array, char *a_array, uint16_t b_array_len, uint16_t a_array_len);
 
+	/**
+	 * @brief Query any RUI3 AT command and parse the returned value
+	 * Allows to use RUI3 AT commands that have no dedicated function in this library.
+	 * See [RUI3 AT command manual](https://docs.rakwireless.com/RUI3/Serial-Operating-Modes/AT-Command-Manual)
+	 *
+	 * ```cpp
+	 * template <typename T> bool query(const char *cmd, T &value);
+	 * ```
+	 * @param cmd command name without the "AT+", e.g. "ADR"
+	 * @param value variable for the result, supported are integer types, bool, at_hex (HEX strings) and at_tuple (colon separated values)
+	 * @return true Success
+	 * @return false No response, error response or the value could not be parsed
+	 *
+	 * @par Usage
+	 * @code
+	 * int rssi;
+	 * if (wisduo.query("RSSI", rssi))
+	 * {
+	 * 	Serial.printf("RSSI %d\r\n", rssi);
+	 * }
+	 * at_tuple p2p;
+	 * if (wisduo.query("P2P", p2p))
+	 * {
+	 * 	Serial.printf("Frequency %ld SF %ld\r\n", p2p.val[0], p2p.val[1]);
+	 * }
+	 * @endcode
+	 */
+	template <typename T>
+	bool query(const char *cmd, T &value)
+	{
+		char *str_ptr = queryRaw(cmd);
+		if (str_ptr == NULL)
+		{
+			return false;
+		}
+		return at_value<T>::parse(str_ptr, value);
+	}
+
+	/**
+	 * @brief Set the value of any RUI3 AT command
+	 * Allows to use RUI3 AT commands that have no dedicated function in this library.
+	 * See [RUI3 AT command manual](https://docs.rakwireless.com/RUI3/Serial-Operating-Modes/AT-Command-Manual)
+	 *
+	 * ```cpp
+	 * template <typename T> bool set(const char *cmd, const T &value);
+	 * ```
+	 * @param cmd command name without the "AT+", e.g. "TXP"
+	 * @param value value to set, supported are integer types, bool, at_hex (HEX strings), at_tuple (colon separated values) and char arrays
+	 * @return true Success
+	 * @return false No response, error response or the value does not fit into the command buffer
+	 *
+	 * @par Usage
+	 * @code
+	 * if (!wisduo.set("TXP", 7))
+	 * {
+	 * 	Serial.printf("Response: %s\r\n", wisduo.ret);
+	 * }
+	 * wisduo.set("ADR", true);
+	 * @endcode
+	 */
+	template <typename T>
+	bool set(const char *cmd, const T &value)
+	{
+		uint16_t len = rawPrefix(cmd);
+		if (len == 0)
+		{
+			return false;
+		}
+		int16_t arg_len = at_value<T>::format(&cmdBuffer()[len], AT_CMD_BUFFER_LEN - len - 2, value);
+		if (arg_len < 0)
+		{
+			return false;
+		}
+		return rawTransact(len + arg_len);
+	}
+
+	/**
+	 * @brief Set the value of any RUI3 AT command as string
+	 *
+	 * ```cpp
+	 * bool set(const char *cmd, const char *value);
+	 * ```
+	 * @param cmd command name without the "AT+", e.g. "CHS"
+	 * @param value value as string
+	 * @return true Success
+	 * @return false No response, error response or the value does not fit into the command buffer
+	 */
+	bool set(const char *cmd, const char *value);
+
 	/** @brief Char array with the last response from the WisDuo module */
 	char ret[1024] = {0};
 
 	stParam param;
 
 private:
+	/**
+	 * @brief Write the command prefix "at+xxx=" into the command buffer
+	 *
+	 * @param cmd command ID
+	 * @return uint16_t length of the prefix
+	 */
+	uint16_t atPrefix(at_cmd_id cmd);
+
+	/**
+	 * @brief Terminate the command in the command buffer and send it
+	 *
+	 * @param cmd command ID
+	 * @param len length of the command including arguments
+	 * @return true Success
+	 * @return false Failed to send the command
+	 */
+	bool atSend(at_cmd_id cmd, uint16_t len);
+
+	/**
+	 * @brief Send the command in the command buffer and wait for OK
+	 *
+	 * @param cmd command ID
+	 * @param len length of the command including arguments
+	 * @return true Success
+	 * @return false No response or error response
+	 */
+	bool atTransact(at_cmd_id cmd, uint16_t len);
+
+	/**
+	 * @brief Execute a command with a string argument
+	 *
+	 * @param cmd command ID
+	 * @param arg argument as string, NULL for commands without argument
+	 * @return true Success
+	 * @return false No response or error response
+	 */
+	bool atExec(at_cmd_id cmd, const char *arg);
+
+	/**
+	 * @brief Execute a command with an integer argument
+	 *
+	 * @param cmd command ID
+	 * @param value argument
+	 * @return true Success
+	 * @return false No response or error response
+	 */
+	bool atExec(at_cmd_id cmd, int32_t value);
+
+	/**
+	 * @brief Send the query of a command
+	 *
+	 * @param cmd command ID
+	 * @return char* pointer to the value after the '=' in the response, NULL if no valid response
+	 */
+	char *atQuery(at_cmd_id cmd);
+
+	/**
+	 * @brief Send the query of a command and parse the value according to the response type
+	 *
+	 * @param cmd command ID
+	 * @return int32_t parsed value, -1 if no valid response
+	 */
+	int32_t atQueryValue(at_cmd_id cmd);
+
+	/**
+	 * @brief Execute a command with a byte array as HEX string argument
+	 *
+	 * @param cmd command ID
+	 * @param data byte array
+	 * @param len number of bytes
+	 * @return true Success
+	 * @return false No response or error response
+	 */
+	bool atExecHex(at_cmd_id cmd, const uint8_t *data, uint16_t len);
+
+	/**
+	 * @brief Parse a HEX string credential of a fixed length
+	 *
+	 * @param hex HEX string
+	 * @param data byte array for the result
+	 * @param len expected number of bytes
+	 * @return true HEX string has the expected length
+	 * @return false wrong length or invalid characters
+	 */
+	bool parseCredential(const char *hex, uint8_t *data, uint16_t len);
+
+	/**
+	 * @brief Get the buffer for outgoing commands
+	 *
+	 * @return char* command buffer of size AT_CMD_BUFFER_LEN
+	 */
+	char *cmdBuffer(void);
+
+	/**
+	 * @brief Append a string to the command buffer
+	 *
+	 * @param len current length of the command, updated with the new length
+	 * @param str string to append
+	 * @return true Success
+	 * @return false String does not fit into the command buffer
+	 */
+	bool cmdAppend(uint16_t &len, const char *str);
+
+	/**
+	 * @brief Append a signed integer as decimal string to the command buffer
+	 *
+	 * @param len current length of the command, updated with the new length
+	 * @param value value to append
+	 * @return true Success
+	 * @return false Value does not fit into the command buffer
+	 */
+	bool cmdAppendInt(uint16_t &len, int32_t value);
+
+	/**
+	 * @brief Append an unsigned integer as decimal string to the command buffer
+	 *
+	 * @param len current length of the command, updated with the new length
+	 * @param value value to append
+	 * @return true Success
+	 * @return false Value does not fit into the command buffer
+	 */
+	bool cmdAppendUint(uint16_t &len, uint32_t value);
+
+	/**
+	 * @brief Append a byte array as HEX string to the command buffer
+	 *
+	 * @param len current length of the command, updated with the new length
+	 * @param data byte array
+	 * @param data_len number of bytes
+	 * @return true Success
+	 * @return false Value does not fit into the command buffer
+	 */
+	bool cmdAppendHex(uint16_t &len, const uint8_t *data, uint16_t data_len);
+
+	/**
+	 * @brief Write "at+<cmd>=" into the command buffer
+	 *
+	 * @param cmd command name, with or without leading "AT+"
+	 * @return uint16_t length of the prefix, 0 if the command name is too long
+	 */
+	uint16_t rawPrefix(const char *cmd);
+
+	/**
+	 * @brief Terminate and send the command in the command buffer and wait for OK
+	 *
+	 * @param len length of the command including arguments
+	 * @param cls command class for the response timeout, see at_class
+	 * @return true Success
+	 * @return false No response or error response
+	 */
+	bool rawTransact(uint16_t len, uint8_t cls = AT_CLASS_RAW);
+
+	/**
+	 * @brief Send the query "at+<cmd>=?"
+	 *
+	 * @param cmd command name, with or without leading "AT+"
+	 * @return char* pointer to the value after the '=' in the response, NULL if no valid response
+	 */
+	char *queryRaw(const char *cmd);
+
+	/**
+	 * @brief Send the at+send command in the command buffer and calculate the TX done timeout
+	 *
+	 * @param len length of the command including arguments
+	 * @param payload_len payload length in bytes
+	 * @return true Success
+	 * @return false No response or error response
+	 */
+	bool sendTransact(uint16_t len, uint16_t payload_len);
+
+	/**
+	 * @brief Send the FSK settings
+	 *
+	 * @param fsk_settings FSK settings
+	 * @param all true to send all settings, false to send only the settings that differ from the cache
+	 * @return true Success
+	 * @return false No response or error response
+	 */
+	bool sendFSK(fsk_settings *fsk_settings, bool all);
+
+	/**
+	 * @brief Read the P2P or FSK settings if they are not known, they are needed for the TX done timeout
+	 */
+	void p2pCheckSettings(void);
+
+	/**
+	 * @brief Calculate time-on-air and TX done timeout of a P2P packet
+	 *
+	 * @param payload_len payload length in bytes
+	 */
+	void p2pTxTimeout(uint16_t payload_len);
+
+	/**
+	 * @brief Set one P2P parameter and update the cached settings
+	 *
+	 * @param cmd command of the parameter
+	 * @param value value to send
+	 * @param field cached parameter
+	 * @param cached value for the cached settings
+	 * @return true Success or value already set
+	 * @return false No response or error response
+	 */
+	template <typename T>
+	bool setP2PField(at_cmd_id cmd, int32_t value, T &field, T cached);
+
+	/**
+	 * @brief Set one FSK parameter and update the cached FSK settings
+	 *
+	 * @param cmd command of the parameter
+	 * @param value value to send
+	 * @param field cached parameter
+	 * @return true Success or value already set
+	 * @return false No response or error response
+	 */
+	template <typename T>
+	bool setFSKField(at_cmd_id cmd, T value, T &field);
+
+	/**
+	 * @brief Get the response timeout of a command class
+	 *
+	 * @param cls command class, see at_class
+	 * @return uint32_t timeout in milliseconds
+	 */
+	uint32_t rtoTimeout(uint8_t cls);
+
+	/**
+	 * @brief Update the response time statistics of a command class after recvResponse()
+	 *
+	 * @param cls command class, see at_class
+	 * @param elapsed time between sending the command and the end of the response in milliseconds
+	 */
+	void rtoUpdate(uint8_t cls, uint32_t elapsed);
+
+	/**
+	 * @brief Wait for the response of a command sent by the library, all events are kept for pollLine()
+	 *
+	 * @param timeout time to wait for a response in milliseconds
+	 * @return true Success
+	 * @return false No response or error response
+	 */
+	bool recvCmdResponse(uint32_t timeout);
+
+	/**
+	 * @brief Check if an event line read by recvResponse() is kept for pollLine()
+	 *
+	 * @param line received line
+	 * @return true Event that is not part of the response
+	 * @return false Response or end of a transmission
+	 */
+	bool evtDeferred(const char *line);
+
+	/**
+	 * @brief Keep an event line for pollLine()
+	 *
+	 * @param line event
+	 * @param len length of the line, line ends are removed
+	 */
+	void evtPush(const char *line, uint16_t len);
+
+	/**
+	 * @brief Move the oldest kept event line into ret
+	 *
+	 * @return true Event line without the line end in ret
+	 * @return false No event kept
+	 */
+	bool evtPop(void);
+
+	/**
+	 * @brief Get the value part of the last response
+	 *
+	 * @return char* pointer to the value after the '=' in the response, NULL if there is none
+	 */
+	char *respValue(void);
+
 	Stream &_serial;
 
 	Stream &_serial1;
 
-	String _devADDR = "00112233";
+	uint8_t _devADDR[4] = {0};
+
+	uint8_t _devEUI[8] = {0};
+
+	uint8_t _appEUI[8] = {0};
+
+	uint8_t _nwksKEY[16] = {0};
+
+	uint8_t _appKEY[16] = {0};
+
+	uint8_t _appsKEY[16] = {0};
+
+	/** Last P2P settings sent to or read from the module */
+	p2p_settings _p2p = {0, 0, 0, 0, 0, 0};
+
+	/** True if _p2p is valid */
+	bool _p2p_valid = false;
+
+	/** Last FSK settings sent to or read from the module */
+	fsk_settings _fsk = {0, 0, 0, 0, 0};
+
+	/** True if _fsk is valid */
+	bool _fsk_valid = false;
+
+	/** True if the module is in FSK P2P mode */
+	bool _fsk_mode = false;
+
+	/** Last CAD setting sent to or read from the module */
+	bool _p2p_cad = false;
+
+	/** Last region set or read, NO_RESPONSE if unknown */
+	uint8_t _region = NO_RESPONSE;
+
+	/** Last datarate set or read, NO_RESPONSE if unknown */
+	uint8_t _dr = NO_RESPONSE;
+
+	/** Response time statistics per command class */
+	at_rto _rto[AT_CLASS_NUM];
+
+	/** True if the last recvResponse() ended without a complete response */
+	bool _resp_timeout = false;
+
+	/** TX done timeout of the last transmission in milliseconds */
+	uint32_t _tx_timeout = TX_DONE_TIMEOUT;
+
+	/** Time-on-air of the last transmission in microseconds */
+	uint32_t _tx_airtime = 0;
 
-	String _devEUI = "60C5A8FFFE000001";
+	/** Length of the incomplete line in ret, see pollLine() */
+	uint16_t _line_len = 0;
 
-	String _appEUI = "60C5A8FFFE000001";
+	/** True while recvResponse() waits for the response of a command sent by the library */
+	bool _cmd_resp = false;
 
-	String _nwksKEY = "60C5A8FFFE00000160C5A8FFFE000001";
+	/** Events read while waiting for a response, lines separated by '\n' */
+	char _evt[AT_EVT_BUFFER_LEN];
 
-	String _appKEY = "60C5A8FFFE00000160C5A8FFFE000001";
+	/** Bytes in _evt */
+	uint16_t _evt_len = 0;
 
-	String _appsKEY = "60C5A8FFFE00000160C5A8FFFE000001";
+	/** True if the RX buffer is flushed before each command, see setCmdFlush() */
+	bool _cmd_flush = true;
 };
 #endif // _RUI3_H_
\ No newline at end of file
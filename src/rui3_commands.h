@@ -0,0 +1,140 @@
+/**
+ * @file rui3_commands.h
+ * @author Bernd Giesecke (bernd@giesecke.tk)
+ * @brief Compile-time table of the RUI3 AT commands used by the library
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ * @copyright Copyright (c) 2026
+ *
+ * Each command is described once in RUI3_AT_COMMANDS.
+ * The query string ("at+xxx=?\r\n") and the command prefix ("at+xxx") are string literals
+ * generated by the preprocessor, nothing is formatted at runtime for constant commands.
+ */
+#ifndef _RUI3_COMMANDS_H_
+#define _RUI3_COMMANDS_H_
+#include <stdint.h>
+
+/** Default timeout for an AT command response in milliseconds, upper limit of the adaptive timeouts */
+#define AT_DEF_TIMEOUT 10000
+
+/** Lower limit of the adaptive timeouts in milliseconds */
+#ifndef AT_MIN_TIMEOUT
+#define AT_MIN_TIMEOUT 100
+#endif
+
+/** Upper limit of the RX buffer flush before each command in milliseconds, see RUI3::setCmdFlush() */
+#ifndef AT_FLUSH_TIMEOUT
+#define AT_FLUSH_TIMEOUT 1000
+#endif
+
+/** Argument type of an AT command */
+typedef enum
+{
+	AT_ARG_NONE = 0, // Command without argument, e.g. at+join
+	AT_ARG_INT,		 // Decimal integer, e.g. at+dr=3
+	AT_ARG_HEX,		 // HEX string, e.g. at+deveui=AC1F09FFFE000000
+	AT_ARG_CHAR,	 // Single character, e.g. at+class=a
+	AT_ARG_TUPLE	 // Colon separated values, e.g. at+send=2:1234
+} at_arg_type;
+
+/** Response type of an AT command query */
+typedef enum
+{
+	AT_RESP_NONE = 0, // Command can not be queried
+	AT_RESP_INT,	  // Decimal integer, e.g. AT+DR=3
+	AT_RESP_HEX,	  // HEX string, e.g. AT+DEVADDR=01360085
+	AT_RESP_CHAR,	  // Single character, e.g. AT+CLASS=A
+	AT_RESP_TUPLE,	  // Colon separated values, e.g. AT+P2P=916100000:7:0:1:8:22
+	AT_RESP_STR		  // Free text, e.g. AT+VER=RUI_4.1.0
+} at_resp_type;
+
+/**
+ * @brief Command classes, each class has its own adaptive response timeout
+ * Queries of all commands are in AT_CLASS_QUERY, the class in the command table is used when a command is executed
+ */
+typedef enum
+{
+	AT_CLASS_QUERY = 0, // Queries, answered from RAM
+	AT_CLASS_SET,		// Settings, might be written to flash
+	AT_CLASS_TX,		// Commands that start a radio transmission, e.g. at+send
+	AT_CLASS_RAW,		// Commands sent with query() and set()
+	AT_CLASS_FIXED,		// Commands with unpredictable response time, e.g. at+nwm resets the module, always AT_DEF_TIMEOUT
+	AT_CLASS_NUM
+} at_class;
+
+/**
+ * @brief List of supported AT commands
+ * X(id, mnemonic, argument type, response type, command class)
+ */
+#define RUI3_AT_COMMANDS(X)                                            \
+	X(VER, "ver", AT_ARG_NONE, AT_RESP_STR, AT_CLASS_QUERY)            \
+	X(NJS, "njs", AT_ARG_NONE, AT_RESP_INT, AT_CLASS_QUERY)            \
+	X(MASK, "mask", AT_ARG_HEX, AT_RESP_HEX, AT_CLASS_SET)             \
+	X(DR, "dr", AT_ARG_INT, AT_RESP_INT, AT_CLASS_SET)                 \
+	X(CLASS, "class", AT_ARG_CHAR, AT_RESP_CHAR, AT_CLASS_SET)         \
+	X(BAND, "band", AT_ARG_INT, AT_RESP_INT, AT_CLASS_SET)             \
+	X(SLEEP, "sleep", AT_ARG_INT, AT_RESP_NONE, AT_CLASS_SET)          \
+	X(LPM, "lpm", AT_ARG_INT, AT_RESP_INT, AT_CLASS_SET)               \
+	X(LPMLVL, "lpmlvl", AT_ARG_INT, AT_RESP_INT, AT_CLASS_SET)         \
+	X(NWM, "nwm", AT_ARG_INT, AT_RESP_INT, AT_CLASS_FIXED)             \
+	X(NJM, "njm", AT_ARG_INT, AT_RESP_INT, AT_CLASS_SET)               \
+	X(JOIN, "join", AT_ARG_NONE, AT_RESP_NONE, AT_CLASS_TX)            \
+	X(DEVEUI, "deveui", AT_ARG_HEX, AT_RESP_HEX, AT_CLASS_SET)         \
+	X(APPEUI, "appeui", AT_ARG_HEX, AT_RESP_HEX, AT_CLASS_SET)         \
+	X(APPKEY, "appkey", AT_ARG_HEX, AT_RESP_HEX, AT_CLASS_SET)         \
+	X(DEVADDR, "devaddr", AT_ARG_HEX, AT_RESP_HEX, AT_CLASS_SET)       \
+	X(APPSKEY, "appskey", AT_ARG_HEX, AT_RESP_HEX, AT_CLASS_SET)       \
+	X(NWKSKEY, "nwkskey", AT_ARG_HEX, AT_RESP_HEX, AT_CLASS_SET)       \
+	X(CFM, "cfm", AT_ARG_INT, AT_RESP_INT, AT_CLASS_SET)               \
+	X(SEND, "send", AT_ARG_TUPLE, AT_RESP_NONE, AT_CLASS_TX)           \
+	X(P2P, "p2p", AT_ARG_TUPLE, AT_RESP_TUPLE, AT_CLASS_SET)           \
+	X(PFREQ, "pfreq", AT_ARG_INT, AT_RESP_INT, AT_CLASS_SET)           \
+	X(PSF, "psf", AT_ARG_INT, AT_RESP_INT, AT_CLASS_SET)               \
+	X(PBW, "pbw", AT_ARG_INT, AT_RESP_INT, AT_CLASS_SET)               \
+	X(PCR, "pcr", AT_ARG_INT, AT_RESP_INT, AT_CLASS_SET)               \
+	X(PPL, "ppl", AT_ARG_INT, AT_RESP_INT, AT_CLASS_SET)               \
+	X(PTP, "ptp", AT_ARG_INT, AT_RESP_INT, AT_CLASS_SET)               \
+	X(PBR, "pbr", AT_ARG_INT, AT_RESP_INT, AT_CLASS_SET)               \
+	X(PFDEV, "pfdev", AT_ARG_INT, AT_RESP_INT, AT_CLASS_SET)           \
+	X(PSEND, "psend", AT_ARG_HEX, AT_RESP_NONE, AT_CLASS_TX)           \
+	X(CAD, "cad", AT_ARG_INT, AT_RESP_INT, AT_CLASS_SET)               \
+	X(PRECV, "precv", AT_ARG_INT, AT_RESP_STR, AT_CLASS_SET)           \
+	X(BAUD, "baud", AT_ARG_INT, AT_RESP_INT, AT_CLASS_FIXED)
+
+/** IDs of the AT commands, index into the command table */
+typedef enum
+{
+#define AT_CMD_ENUM(id, mnemonic, arg, resp, cls) AT_CMD_##id,
+	RUI3_AT_COMMANDS(AT_CMD_ENUM)
+#undef AT_CMD_ENUM
+		AT_CMD_NUM
+} at_cmd_id;
+
+/** Descriptor of an AT command */
+typedef struct _at_cmd
+{
+	const char *prefix; // Command without arguments, e.g. "at+dr"
+	const char *query;	// Complete query command, e.g. "at+dr=?\r\n"
+	uint8_t prefix_len; // Length of prefix
+	uint8_t arg;		// Argument type, see at_arg_type
+	uint8_t resp;		// Response type, see at_resp_type
+	uint8_t cls;		// Command class, see at_class
+} at_cmd;
+
+/** Response time statistics of a command class */
+typedef struct _at_rto
+{
+	uint32_t srtt;	   // Smoothed response time in ms * 8
+	uint32_t rttvar;   // Response time variation in ms * 4
+	uint32_t min_rto;  // Lower limit of the timeout in ms
+	uint32_t max_rto;  // Upper limit of the timeout in ms
+	uint32_t fixed;	   // Manual timeout in ms, 0 = adaptive
+	uint8_t backoff;   // Number of timeouts since the last response, the timeout is doubled for each
+	bool valid;		   // True if srtt and rttvar have a sample
+} at_rto;
+
+/** Table with the command descriptors, indexed by at_cmd_id */
+extern const at_cmd at_cmds[AT_CMD_NUM];
+
+#endif // _RUI3_COMMANDS_H_
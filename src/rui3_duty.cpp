@@ -0,0 +1,99 @@
+/**
+ * @file rui3_duty.cpp
+ * @author Bernd Giesecke (bernd@giesecke.tk)
+ * @brief Duty cycle tracking per sub-band with token buckets
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#include <Arduino.h>
+#include "rui3_at.h"
+#include "rui3_duty.h"
+#include "rui3_no_heap.h"
+
+/**
+ * @brief Convert a time-on-air into the credit it needs
+ *
+ * @param airtime time-on-air in microseconds
+ * @param duty_div duty cycle divider
+ * @return int32_t credit in milliseconds, rounded up
+ */
+static int32_t airtime_credit(uint32_t airtime, uint16_t duty_div)
+{
+	return (int32_t)(((uint64_t)airtime * duty_div + 999) / 1000);
+}
+
+void RUI3DutyCycle::setRegion(uint8_t region)
+{
+	_region = region;
+	setWindow(_window);
+}
+
+void RUI3DutyCycle::setWindow(uint32_t window)
+{
+	_window = window;
+	uint32_t now = millis();
+	for (uint8_t band = 0; band < DUTY_MAX_BANDS; band++)
+	{
+		_tokens[band] = _window;
+		_last[band] = now;
+	}
+}
+
+void RUI3DutyCycle::refill(uint8_t band)
+{
+	uint32_t now = millis();
+	uint32_t elapsed = now - _last[band];
+	_last[band] = now;
+	if ((int64_t)_tokens[band] + elapsed >= _window)
+	{
+		_tokens[band] = _window;
+	}
+	else
+	{
+		_tokens[band] += elapsed;
+	}
+}
+
+uint32_t RUI3DutyCycle::waitTime(uint32_t freq, uint32_t airtime)
+{
+	int8_t band = regionSubBand(_region, freq);
+	if ((band < 0) || (band >= DUTY_MAX_BANDS))
+	{
+		return DUTY_NEVER;
+	}
+	int32_t needed = airtime_credit(airtime, regionParams(_region)->bands[band].duty_div);
+	if ((uint32_t)needed > _window)
+	{
+		return DUTY_NEVER;
+	}
+	refill(band);
+	if (_tokens[band] >= needed)
+	{
+		return 0;
+	}
+	return needed - _tokens[band];
+}
+
+void RUI3DutyCycle::consume(uint32_t freq, uint32_t airtime)
+{
+	int8_t band = regionSubBand(_region, freq);
+	if ((band < 0) || (band >= DUTY_MAX_BANDS))
+	{
+		return;
+	}
+	refill(band);
+	_tokens[band] -= airtime_credit(airtime, regionParams(_region)->bands[band].duty_div);
+}
+
+int32_t RUI3DutyCycle::credit(uint8_t band)
+{
+	if ((regionParams(_region) == NULL) || (band >= regionParams(_region)->num_bands) || (band >= DUTY_MAX_BANDS))
+	{
+		return 0;
+	}
+	refill(band);
+	return (int32_t)(((int64_t)_tokens[band] * 1000) / regionParams(_region)->bands[band].duty_div);
+}
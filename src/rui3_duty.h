@@ -0,0 +1,114 @@
+/**
+ * @file rui3_duty.h
+ * @author Bernd Giesecke (bernd@giesecke.tk)
+ * @brief Duty cycle tracking per sub-band with token buckets
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ * @copyright Copyright (c) 2026
+ *
+ * Each duty cycle sub-band of the region has a token bucket. The bucket is filled with 1 ms of credit per ms of
+ * wall clock time, up to the window size. A transmission takes time-on-air * duty cycle divider of credit,
+ * e.g. 100 ms time-on-air in a 1% sub-band needs 10 s of credit.
+ * With the default window of 1 hour a 1% sub-band allows 36 s of time-on-air per hour.
+ */
+#ifndef _RUI3_DUTY_H_
+#define _RUI3_DUTY_H_
+#include <stdint.h>
+
+/** Max number of duty cycle sub-bands of a region */
+#define DUTY_MAX_BANDS 6
+
+/** Default duty cycle window in milliseconds */
+#ifndef DUTY_WINDOW
+#define DUTY_WINDOW 3600000
+#endif
+
+/** Returned by RUI3DutyCycle::waitTime() if the transmission is never allowed */
+#define DUTY_NEVER 0xFFFFFFFF
+
+/**
+ * @brief Token bucket duty cycle tracker
+ */
+class RUI3DutyCycle
+{
+public:
+	/**
+	 * @brief Set the region, resets all sub-bands
+	 *
+	 * ```cpp
+	 * void setRegion(uint8_t region);
+	 * ```
+	 * @param region region 0 to 12, e.g. EU868
+	 */
+	void setRegion(uint8_t region);
+
+	/**
+	 * @brief Set the duty cycle window, resets all sub-bands
+	 * A shorter window allows shorter bursts
+	 *
+	 * ```cpp
+	 * void setWindow(uint32_t window);
+	 * ```
+	 * @param window window in milliseconds, default DUTY_WINDOW
+	 */
+	void setWindow(uint32_t window);
+
+	/**
+	 * @brief Get the time until a transmission is allowed
+	 *
+	 * ```cpp
+	 * uint32_t waitTime(uint32_t freq, uint32_t airtime);
+	 * ```
+	 * @param freq frequency in Hz
+	 * @param airtime time-on-air in microseconds
+	 * @return uint32_t wait time in milliseconds, 0 if the transmission is allowed now,
+	 * DUTY_NEVER if the frequency is outside of the region or the time-on-air exceeds the window
+	 */
+	uint32_t waitTime(uint32_t freq, uint32_t airtime);
+
+	/**
+	 * @brief Take the credit for a transmission from the sub-band
+	 * The credit can go negative if the transmission was not allowed
+	 *
+	 * ```cpp
+	 * void consume(uint32_t freq, uint32_t airtime);
+	 * ```
+	 * @param freq frequency in Hz
+	 * @param airtime time-on-air in microseconds
+	 */
+	void consume(uint32_t freq, uint32_t airtime);
+
+	/**
+	 * @brief Get the available credit of a sub-band
+	 *
+	 * ```cpp
+	 * int32_t credit(uint8_t band);
+	 * ```
+	 * @param band index into region_params.bands
+	 * @return int32_t time-on-air in microseconds that can be sent now
+	 */
+	int32_t credit(uint8_t band);
+
+private:
+	/**
+	 * @brief Add the credit for the time since the last update
+	 *
+	 * @param band index into region_params.bands
+	 */
+	void refill(uint8_t band);
+
+	/** Region of the sub-bands */
+	uint8_t _region = 0xFF;
+
+	/** Window size in milliseconds */
+	uint32_t _window = DUTY_WINDOW;
+
+	/** Credit per sub-band in milliseconds of wall clock time */
+	int32_t _tokens[DUTY_MAX_BANDS] = {0};
+
+	/** Time of the last refill per sub-band */
+	uint32_t _last[DUTY_MAX_BANDS] = {0};
+};
+
+#endif // _RUI3_DUTY_H_
@@ -0,0 +1,170 @@
+/**
+ * @file rui3_format.cpp
+ * @author Bernd Giesecke (bernd@giesecke.tk)
+ * @brief Parsing and formatting of AT command values without dynamic memory
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#include <Arduino.h>
+#include "rui3_format.h"
+#include "rui3_at.h"
+#include "rui3_no_heap.h"
+
+/**
+ * @brief Convert a HEX character into its value
+ *
+ * @param c character
+ * @return int8_t value 0 - 15, -1 if c is not a HEX character
+ */
+static int8_t hex_nibble(char c)
+{
+	if ((c >= '0') && (c <= '9'))
+	{
+		return c - '0';
+	}
+	if ((c >= 'a') && (c <= 'f'))
+	{
+		return c - 'a' + 10;
+	}
+	if ((c >= 'A') && (c <= 'F'))
+	{
+		return c - 'A' + 10;
+	}
+	return -1;
+}
+
+bool at_parse_int(const char *str, int32_t &value)
+{
+	char *end_ptr;
+	value = strtol(str, &end_ptr, 10);
+	return end_ptr != str;
+}
+
+bool at_parse_uint(const char *str, uint32_t &value)
+{
+	char *end_ptr;
+	value = strtoul(str, &end_ptr, 10);
+	return end_ptr != str;
+}
+
+int16_t at_parse_hex(const char *str, uint8_t *data, uint16_t size)
+{
+	uint16_t idx = 0;
+	while (hex_nibble(str[idx * 2]) >= 0)
+	{
+		int8_t low = hex_nibble(str[idx * 2 + 1]);
+		if ((low < 0) || (idx >= size))
+		{
+			return -1;
+		}
+		data[idx] = (hex_nibble(str[idx * 2]) << 4) | low;
+		idx++;
+	}
+	return idx;
+}
+
+bool at_parse_tuple(const char *str, at_tuple &tuple)
+{
+	tuple.num = 0;
+	while (tuple.num < AT_MAX_TUPLE)
+	{
+		char *end_ptr;
+		tuple.val[tuple.num] = strtol(str, &end_ptr, 10);
+		if (end_ptr == str)
+		{
+			break;
+		}
+		tuple.num++;
+		if (*end_ptr != ':')
+		{
+			break;
+		}
+		str = end_ptr + 1;
+	}
+	return tuple.num != 0;
+}
+
+int16_t at_format_int(char *buf, uint16_t size, int32_t value)
+{
+	if (value >= 0)
+	{
+		return at_format_uint(buf, size, value);
+	}
+	if (size < 2)
+	{
+		return -1;
+	}
+	buf[0] = '-';
+	int16_t len = at_format_uint(&buf[1], size - 1, 0 - (uint32_t)value);
+	if (len < 0)
+	{
+		return -1;
+	}
+	return len + 1;
+}
+
+int16_t at_format_uint(char *buf, uint16_t size, uint32_t value)
+{
+	// Digits are created in reverse order
+	char digits[10];
+	uint8_t num = 0;
+	do
+	{
+		digits[num++] = '0' + (value % 10);
+		value /= 10;
+	} while (value != 0);
+
+	if (num >= size)
+	{
+		return -1;
+	}
+	for (uint8_t idx = 0; idx < num; idx++)
+	{
+		buf[idx] = digits[num - 1 - idx];
+	}
+	buf[num] = 0x00;
+	return num;
+}
+
+int16_t at_format_hex(char *buf, uint16_t size, const uint8_t *data, uint16_t len)
+{
+	static const char hex_chars[] = "0123456789ABCDEF";
+	if ((uint32_t)len * 2 >= size)
+	{
+		return -1;
+	}
+	for (uint16_t idx = 0; idx < len; idx++)
+	{
+		buf[idx * 2] = hex_chars[data[idx] >> 4];
+		buf[idx * 2 + 1] = hex_chars[data[idx] & 0x0F];
+	}
+	buf[len * 2] = 0x00;
+	return len * 2;
+}
+
+int16_t at_format_tuple(char *buf, uint16_t size, const at_tuple &tuple)
+{
+	uint16_t len = 0;
+	for (uint8_t idx = 0; idx < tuple.num; idx++)
+	{
+		if (idx != 0)
+		{
+			if (len + 2 > size)
+			{
+				return -1;
+			}
+			buf[len++] = ':';
+		}
+		int16_t val_len = at_format_int(&buf[len], size - len, tuple.val[idx]);
+		if (val_len < 0)
+		{
+			return -1;
+		}
+		len += val_len;
+	}
+	buf[len] = 0x00;
+	return len;
+}
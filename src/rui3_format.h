@@ -0,0 +1,296 @@
+/**
+ * @file rui3_format.h
+ * @author Bernd Giesecke (bernd@giesecke.tk)
+ * @brief Parsing and formatting of AT command values without dynamic memory
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#ifndef _RUI3_FORMAT_H_
+#define _RUI3_FORMAT_H_
+#include <stdint.h>
+#include <stdlib.h>
+
+/** Max number of values in an at_tuple */
+#ifndef AT_MAX_TUPLE
+#define AT_MAX_TUPLE 8
+#endif
+
+/** HEX string value, e.g. AT+DEVEUI=AC1F09FFFE000001 */
+typedef struct _at_hex
+{
+	uint8_t *data; // Byte array
+	uint16_t size; // Size of the byte array
+	uint16_t len;  // Number of valid bytes in the byte array
+} at_hex;
+
+/** Colon separated list of values, e.g. AT+P2P=916100000:7:0:1:8:22 */
+typedef struct _at_tuple
+{
+	int32_t val[AT_MAX_TUPLE]; // Values
+	uint8_t num;			   // Number of valid values
+} at_tuple;
+
+/**
+ * @brief Parse a decimal signed integer
+ *
+ * @param str string to parse
+ * @param value parsed value
+ * @return true if a number was found
+ * @return false if str does not start with a number
+ */
+bool at_parse_int(const char *str, int32_t &value);
+
+/**
+ * @brief Parse a decimal unsigned integer
+ *
+ * @param str string to parse
+ * @param value parsed value
+ * @return true if a number was found
+ * @return false if str does not start with a number
+ */
+bool at_parse_uint(const char *str, uint32_t &value);
+
+/**
+ * @brief Parse a HEX string into a byte array
+ * Parsing stops at the first non HEX character
+ *
+ * @param str string to parse
+ * @param data byte array for the result
+ * @param size size of the byte array
+ * @return int16_t number of bytes parsed, -1 if the string is odd or does not fit
+ */
+int16_t at_parse_hex(const char *str, uint8_t *data, uint16_t size);
+
+/**
+ * @brief Parse a colon separated list of decimal values
+ *
+ * @param str string to parse
+ * @param tuple structure for the result
+ * @return true if at least one value was found
+ * @return false if no value was found
+ */
+bool at_parse_tuple(const char *str, at_tuple &tuple);
+
+/**
+ * @brief Write a signed integer as decimal string
+ *
+ * @param buf destination buffer
+ * @param size size of the destination buffer
+ * @param value value to write
+ * @return int16_t number of characters written, -1 if the buffer is too small
+ */
+int16_t at_format_int(char *buf, uint16_t size, int32_t value);
+
+/**
+ * @brief Write an unsigned integer as decimal string
+ *
+ * @param buf destination buffer
+ * @param size size of the destination buffer
+ * @param value value to write
+ * @return int16_t number of characters written, -1 if the buffer is too small
+ */
+int16_t at_format_uint(char *buf, uint16_t size, uint32_t value);
+
+/**
+ * @brief Write a byte array as HEX string
+ *
+ * @param buf destination buffer
+ * @param size size of the destination buffer
+ * @param data byte array
+ * @param len number of bytes
+ * @return int16_t number of characters written, -1 if the buffer is too small
+ */
+int16_t at_format_hex(char *buf, uint16_t size, const uint8_t *data, uint16_t len);
+
+/**
+ * @brief Write a list of values separated by colons
+ *
+ * @param buf destination buffer
+ * @param size size of the destination buffer
+ * @param tuple values
+ * @return int16_t number of characters written, -1 if the buffer is too small
+ */
+int16_t at_format_tuple(char *buf, uint16_t size, const at_tuple &tuple);
+
+/**
+ * @brief Parse and format functions for the value types of RUI3::query() and RUI3::set()
+ * The generic template handles all integer types.
+ */
+template <typename T>
+struct at_value
+{
+	static bool parse(const char *str, T &value)
+	{
+		if ((T)(-1) > (T)0)
+		{
+			uint32_t u_value;
+			if (!at_parse_uint(str, u_value))
+			{
+				return false;
+			}
+			value = (T)u_value;
+			return true;
+		}
+		int32_t s_value;
+		if (!at_parse_int(str, s_value))
+		{
+			return false;
+		}
+		value = (T)s_value;
+		return true;
+	}
+
+	static int16_t format(char *buf, uint16_t size, const T &value)
+	{
+		if ((T)(-1) > (T)0)
+		{
+			return at_format_uint(buf, size, (uint32_t)value);
+		}
+		return at_format_int(buf, size, (int32_t)value);
+	}
+};
+
+/** Boolean values are 0 or 1 */
+template <>
+struct at_value<bool>
+{
+	static bool parse(const char *str, bool &value)
+	{
+		if ((str[0] != '0') && (str[0] != '1'))
+		{
+			return false;
+		}
+		value = str[0] == '1';
+		return true;
+	}
+
+	static int16_t format(char *buf, uint16_t size, const bool &value)
+	{
+		if (size < 2)
+		{
+			return -1;
+		}
+		buf[0] = value ? '1' : '0';
+		buf[1] = 0x00;
+		return 1;
+	}
+};
+
+/** HEX strings are converted from and to byte arrays */
+template <>
+struct at_value<at_hex>
+{
+	static bool parse(const char *str, at_hex &value)
+	{
+		int16_t len = at_parse_hex(str, value.data, value.size);
+		if (len < 0)
+		{
+			return false;
+		}
+		value.len = len;
+		return true;
+	}
+
+	static int16_t format(char *buf, uint16_t size, const at_hex &value)
+	{
+		return at_format_hex(buf, size, value.data, value.len);
+	}
+};
+
+/** Colon separated values */
+template <>
+struct at_value<at_tuple>
+{
+	static bool parse(const char *str, at_tuple &value)
+	{
+		return at_parse_tuple(str, value);
+	}
+
+	static int16_t format(char *buf, uint16_t size, const at_tuple &value)
+	{
+		return at_format_tuple(buf, size, value);
+	}
+};
+
+/**
+ * @brief Fixed size binary key, EUI or address
+ *
+ * @tparam N number of bytes
+ */
+template <size_t N>
+struct rui3_key
+{
+	uint8_t bytes[N];
+};
+
+namespace rui3_detail
+{
+	/** List of indices for the compile-time HEX conversion */
+	template <size_t... I>
+	struct index_list
+	{
+	};
+
+	template <size_t N, size_t... I>
+	struct make_index_list : make_index_list<N - 1, N - 1, I...>
+	{
+	};
+
+	template <size_t... I>
+	struct make_index_list<0, I...>
+	{
+		typedef index_list<I...> type;
+	};
+
+	/** Not constexpr on purpose, using it in a constant expression stops the compiler */
+	inline uint8_t invalid_hex_character(void)
+	{
+		return 0;
+	}
+
+	constexpr uint8_t hex_value(char c)
+	{
+		return ((c >= '0') && (c <= '9'))	? c - '0'
+			   : ((c >= 'a') && (c <= 'f')) ? c - 'a' + 10
+			   : ((c >= 'A') && (c <= 'F')) ? c - 'A' + 10
+											: invalid_hex_character();
+	}
+
+	template <size_t N, size_t... I>
+	constexpr rui3_key<sizeof...(I)> hex_to_key(const char (&hex)[N], index_list<I...>)
+	{
+		return rui3_key<sizeof...(I)>{{(uint8_t)((hex_value(hex[I * 2]) << 4) | hex_value(hex[I * 2 + 1]))...}};
+	}
+}
+
+/**
+ * @brief Convert a HEX string literal into a binary key at compile time
+ * The size of the key is taken from the length of the string, passing a key of the wrong size to
+ * initOTAA() or initABP() fails to compile. Invalid HEX characters fail to compile when the result
+ * is assigned to a constexpr variable.
+ *
+ * ```cpp
+ * template <size_t N> constexpr rui3_key<(N - 1) / 2> hexKey(const char (&hex)[N]);
+ * ```
+ * @param hex HEX string literal with an even number of characters
+ * @return rui3_key<(N - 1) / 2> binary key
+ *
+ * @par Usage
+ * @code
+ * constexpr rui3_key<8> dev_eui = hexKey("AC1F09FFFE000000");
+ * constexpr rui3_key<8> app_eui = hexKey("AC1F09FFFE000000");
+ * constexpr rui3_key<16> app_key = hexKey("EFADFF0000004829ACF71E1A6E000000");
+ * wisduo.initOTAA(dev_eui, app_eui, app_key);
+ * @endcode
+ */
+template <size_t N>
+constexpr rui3_key<(N - 1) / 2> hexKey(const char (&hex)[N])
+{
+	static_assert((N - 1) % 2 == 0, "HEX string must have an even number of characters");
+	return rui3_detail::hex_to_key(hex, typename rui3_detail::make_index_list<(N - 1) / 2>::type());
+}
+
+#endif // _RUI3_FORMAT_H_
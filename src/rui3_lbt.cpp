@@ -0,0 +1,179 @@
+/**
+ * @file rui3_lbt.cpp
+ * @author Bernd Giesecke (bernd@giesecke.tk)
+ * @brief Listen-before-talk LoRa P2P TX with CAD and adaptive random backoff
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#include <Arduino.h>
+#include "rui3_lbt.h"
+#include "rui3_no_heap.h"
+
+RUI3LBT::RUI3LBT(RUI3 &rui3) : _rui3(rui3)
+{
+	memset(&_stats, 0, sizeof(_stats));
+}
+
+bool RUI3LBT::begin(void)
+{
+	return _rui3.setP2PCAD(true);
+}
+
+void RUI3LBT::setReceiver(RUI3P2PReceiver *receiver)
+{
+	_receiver = receiver;
+}
+
+bool RUI3LBT::send(const uint8_t *data, uint16_t len)
+{
+	if ((_status == LBT_BACKOFF) || (_status == LBT_TX))
+	{
+		return false;
+	}
+	_data = data;
+	_len = len;
+	_attempts = 0;
+	updateAirtime();
+	if (_cw > LBT_CW_MIN)
+	{
+		// The channel was busy recently, do not start together with the other nodes that waited for it
+		backoff(0);
+		return true;
+	}
+	attempt();
+	return true;
+}
+
+uint8_t RUI3LBT::status(void)
+{
+	return _status;
+}
+
+void RUI3LBT::backoff(uint32_t min)
+{
+	_timeout = min + random(_airtime * _cw + 1);
+	_start = millis();
+	_stats.backoff += _timeout;
+	_status = LBT_BACKOFF;
+}
+
+void RUI3LBT::updateAirtime(void)
+{
+	// The backoff is sized by the time-on-air of the packet, also if the module does not accept the TX
+	_airtime = _rui3.getP2PAirtime(_len) / 1000 + 1;
+	if (_airtime < LBT_BACKOFF_MIN)
+	{
+		_airtime = LBT_BACKOFF_MIN;
+	}
+}
+
+void RUI3LBT::attempt(void)
+{
+	_attempts++;
+	_stats.attempts++;
+	bool accepted = _rui3.sendP2PData(_data, _len);
+	// The P2P settings are read by the first TX
+	updateAirtime();
+	if (!accepted)
+	{
+		MYLOG("lbt", "TX not accepted: %s", _rui3.ret);
+		busy();
+		return;
+	}
+	_timeout = _rui3.getTxTimeout();
+	_start = millis();
+	_status = LBT_TX;
+}
+
+void RUI3LBT::busy(void)
+{
+	_stats.busy++;
+	_busy_ratio = _busy_ratio - _busy_ratio / 8 + 125;
+	if (_cw < LBT_CW_MAX)
+	{
+		_cw = _cw * 2 > LBT_CW_MAX ? LBT_CW_MAX : _cw * 2;
+	}
+	if (_attempts >= LBT_MAX_ATTEMPTS)
+	{
+		MYLOG("lbt", "Channel busy, packet dropped");
+		_stats.failed++;
+		_status = LBT_FAILED;
+		return;
+	}
+	// The packet on the channel takes at least one time-on-air
+	backoff(_airtime);
+	MYLOG("lbt", "Channel busy, window %d, wait %lu ms", _cw, (unsigned long)_timeout);
+}
+
+bool RUI3LBT::event(char *line)
+{
+	if (strstr(line, "+EVT:TXP2P DONE") != NULL)
+	{
+		if (_status == LBT_TX)
+		{
+			_stats.sent++;
+			_busy_ratio = _busy_ratio - _busy_ratio / 8;
+			if (_cw > LBT_CW_MIN)
+			{
+				_cw--;
+			}
+			_status = LBT_DONE;
+		}
+		if (_receiver != NULL)
+		{
+			_receiver->event(line);
+		}
+		return true;
+	}
+	if (strstr(line, LBT_BUSY_EVENT) != NULL)
+	{
+		if (_status == LBT_TX)
+		{
+			busy();
+		}
+		return true;
+	}
+	return false;
+}
+
+void RUI3LBT::loop(void)
+{
+	while (_rui3.pollLine())
+	{
+		if (!event(_rui3.ret) && (_receiver != NULL))
+		{
+			_receiver->event(_rui3.ret);
+		}
+	}
+	if (((_status != LBT_TX) && (_status != LBT_BACKOFF)) || ((millis() - _start) < _timeout))
+	{
+		return;
+	}
+	if (_status == LBT_BACKOFF)
+	{
+		attempt();
+	}
+	else
+	{
+		// No TX done, the module did not send because of activity on the channel
+		busy();
+	}
+}
+
+lbt_stats RUI3LBT::stats(void)
+{
+	return _stats;
+}
+
+float RUI3LBT::busyRatio(void)
+{
+	return _busy_ratio / 10.0;
+}
+
+uint8_t RUI3LBT::window(void)
+{
+	return _cw;
+}
@@ -0,0 +1,259 @@
+/**
+ * @file rui3_lbt.h
+ * @author Bernd Giesecke (bernd@giesecke.tk)
+ * @brief Listen-before-talk LoRa P2P TX with CAD and adaptive random backoff
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ * @copyright Copyright (c) 2026
+ *
+ * With CAD enabled the module checks the channel before each TX and does not send if it detects activity.
+ * A busy channel is detected from the busy event of the module, or from a missing TX done if the firmware does not send it.
+ * After a busy channel the next attempt waits one time-on-air plus a random time of up to the contention window,
+ * the contention window is counted in time-on-air of the packet. It is doubled after each busy channel and reduced by
+ * one after each sent packet, so the backoff follows the load of the channel.
+ */
+#ifndef _RUI3_LBT_H_
+#define _RUI3_LBT_H_
+#include "rui3_at.h"
+#include "rui3_p2p_rx.h"
+
+/** Min contention window in time-on-air of the packet */
+#ifndef LBT_CW_MIN
+#define LBT_CW_MIN 1
+#endif
+
+/** Max contention window in time-on-air of the packet */
+#ifndef LBT_CW_MAX
+#define LBT_CW_MAX 32
+#endif
+
+/** Max attempts per packet */
+#ifndef LBT_MAX_ATTEMPTS
+#define LBT_MAX_ATTEMPTS 8
+#endif
+
+/** Min time-on-air for the backoff in milliseconds, used if the time-on-air of the packet is not known */
+#ifndef LBT_BACKOFF_MIN
+#define LBT_BACKOFF_MIN 100
+#endif
+
+/**
+ * Event of the module if CAD detected activity. The text is assumed, it is not verified with a RUI3 release and
+ * depends on the firmware version. Define the text of your module before including rui3_lbt.h.
+ * Without the event a busy channel is still detected from the missing TX done.
+ */
+#ifndef LBT_BUSY_EVENT
+#define LBT_BUSY_EVENT "+EVT:CAD ACTIVITY"
+#endif
+
+/** TX status */
+#define LBT_IDLE 0
+#define LBT_BACKOFF 1
+#define LBT_TX 2
+#define LBT_DONE 3
+#define LBT_FAILED 4
+
+/** Statistics of the scheduler */
+typedef struct _lbt_stats
+{
+	uint32_t sent;	   // Packets sent
+	uint32_t failed;   // Packets not sent after LBT_MAX_ATTEMPTS attempts
+	uint32_t attempts; // TX attempts
+	uint32_t busy;	   // Attempts with busy channel
+	uint32_t backoff;  // Sum of the backoff times in milliseconds
+} lbt_stats;
+
+/**
+ * @brief Listen-before-talk LoRa P2P TX
+ */
+class RUI3LBT
+{
+public:
+	/**
+	 * @brief Create the scheduler
+	 *
+	 * @param rui3 RUI3 instance in P2P mode
+	 */
+	RUI3LBT(RUI3 &rui3);
+
+	/**
+	 * @brief Enable CAD in the module
+	 *
+	 * ```cpp
+	 * bool begin(void);
+	 * ```
+	 * @return true Success
+	 * @return false No response or error response
+	 *
+	 * @par Usage
+	 * @code
+	 * RUI3 wisduo(Serial1, Serial);
+	 * RUI3LBT lbt(wisduo);
+	 * void setup()
+	 * {
+	 * 	// ... initP2P()
+	 * 	lbt.begin();
+	 * }
+	 * @endcode
+	 */
+	bool begin(void);
+
+	/**
+	 * @brief Pass all other events to a P2P receiver
+	 * The receiver has to use P2P_RX_PERMANENT_TX or be stopped, otherwise the module is in RX and refuses to send
+	 *
+	 * ```cpp
+	 * void setReceiver(RUI3P2PReceiver *receiver);
+	 * ```
+	 * @param receiver P2P receiver, NULL to drop the events
+	 */
+	void setReceiver(RUI3P2PReceiver *receiver);
+
+	/**
+	 * @brief Send a packet when the channel is free
+	 * Under load the first attempt already waits a random time of up to the contention window
+	 *
+	 * ```cpp
+	 * bool send(const uint8_t *data, uint16_t len);
+	 * ```
+	 * @param data payload, has to stay valid until status() returns LBT_DONE or LBT_FAILED
+	 * @param len payload length
+	 * @return true Packet accepted
+	 * @return false Another packet is not finished
+	 *
+	 * @par Usage
+	 * @code
+	 * uint8_t payload[] = {0x01, 0x02, 0x03};
+	 * lbt.send(payload, sizeof(payload));
+	 * while ((lbt.status() == LBT_BACKOFF) || (lbt.status() == LBT_TX))
+	 * {
+	 * 	lbt.loop();
+	 * }
+	 * @endcode
+	 */
+	bool send(const uint8_t *data, uint16_t len);
+
+	/**
+	 * @brief Get the status of the last packet
+	 *
+	 * ```cpp
+	 * uint8_t status(void);
+	 * ```
+	 * @return uint8_t LBT_IDLE, LBT_BACKOFF, LBT_TX, LBT_DONE or LBT_FAILED
+	 */
+	uint8_t status(void);
+
+	/**
+	 * @brief Read the events of the module and start the next attempt after the backoff
+	 * Has to be called frequently, e.g. from the Arduino loop()
+	 *
+	 * ```cpp
+	 * void loop(void);
+	 * ```
+	 */
+	void loop(void);
+
+	/**
+	 * @brief Handle an event read elsewhere
+	 *
+	 * ```cpp
+	 * bool event(char *line);
+	 * ```
+	 * @param line received line
+	 * @return true Line was a TX done or a busy event
+	 * @return false Other line
+	 */
+	bool event(char *line);
+
+	/**
+	 * @brief Get the statistics
+	 *
+	 * ```cpp
+	 * lbt_stats stats(void);
+	 * ```
+	 * @return lbt_stats statistics since the start
+	 */
+	lbt_stats stats(void);
+
+	/**
+	 * @brief Get the share of attempts with busy channel
+	 * Moving average over the last attempts, recent attempts count more
+	 *
+	 * ```cpp
+	 * float busyRatio(void);
+	 * ```
+	 * @return float busy attempts in percent
+	 */
+	float busyRatio(void);
+
+	/**
+	 * @brief Get the contention window
+	 *
+	 * ```cpp
+	 * uint8_t window(void);
+	 * ```
+	 * @return uint8_t contention window in time-on-air of the packet, LBT_CW_MIN to LBT_CW_MAX
+	 */
+	uint8_t window(void);
+
+private:
+	/**
+	 * @brief Send the packet
+	 */
+	void attempt(void);
+
+	/**
+	 * @brief Set the time-on-air of the pending packet for the backoff, at least LBT_BACKOFF_MIN
+	 */
+	void updateAirtime(void);
+
+	/**
+	 * @brief Handle a busy channel, wait a random backoff or give up
+	 */
+	void busy(void);
+
+	/**
+	 * @brief Wait a random time of up to the contention window
+	 *
+	 * @param min time to wait at least in milliseconds
+	 */
+	void backoff(uint32_t min);
+
+	RUI3 &_rui3;
+
+	/** P2P receiver for other events, NULL if not used */
+	RUI3P2PReceiver *_receiver = NULL;
+
+	/** Payload of the packet */
+	const uint8_t *_data = NULL;
+
+	/** Payload length */
+	uint16_t _len = 0;
+
+	/** Status of the packet */
+	uint8_t _status = LBT_IDLE;
+
+	/** Attempts of the packet */
+	uint8_t _attempts = 0;
+
+	/** Contention window in time-on-air */
+	uint8_t _cw = LBT_CW_MIN;
+
+	/** Busy attempts in 1/1000, moving average */
+	uint16_t _busy_ratio = 0;
+
+	/** Time-on-air of the pending packet in milliseconds, at least LBT_BACKOFF_MIN */
+	uint32_t _airtime = 0;
+
+	/** Start time of the active TX or of the backoff */
+	uint32_t _start = 0;
+
+	/** TX done timeout of the active TX or backoff time */
+	uint32_t _timeout = 0;
+
+	/** Statistics */
+	lbt_stats _stats;
+};
+
+#endif // _RUI3_LBT_H_
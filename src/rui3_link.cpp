@@ -0,0 +1,246 @@
+/**
+ * @file rui3_link.cpp
+ * @author Bernd Giesecke (bernd@giesecke.tk)
+ * @brief Link quality of P2P peers with rolling RSSI and SNR statistics and packet loss
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#include <Arduino.h>
+#include "rui3_link.h"
+#include "rui3_no_heap.h"
+
+/** Number of RSSI histogram bins */
+#define RSSI_BINS (LINK_RSSI_MAX - LINK_RSSI_MIN + 1)
+
+/** Number of SNR histogram bins */
+#define SNR_BINS (LINK_SNR_MAX - LINK_SNR_MIN + 1)
+
+/**
+ * @brief Get the histogram bin of a value
+ *
+ * @param value value
+ * @param min value of the first bin
+ * @param max value of the last bin
+ * @return uint16_t bin
+ */
+static uint16_t bin(int16_t value, int16_t min, int16_t max)
+{
+	if (value < min)
+	{
+		return 0;
+	}
+	if (value > max)
+	{
+		return max - min;
+	}
+	return value - min;
+}
+
+RUI3LinkQuality::RUI3LinkQuality(void)
+{
+	clear();
+}
+
+link_peer *RUI3LinkQuality::find(uint32_t peer)
+{
+	for (uint8_t idx = 0; idx < LINK_MAX_PEERS; idx++)
+	{
+		if (_peers[idx].used && (_peers[idx].id == peer))
+		{
+			return &_peers[idx];
+		}
+	}
+	return NULL;
+}
+
+void RUI3LinkQuality::start(link_peer *entry, uint32_t peer, uint16_t seq)
+{
+	memset(entry, 0, sizeof(link_peer));
+	entry->id = peer;
+	entry->used = true;
+	// The first packet is not counted as gap
+	entry->seq = seq - 1;
+}
+
+void RUI3LinkQuality::add(uint32_t peer, const rx_packet &packet, uint16_t seq)
+{
+	add(peer, packet.rssi, packet.snr, seq);
+}
+
+void RUI3LinkQuality::add(uint32_t peer, int16_t rssi, int8_t snr, uint16_t seq)
+{
+	link_peer *entry = find(peer);
+	if (entry == NULL)
+	{
+		// Take a free entry or the peer that was not heard for the longest time
+		entry = &_peers[0];
+		for (uint8_t idx = 0; idx < LINK_MAX_PEERS; idx++)
+		{
+			if (!_peers[idx].used)
+			{
+				entry = &_peers[idx];
+				break;
+			}
+			if ((millis() - _peers[idx].last) > (millis() - entry->last))
+			{
+				entry = &_peers[idx];
+			}
+		}
+		start(entry, peer, seq);
+	}
+	entry->last = millis();
+	uint16_t gap = seq - entry->seq;
+	if ((gap == 0) || (gap > (uint16_t)(0x10000 - LINK_SEQ_GAP)))
+	{
+		// Same or a slightly older sequence number, a packet received twice or out of order
+		entry->duplicates++;
+		return;
+	}
+	// A large gap forward or back is a restart of the peer
+	gap = gap > LINK_SEQ_GAP ? 0 : gap - 1;
+	entry->seq = seq;
+	entry->received++;
+	entry->lost += gap;
+
+	if (entry->count == LINK_WINDOW)
+	{
+		// Remove the oldest packet from the sums and histograms
+		uint8_t old = entry->head;
+		entry->rssi_sum -= entry->rssi[old];
+		entry->snr_sum -= entry->snr[old];
+		entry->gap_sum -= entry->gap[old];
+		entry->rssi_hist[bin(entry->rssi[old], LINK_RSSI_MIN, LINK_RSSI_MAX)]--;
+		entry->snr_hist[bin(entry->snr[old], LINK_SNR_MIN, LINK_SNR_MAX)]--;
+	}
+	else
+	{
+		entry->count++;
+	}
+	entry->rssi[entry->head] = rssi;
+	entry->snr[entry->head] = snr;
+	entry->gap[entry->head] = gap > 255 ? 255 : gap;
+	entry->rssi_sum += rssi;
+	entry->snr_sum += snr;
+	entry->gap_sum += entry->gap[entry->head];
+	entry->rssi_hist[bin(rssi, LINK_RSSI_MIN, LINK_RSSI_MAX)]++;
+	entry->snr_hist[bin(snr, LINK_SNR_MIN, LINK_SNR_MAX)]++;
+	entry->head = (entry->head + 1) % LINK_WINDOW;
+}
+
+uint16_t RUI3LinkQuality::percentile(const uint8_t *hist, uint16_t bins, uint8_t count, uint8_t percent)
+{
+	// Nearest rank, the 0th percentile is the min
+	uint16_t rank = ((uint16_t)count * (percent > 100 ? 100 : percent) + 99) / 100;
+	if (rank == 0)
+	{
+		rank = 1;
+	}
+	uint16_t sum = 0;
+	for (uint16_t idx = 0; idx < bins; idx++)
+	{
+		sum += hist[idx];
+		if (sum >= rank)
+		{
+			return idx;
+		}
+	}
+	return bins - 1;
+}
+
+bool RUI3LinkQuality::stats(uint32_t peer, link_stats &stats)
+{
+	link_peer *entry = find(peer);
+	if (entry == NULL)
+	{
+		return false;
+	}
+	memset(&stats, 0, sizeof(stats));
+	stats.peer = peer;
+	stats.received = entry->received;
+	stats.lost = entry->lost;
+	stats.duplicates = entry->duplicates;
+	stats.last = entry->last;
+	stats.samples = entry->count;
+	if (entry->count == 0)
+	{
+		return true;
+	}
+	stats.loss = (uint32_t)entry->gap_sum * 1000 / (entry->gap_sum + entry->count);
+	stats.rssi_min = stats.rssi_max = entry->rssi[0];
+	stats.snr_min = stats.snr_max = entry->snr[0];
+	for (uint8_t idx = 1; idx < entry->count; idx++)
+	{
+		stats.rssi_min = entry->rssi[idx] < stats.rssi_min ? entry->rssi[idx] : stats.rssi_min;
+		stats.rssi_max = entry->rssi[idx] > stats.rssi_max ? entry->rssi[idx] : stats.rssi_max;
+		stats.snr_min = entry->snr[idx] < stats.snr_min ? entry->snr[idx] : stats.snr_min;
+		stats.snr_max = entry->snr[idx] > stats.snr_max ? entry->snr[idx] : stats.snr_max;
+	}
+	stats.rssi_mean = entry->rssi_sum / entry->count;
+	stats.snr_mean = entry->snr_sum / entry->count;
+	stats.rssi_p10 = rssiPercentile(peer, 10);
+	stats.rssi_p50 = rssiPercentile(peer, 50);
+	stats.rssi_p90 = rssiPercentile(peer, 90);
+	stats.snr_p10 = snrPercentile(peer, 10);
+	stats.snr_p50 = snrPercentile(peer, 50);
+	stats.snr_p90 = snrPercentile(peer, 90);
+	return true;
+}
+
+int16_t RUI3LinkQuality::rssiPercentile(uint32_t peer, uint8_t percent)
+{
+	link_peer *entry = find(peer);
+	if ((entry == NULL) || (entry->count == 0))
+	{
+		return LINK_RSSI_MIN;
+	}
+	return LINK_RSSI_MIN + percentile(entry->rssi_hist, RSSI_BINS, entry->count, percent);
+}
+
+int8_t RUI3LinkQuality::snrPercentile(uint32_t peer, uint8_t percent)
+{
+	link_peer *entry = find(peer);
+	if ((entry == NULL) || (entry->count == 0))
+	{
+		return LINK_SNR_MIN;
+	}
+	return LINK_SNR_MIN + percentile(entry->snr_hist, SNR_BINS, entry->count, percent);
+}
+
+uint8_t RUI3LinkQuality::peers(void)
+{
+	uint8_t num = 0;
+	for (uint8_t idx = 0; idx < LINK_MAX_PEERS; idx++)
+	{
+		num += _peers[idx].used ? 1 : 0;
+	}
+	return num;
+}
+
+uint32_t RUI3LinkQuality::peer(uint8_t idx)
+{
+	for (uint8_t entry = 0; entry < LINK_MAX_PEERS; entry++)
+	{
+		if (_peers[entry].used && (idx-- == 0))
+		{
+			return _peers[entry].id;
+		}
+	}
+	return 0;
+}
+
+void RUI3LinkQuality::clear(uint32_t peer)
+{
+	link_peer *entry = find(peer);
+	if (entry != NULL)
+	{
+		entry->used = false;
+	}
+}
+
+void RUI3LinkQuality::clear(void)
+{
+	memset(_peers, 0, sizeof(_peers));
+}
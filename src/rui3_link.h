@@ -0,0 +1,264 @@
+/**
+ * @file rui3_link.h
+ * @author Bernd Giesecke (bernd@giesecke.tk)
+ * @brief Link quality of P2P peers with rolling RSSI and SNR statistics and packet loss
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ * @copyright Copyright (c) 2026
+ *
+ * For each peer the last LINK_WINDOW packets are kept in a ring buffer. A running sum and a histogram with 1 dB bins
+ * are updated when a packet enters or leaves the window, so adding a packet does not depend on the window size.
+ * Mean and percentiles are calculated from the sums and the histograms when the statistics are read.
+ * Lost packets are counted from the gaps in the sequence numbers, the peer defines the sequence numbers in its payload.
+ * A packet with the last or a slightly older sequence number is counted as duplicate and not added to the statistics.
+ * If the table is full, a new peer replaces the peer that was not heard for the longest time.
+ */
+#ifndef _RUI3_LINK_H_
+#define _RUI3_LINK_H_
+#include <stdint.h>
+#include "rui3_rx.h"
+
+/** Number of peers */
+#ifndef LINK_MAX_PEERS
+#define LINK_MAX_PEERS 4
+#endif
+
+/** Number of packets in the rolling statistics, max 255 */
+#ifndef LINK_WINDOW
+#define LINK_WINDOW 32
+#endif
+
+#if LINK_WINDOW > 255
+#error "LINK_WINDOW must not be larger than 255"
+#endif
+
+/** RSSI range of the histogram in dBm, values outside are counted in the first or last bin */
+#ifndef LINK_RSSI_MIN
+#define LINK_RSSI_MIN -140
+#endif
+#ifndef LINK_RSSI_MAX
+#define LINK_RSSI_MAX -20
+#endif
+
+/** SNR range of the histogram in dB, values outside are counted in the first or last bin */
+#ifndef LINK_SNR_MIN
+#define LINK_SNR_MIN -32
+#endif
+#ifndef LINK_SNR_MAX
+#define LINK_SNR_MAX 20
+#endif
+
+/** Larger sequence number gaps are taken as a restart of the peer, not as lost packets.
+ * Smaller steps back are taken as packets received twice or out of order and are ignored */
+#ifndef LINK_SEQ_GAP
+#define LINK_SEQ_GAP 256
+#endif
+
+/** Link statistics of a peer, RSSI and SNR values are over the last LINK_WINDOW packets */
+typedef struct _link_stats
+{
+	uint32_t peer;		 // Peer ID
+	uint32_t received;	 // Packets received
+	uint32_t lost;		 // Packets lost, from the sequence numbers
+	uint32_t duplicates; // Packets received twice or out of order, not in the statistics
+	uint32_t last;		 // Time of the last packet in milliseconds
+	uint8_t samples;	 // Packets in the rolling statistics
+	uint16_t loss;		 // Lost packets in 1/1000 in the rolling statistics
+	int16_t rssi_min;	 // Min RSSI in dBm
+	int16_t rssi_mean;	 // Mean RSSI in dBm
+	int16_t rssi_max;	 // Max RSSI in dBm
+	int16_t rssi_p10;	 // 10th percentile of the RSSI in dBm
+	int16_t rssi_p50;	 // Median of the RSSI in dBm
+	int16_t rssi_p90;	 // 90th percentile of the RSSI in dBm
+	int8_t snr_min;		 // Min SNR in dB
+	int8_t snr_mean;	 // Mean SNR in dB
+	int8_t snr_max;		 // Max SNR in dB
+	int8_t snr_p10;		 // 10th percentile of the SNR in dB
+	int8_t snr_p50;		 // Median of the SNR in dB
+	int8_t snr_p90;		 // 90th percentile of the SNR in dB
+} link_stats;
+
+/** Rolling statistics of a peer, used internally by RUI3LinkQuality */
+typedef struct _link_peer
+{
+	uint32_t id;												 // Peer ID
+	bool used;													 // Entry in use
+	uint16_t seq;												 // Last sequence number
+	uint32_t last;												 // Time of the last packet
+	uint32_t received;											 // Packets received
+	uint32_t lost;												 // Packets lost
+	uint32_t duplicates;										 // Packets received twice
+	uint8_t head;												 // Next entry of the ring buffer
+	uint8_t count;												 // Entries in the ring buffer
+	int16_t rssi[LINK_WINDOW];									 // RSSI ring buffer
+	int8_t snr[LINK_WINDOW];									 // SNR ring buffer
+	uint8_t gap[LINK_WINDOW];									 // Lost packets before each packet
+	int32_t rssi_sum;											 // Sum of the RSSI in the ring buffer
+	int16_t snr_sum;											 // Sum of the SNR in the ring buffer
+	uint16_t gap_sum;											 // Sum of the lost packets in the ring buffer
+	uint8_t rssi_hist[LINK_RSSI_MAX - LINK_RSSI_MIN + 1];		 // RSSI histogram
+	uint8_t snr_hist[LINK_SNR_MAX - LINK_SNR_MIN + 1];			 // SNR histogram
+} link_peer;
+
+/**
+ * @brief Link quality of P2P peers
+ */
+class RUI3LinkQuality
+{
+public:
+	RUI3LinkQuality(void);
+
+	/**
+	 * @brief Add a received packet
+	 *
+	 * ```cpp
+	 * void add(uint32_t peer, const rx_packet &packet, uint16_t seq);
+	 * ```
+	 * @param peer peer ID, e.g. the device address in the payload
+	 * @param packet packet from parseRX()
+	 * @param seq sequence number of the packet, counted up by one per packet sent by the peer
+	 *
+	 * @par Usage
+	 * @code
+	 * RUI3LinkQuality link;
+	 * void p2p_packet(const rx_packet &packet)
+	 * {
+	 * 	// Payload: device address, sequence number (LSB first), data
+	 * 	if (packet.len >= 3)
+	 * 	{
+	 * 		link.add(packet.data[0], packet, packet.data[1] | (packet.data[2] << 8));
+	 * 	}
+	 * }
+	 * @endcode
+	 */
+	void add(uint32_t peer, const rx_packet &packet, uint16_t seq);
+
+	/**
+	 * @brief Add a received packet
+	 *
+	 * ```cpp
+	 * void add(uint32_t peer, int16_t rssi, int8_t snr, uint16_t seq);
+	 * ```
+	 * @param peer peer ID
+	 * @param rssi RSSI in dBm
+	 * @param snr SNR in dB
+	 * @param seq sequence number of the packet
+	 */
+	void add(uint32_t peer, int16_t rssi, int8_t snr, uint16_t seq);
+
+	/**
+	 * @brief Get the statistics of a peer
+	 * Calculated from the rolling statistics, takes a few hundred operations
+	 *
+	 * ```cpp
+	 * bool stats(uint32_t peer, link_stats &stats);
+	 * ```
+	 * @param peer peer ID
+	 * @param stats statistics
+	 * @return true Success
+	 * @return false Unknown peer
+	 *
+	 * @par Usage
+	 * @code
+	 * link_stats stats;
+	 * if (link.stats(1, stats))
+	 * {
+	 * 	Serial.printf("RSSI %d/%d/%d dBm, SNR %d/%d/%d dB, loss %d.%d%%\r\n", stats.rssi_min, stats.rssi_mean,
+	 * 				  stats.rssi_max, stats.snr_min, stats.snr_mean, stats.snr_max, stats.loss / 10, stats.loss % 10);
+	 * }
+	 * @endcode
+	 */
+	bool stats(uint32_t peer, link_stats &stats);
+
+	/**
+	 * @brief Get a percentile of the RSSI of a peer
+	 *
+	 * ```cpp
+	 * int16_t rssiPercentile(uint32_t peer, uint8_t percent);
+	 * ```
+	 * @param peer peer ID
+	 * @param percent percentile 0 - 100
+	 * @return int16_t RSSI in dBm, limited to LINK_RSSI_MIN - LINK_RSSI_MAX, LINK_RSSI_MIN if the peer is unknown
+	 */
+	int16_t rssiPercentile(uint32_t peer, uint8_t percent);
+
+	/**
+	 * @brief Get a percentile of the SNR of a peer
+	 *
+	 * ```cpp
+	 * int8_t snrPercentile(uint32_t peer, uint8_t percent);
+	 * ```
+	 * @param peer peer ID
+	 * @param percent percentile 0 - 100
+	 * @return int8_t SNR in dB, limited to LINK_SNR_MIN - LINK_SNR_MAX, LINK_SNR_MIN if the peer is unknown
+	 */
+	int8_t snrPercentile(uint32_t peer, uint8_t percent);
+
+	/**
+	 * @brief Get the number of known peers
+	 *
+	 * ```cpp
+	 * uint8_t peers(void);
+	 * ```
+	 * @return uint8_t number of peers
+	 */
+	uint8_t peers(void);
+
+	/**
+	 * @brief Get the ID of a known peer
+	 *
+	 * ```cpp
+	 * uint32_t peer(uint8_t idx);
+	 * ```
+	 * @param idx index, 0 to peers() - 1
+	 * @return uint32_t peer ID, 0 if the index is invalid
+	 */
+	uint32_t peer(uint8_t idx);
+
+	/**
+	 * @brief Remove a peer, or all peers
+	 *
+	 * ```cpp
+	 * void clear(uint32_t peer);
+	 * void clear(void);
+	 * ```
+	 * @param peer peer ID
+	 */
+	void clear(uint32_t peer);
+	void clear(void);
+
+private:
+	/**
+	 * @brief Find a peer
+	 *
+	 * @param peer peer ID
+	 * @return link_peer* peer, NULL if unknown
+	 */
+	link_peer *find(uint32_t peer);
+
+	/**
+	 * @brief Clear the statistics of a peer
+	 *
+	 * @param entry peer
+	 * @param peer peer ID
+	 * @param seq first sequence number
+	 */
+	void start(link_peer *entry, uint32_t peer, uint16_t seq);
+
+	/**
+	 * @brief Get a percentile from a histogram
+	 *
+	 * @param hist histogram
+	 * @param bins number of bins
+	 * @param count number of values
+	 * @param percent percentile 0 - 100
+	 * @return uint16_t bin
+	 */
+	uint16_t percentile(const uint8_t *hist, uint16_t bins, uint8_t count, uint8_t percent);
+
+	/** Peers */
+	link_peer _peers[LINK_MAX_PEERS];
+};
+
+#endif // _RUI3_LINK_H_
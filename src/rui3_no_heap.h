@@ -0,0 +1,20 @@
+/**
+ * @file rui3_no_heap.h
+ * @author Bernd Giesecke (bernd@giesecke.tk)
+ * @brief Compile time check for the heap free mode
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ * @copyright Copyright (c) 2026
+ *
+ * Include as the last header in every source file of the library.
+ * With RUI3_NO_HEAP set to 1, any use of String or dynamic memory in the library code fails to compile.
+ */
+#ifndef _RUI3_NO_HEAP_H_
+#define _RUI3_NO_HEAP_H_
+
+#if RUI3_NO_HEAP > 0
+#pragma GCC poison String malloc calloc realloc free strdup new
+#endif
+
+#endif // _RUI3_NO_HEAP_H_
@@ -0,0 +1,189 @@
+/**
+ * @file rui3_p2p_burst.cpp
+ * @author Bernd Giesecke (bernd@giesecke.tk)
+ * @brief LoRa P2P burst TX, sends a list of packets back to back
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#include <Arduino.h>
+#include "rui3_p2p_burst.h"
+#include "rui3_no_heap.h"
+
+RUI3P2PBurst::RUI3P2PBurst(RUI3 &rui3) : _rui3(rui3)
+{
+	memset(&_stats, 0, sizeof(_stats));
+}
+
+void RUI3P2PBurst::setReceiver(RUI3P2PReceiver *receiver)
+{
+	_receiver = receiver;
+}
+
+bool RUI3P2PBurst::begin(const p2p_burst_item *items, uint16_t num, p2p_burst_timing *timing)
+{
+	if (_busy || (items == NULL) || (num == 0))
+	{
+		return false;
+	}
+	_items = items;
+	_num = num;
+	_timing = timing;
+	_index = 0;
+	_tx_active = false;
+	_started = false;
+	memset(&_stats, 0, sizeof(_stats));
+	if (_timing != NULL)
+	{
+		memset(_timing, 0, num * sizeof(p2p_burst_timing));
+	}
+	_busy = true;
+	_cmd_flush = _rui3.getCmdFlush();
+	_start = millis();
+	_tx_done = _start;
+	next();
+	return true;
+}
+
+void RUI3P2PBurst::next(void)
+{
+	while (_index < _num)
+	{
+		uint32_t now = millis();
+		bool ok = _rui3.sendP2PData(_items[_index].data, _items[_index].len);
+		// The first command is flushed as before, then every event is read by loop()
+		_rui3.setCmdFlush(false);
+		uint32_t accepted = millis();
+		if (_timing != NULL)
+		{
+			_timing[_index].start = now - _start;
+			_timing[_index].cmd = accepted - now;
+		}
+		if (ok)
+		{
+			_tx_active = true;
+			_tx_start = now;
+			_tx_timeout = _rui3.getTxTimeout();
+			_tx_airtime = _rui3.getTxAirtime();
+			if (!_started)
+			{
+				_started = true;
+				_first = accepted;
+			}
+			else if ((accepted - _tx_done) > _stats.gap_max)
+			{
+				_stats.gap_max = accepted - _tx_done;
+			}
+			return;
+		}
+		MYLOG("burst", "Packet %d not accepted: %s", _index, _rui3.ret);
+		if (_timing != NULL)
+		{
+			_timing[_index].result = P2P_BURST_FAILED;
+		}
+		_stats.failed++;
+		_index++;
+	}
+	_busy = false;
+	_rui3.setCmdFlush(_cmd_flush);
+	MYLOG("burst", "%u sent, %u failed in %lu ms", _stats.sent, _stats.failed, (unsigned long)_stats.elapsed);
+}
+
+void RUI3P2PBurst::finish(uint8_t result)
+{
+	_tx_active = false;
+	_tx_done = millis();
+	if (_timing != NULL)
+	{
+		_timing[_index].done = _tx_done - _start;
+		_timing[_index].airtime = _tx_airtime;
+		_timing[_index].result = result;
+	}
+	if (result == P2P_BURST_DONE)
+	{
+		_stats.sent++;
+		_stats.airtime += _tx_airtime;
+	}
+	else
+	{
+		_stats.failed++;
+	}
+	_stats.elapsed = _tx_done - _first;
+	_index++;
+}
+
+void RUI3P2PBurst::loop(void)
+{
+	if (!_busy)
+	{
+		return;
+	}
+	while (_rui3.pollLine())
+	{
+		bool tx_done = strstr(_rui3.ret, "+EVT:TXP2P DONE") != NULL;
+		if (_receiver != NULL)
+		{
+			_receiver->event(_rui3.ret);
+		}
+		if (tx_done && _tx_active)
+		{
+			finish(P2P_BURST_DONE);
+			next();
+			if (!_busy)
+			{
+				return;
+			}
+		}
+	}
+	if (_tx_active && ((millis() - _tx_start) >= _tx_timeout))
+	{
+		MYLOG("burst", "TX done timeout packet %d", _index);
+		finish(P2P_BURST_TIMEOUT);
+		next();
+	}
+}
+
+bool RUI3P2PBurst::run(const p2p_burst_item *items, uint16_t num, p2p_burst_timing *timing)
+{
+	if (!begin(items, num, timing))
+	{
+		return false;
+	}
+	while (_busy)
+	{
+		loop();
+		yield();
+	}
+	return _stats.failed == 0;
+}
+
+bool RUI3P2PBurst::busy(void)
+{
+	return _busy;
+}
+
+p2p_burst_stats RUI3P2PBurst::stats(void)
+{
+	return _stats;
+}
+
+float RUI3P2PBurst::packetsPerSecond(void)
+{
+	if (_stats.elapsed == 0)
+	{
+		return 0.0;
+	}
+	return _stats.sent * 1000.0 / _stats.elapsed;
+}
+
+float RUI3P2PBurst::dutyUsage(void)
+{
+	if (_stats.elapsed == 0)
+	{
+		return 0.0;
+	}
+	// airtime in microseconds, elapsed in milliseconds
+	return _stats.airtime / (_stats.elapsed * 10.0);
+}
@@ -0,0 +1,241 @@
+/**
+ * @file rui3_p2p_burst.h
+ * @author Bernd Giesecke (bernd@giesecke.tk)
+ * @brief LoRa P2P burst TX, sends a list of packets back to back
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ * @copyright Copyright (c) 2026
+ *
+ * The module accepts the next AT+PSEND only after the TX done of the previous packet. The burst reads the events
+ * line by line and sends the next packet as soon as the TX done event arrives. While the burst runs, the flush before
+ * each command is disabled (see RUI3::setCmdFlush()), so the gap between two packets is only the command transfer.
+ */
+#ifndef _RUI3_P2P_BURST_H_
+#define _RUI3_P2P_BURST_H_
+#include "rui3_at.h"
+#include "rui3_p2p_rx.h"
+
+/** Packet results */
+#define P2P_BURST_PENDING 0
+#define P2P_BURST_DONE 1
+#define P2P_BURST_FAILED 2
+#define P2P_BURST_TIMEOUT 3
+
+/** Packet of a burst */
+typedef struct _p2p_burst_item
+{
+	const uint8_t *data; // Payload
+	uint16_t len;		 // Payload length
+} p2p_burst_item;
+
+/** Timing of a packet, times in milliseconds from the start of the burst */
+typedef struct _p2p_burst_timing
+{
+	uint32_t start;	  // AT+PSEND sent
+	uint32_t done;	  // TX done received
+	uint32_t airtime; // Time-on-air in microseconds
+	uint16_t cmd;	  // Time until the module accepted the command
+	uint8_t result;	  // P2P_BURST_PENDING, P2P_BURST_DONE, P2P_BURST_FAILED or P2P_BURST_TIMEOUT
+} p2p_burst_timing;
+
+/** Statistics of a burst */
+typedef struct _p2p_burst_stats
+{
+	uint16_t sent;	  // Packets with TX done
+	uint16_t failed;  // Packets not accepted by the module or without TX done
+	uint32_t elapsed; // Time from the start of the first TX to the last TX done in milliseconds
+	uint32_t airtime; // Sum of the time-on-air of the sent packets in microseconds
+	uint16_t gap_max; // Longest time from a TX done to the start of the next TX in milliseconds
+} p2p_burst_stats;
+
+/**
+ * @brief LoRa P2P burst TX
+ */
+class RUI3P2PBurst
+{
+public:
+	/**
+	 * @brief Create the burst sender
+	 *
+	 * @param rui3 RUI3 instance in P2P mode
+	 */
+	RUI3P2PBurst(RUI3 &rui3);
+
+	/**
+	 * @brief Pass all events read during a burst to a P2P receiver
+	 * The receiver has to use P2P_RX_PERMANENT_TX or be stopped, otherwise the module is in RX and refuses to send
+	 *
+	 * ```cpp
+	 * void setReceiver(RUI3P2PReceiver *receiver);
+	 * ```
+	 * @param receiver P2P receiver, NULL to drop the events
+	 */
+	void setReceiver(RUI3P2PReceiver *receiver);
+
+	/**
+	 * @brief Start a burst, the first packet is sent immediately
+	 * The packet list and the timing array have to stay valid until the burst is finished
+	 *
+	 * ```cpp
+	 * bool begin(const p2p_burst_item *items, uint16_t num, p2p_burst_timing *timing = NULL);
+	 * ```
+	 * @param items packets
+	 * @param num number of packets
+	 * @param timing array of num entries for the per-packet timing, NULL if not needed
+	 * @return true Burst started
+	 * @return false Burst already running or no packets
+	 *
+	 * @par Usage
+	 * @code
+	 * RUI3P2PBurst burst(wisduo);
+	 * p2p_burst_item items[16];
+	 * p2p_burst_timing timing[16];
+	 * // ... fill items with log records
+	 * burst.begin(items, 16, timing);
+	 * while (burst.busy())
+	 * {
+	 * 	burst.loop();
+	 * }
+	 * @endcode
+	 */
+	bool begin(const p2p_burst_item *items, uint16_t num, p2p_burst_timing *timing = NULL);
+
+	/**
+	 * @brief Read the events of the module and send the next packet after each TX done
+	 * Has to be called frequently while busy() returns true
+	 *
+	 * ```cpp
+	 * void loop(void);
+	 * ```
+	 */
+	void loop(void);
+
+	/**
+	 * @brief Send a list of packets and wait until the burst is finished
+	 *
+	 * ```cpp
+	 * bool run(const p2p_burst_item *items, uint16_t num, p2p_burst_timing *timing = NULL);
+	 * ```
+	 * @param items packets
+	 * @param num number of packets
+	 * @param timing array of num entries for the per-packet timing, NULL if not needed
+	 * @return true All packets were sent
+	 * @return false Burst already running, a packet was not accepted or had no TX done
+	 *
+	 * @par Usage
+	 * @code
+	 * if (burst.run(items, 16))
+	 * {
+	 * 	Serial.printf("%.1f packets/s, %.1f%% duty\r\n", burst.packetsPerSecond(), burst.dutyUsage());
+	 * }
+	 * @endcode
+	 */
+	bool run(const p2p_burst_item *items, uint16_t num, p2p_burst_timing *timing = NULL);
+
+	/**
+	 * @brief Check if a burst is running
+	 *
+	 * ```cpp
+	 * bool busy(void);
+	 * ```
+	 * @return true Burst is running
+	 * @return false No burst or burst finished
+	 */
+	bool busy(void);
+
+	/**
+	 * @brief Get the statistics of the running or last burst
+	 *
+	 * ```cpp
+	 * p2p_burst_stats stats(void);
+	 * ```
+	 * @return p2p_burst_stats statistics
+	 */
+	p2p_burst_stats stats(void);
+
+	/**
+	 * @brief Get the achieved packet rate of the last burst
+	 *
+	 * ```cpp
+	 * float packetsPerSecond(void);
+	 * ```
+	 * @return float sent packets per second
+	 */
+	float packetsPerSecond(void);
+
+	/**
+	 * @brief Get the share of the burst time the radio was sending
+	 *
+	 * ```cpp
+	 * float dutyUsage(void);
+	 * ```
+	 * @return float time-on-air in percent of the burst time
+	 */
+	float dutyUsage(void);
+
+private:
+	/**
+	 * @brief Send the next packet, packets that are not accepted are skipped
+	 */
+	void next(void);
+
+	/**
+	 * @brief End the active packet
+	 *
+	 * @param result P2P_BURST_DONE or P2P_BURST_TIMEOUT
+	 */
+	void finish(uint8_t result);
+
+	RUI3 &_rui3;
+
+	/** P2P receiver for the events, NULL if not used */
+	RUI3P2PReceiver *_receiver = NULL;
+
+	/** Packets of the burst */
+	const p2p_burst_item *_items = NULL;
+
+	/** Per-packet timing, NULL if not used */
+	p2p_burst_timing *_timing = NULL;
+
+	/** Number of packets */
+	uint16_t _num = 0;
+
+	/** Next packet to send */
+	uint16_t _index = 0;
+
+	/** True while a TX is active */
+	bool _tx_active = false;
+
+	/** True while the burst is running */
+	bool _busy = false;
+
+	/** True after the module accepted the first packet */
+	bool _started = false;
+
+	/** Flush setting before the burst */
+	bool _cmd_flush = true;
+
+	/** Start time of the burst */
+	uint32_t _start = 0;
+
+	/** Time the module accepted the first packet */
+	uint32_t _first = 0;
+
+	/** Start time of the active TX */
+	uint32_t _tx_start = 0;
+
+	/** TX done timeout of the active TX */
+	uint32_t _tx_timeout = 0;
+
+	/** Time-on-air of the active TX */
+	uint32_t _tx_airtime = 0;
+
+	/** Time of the last TX done */
+	uint32_t _tx_done = 0;
+
+	/** Statistics */
+	p2p_burst_stats _stats;
+};
+
+#endif // _RUI3_P2P_BURST_H_
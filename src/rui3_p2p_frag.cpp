@@ -0,0 +1,362 @@
+/**
+ * @file rui3_p2p_frag.cpp
+ * @author Bernd Giesecke (bernd@giesecke.tk)
+ * @brief LoRa P2P transfer of data larger than one packet with fragmentation and selective retransmission
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#include <Arduino.h>
+#include "rui3_p2p_frag.h"
+#include "rui3_no_heap.h"
+
+RUI3P2PTransfer::RUI3P2PTransfer(RUI3 &rui3) : _rui3(rui3)
+{
+	memset(&_stats, 0, sizeof(_stats));
+}
+
+bool RUI3P2PTransfer::begin(void)
+{
+	// The receiver answers a known ID with the final NACK, only a seeded random() gives a different ID after a reset
+	_tx_id = random(256);
+	// The flush before each command would drop fragments and NACKs, all events are read by loop()
+	_rui3.setCmdFlush(false);
+	return _rui3.setP2PReceive(P2P_RX_PERMANENT_TX);
+}
+
+void RUI3P2PTransfer::setReceiver(RUI3P2PReceiver *receiver)
+{
+	_receiver = receiver;
+}
+
+void RUI3P2PTransfer::setFragmentSize(uint8_t size)
+{
+	if ((size == 0) || (size > sizeof(_frame) - P2P_FRAG_HEADER))
+	{
+		return;
+	}
+	_frag_size = size;
+}
+
+uint16_t RUI3P2PTransfer::nextBit(const uint8_t *bitmap, uint16_t from, uint16_t num)
+{
+	for (; from < num; from++)
+	{
+		if ((bitmap[from / 8] & (1 << (from % 8))) != 0)
+		{
+			return from;
+		}
+	}
+	return num;
+}
+
+bool RUI3P2PTransfer::send(const uint8_t *data, uint32_t len)
+{
+	if ((_tx_status == P2P_FRAG_SENDING) || (_tx_status == P2P_FRAG_WAITING) || (len == 0) ||
+		(len > (uint32_t)P2P_FRAG_MAX * _frag_size))
+	{
+		return false;
+	}
+	_tx_data = data;
+	_tx_id++;
+	_tx_size = _frag_size;
+	_tx_num = (len + _tx_size - 1) / _tx_size;
+	_tx_next = 0;
+	_tx_last = _tx_num - 1;
+	memset(_tx_missing, 0, sizeof(_tx_missing));
+	memset(_tx_sent, 0, sizeof(_tx_sent));
+	for (uint16_t idx = 0; idx < _tx_num; idx++)
+	{
+		_tx_missing[idx / 8] |= 1 << (idx % 8);
+	}
+	memset(&_stats, 0, sizeof(_stats));
+	_stats.len = len;
+	_nack_retries = 0;
+	_tx_first = millis();
+	_tx_status = P2P_FRAG_SENDING;
+	MYLOG("frag", "Transfer %d: %lu bytes in %d fragments", _tx_id, (unsigned long)len, _tx_num);
+	return true;
+}
+
+uint8_t RUI3P2PTransfer::status(void)
+{
+	return _tx_status;
+}
+
+void RUI3P2PTransfer::listen(uint8_t *buffer, uint32_t size)
+{
+	_rx_buffer = buffer;
+	_rx_size = size;
+	_rx_len = 0;
+	_rx_active = false;
+}
+
+uint32_t RUI3P2PTransfer::available(void)
+{
+	return _rx_len;
+}
+
+bool RUI3P2PTransfer::transmit(uint16_t len)
+{
+	if (!_rui3.sendP2PData(_frame, len))
+	{
+		return false;
+	}
+	_tx_active = true;
+	_tx_start = millis();
+	_tx_timeout = _rui3.getTxTimeout();
+	return true;
+}
+
+void RUI3P2PTransfer::sendFragment(void)
+{
+	uint16_t idx = nextBit(_tx_missing, _tx_next, _tx_num);
+	if (idx >= _tx_num)
+	{
+		// The last fragment of the round was not missing anymore
+		idx = _tx_last;
+	}
+	uint32_t offset = (uint32_t)idx * _tx_size;
+	uint16_t len = _stats.len - offset < _tx_size ? _stats.len - offset : _tx_size;
+	_frame[0] = idx >= _tx_last ? P2P_FRAG_END : P2P_FRAG_DATA;
+	_frame[1] = _tx_id;
+	_frame[2] = idx;
+	_frame[3] = _tx_num;
+	_frame[4] = _tx_size;
+	memcpy(&_frame[P2P_FRAG_HEADER], &_tx_data[offset], len);
+	if (!transmit(P2P_FRAG_HEADER + len))
+	{
+		// Module busy, try again with the next loop()
+		return;
+	}
+	_stats.fragments++;
+	_stats.bytes += P2P_FRAG_HEADER + len;
+	_stats.airtime += _rui3.getTxAirtime();
+	if ((_tx_sent[idx / 8] & (1 << (idx % 8))) != 0)
+	{
+		_stats.retransmits++;
+	}
+	_tx_sent[idx / 8] |= 1 << (idx % 8);
+	_tx_next = idx + 1;
+	if (idx >= _tx_last)
+	{
+		// The NACK timeout starts with the TX done, the receiver needs a command and the time-on-air of the NACK
+		_tx_status = P2P_FRAG_WAITING;
+		_nack_timeout = _rui3.getP2PAirtime(3 + (_tx_num + 7) / 8) / 1000 + 1 + _rui3.getCmdTimeout(AT_CLASS_TX) +
+						P2P_FRAG_TURNAROUND;
+	}
+}
+
+void RUI3P2PTransfer::sendNack(void)
+{
+	uint8_t bytes = (_rx_num + 7) / 8;
+	_frame[0] = P2P_FRAG_NACK;
+	_frame[1] = _rx_id;
+	_frame[2] = _rx_num;
+	memcpy(&_frame[3], _rx_missing, bytes);
+	if (transmit(3 + bytes))
+	{
+		_nack_pending = false;
+	}
+}
+
+void RUI3P2PTransfer::fragment(const uint8_t *frame, uint16_t len)
+{
+	uint8_t id = frame[1];
+	uint8_t idx = frame[2];
+	uint8_t num = frame[3];
+	uint8_t size = frame[4];
+	uint16_t data_len = len - P2P_FRAG_HEADER;
+	if ((len <= P2P_FRAG_HEADER) || (num == 0) || (num > P2P_FRAG_MAX) || (idx >= num) || (data_len > size) ||
+		((idx < num - 1) && (data_len != size)))
+	{
+		return;
+	}
+	if (!_rx_active && (_rx_num != 0) && (id == _rx_id))
+	{
+		// Fragment of the last complete transfer, the final NACK was lost
+		if (frame[0] == P2P_FRAG_END)
+		{
+			_nack_pending = true;
+		}
+		return;
+	}
+	if (!_rx_active || (id != _rx_id))
+	{
+		if ((_rx_buffer == NULL) || (_rx_len != 0) || ((uint32_t)(num - 1) * size >= _rx_size))
+		{
+			// No buffer, the last transfer was not taken or the data does not fit
+			return;
+		}
+		MYLOG("frag", "Receive transfer %d: %d fragments", id, num);
+		_rx_active = true;
+		_rx_id = id;
+		_rx_num = num;
+		_rx_size_frag = size;
+		_rx_last_len = 0;
+		memset(_rx_missing, 0, sizeof(_rx_missing));
+		for (uint16_t bit = 0; bit < num; bit++)
+		{
+			_rx_missing[bit / 8] |= 1 << (bit % 8);
+		}
+	}
+	if ((num != _rx_num) || (size != _rx_size_frag))
+	{
+		return;
+	}
+	uint32_t offset = (uint32_t)idx * size;
+	if (offset + data_len > _rx_size)
+	{
+		// The sender gets no NACK and gives up
+		MYLOG("frag", "Transfer %d does not fit", id);
+		_rx_active = false;
+		_rx_num = 0;
+		return;
+	}
+	if ((_rx_missing[idx / 8] & (1 << (idx % 8))) != 0)
+	{
+		memcpy(&_rx_buffer[offset], &frame[P2P_FRAG_HEADER], data_len);
+		_rx_missing[idx / 8] &= ~(1 << (idx % 8));
+		if (idx == num - 1)
+		{
+			_rx_last_len = data_len;
+		}
+	}
+	if (frame[0] == P2P_FRAG_END)
+	{
+		_nack_pending = true;
+	}
+	if (nextBit(_rx_missing, 0, num) == num)
+	{
+		_rx_len = (uint32_t)(num - 1) * size + _rx_last_len;
+		_rx_active = false;
+		MYLOG("frag", "Transfer %d complete, %lu bytes", id, (unsigned long)_rx_len);
+	}
+}
+
+void RUI3P2PTransfer::nack(const uint8_t *frame, uint16_t len)
+{
+	uint8_t bytes = (frame[2] + 7) / 8;
+	if ((_tx_status != P2P_FRAG_WAITING) || (frame[1] != _tx_id) || (frame[2] != _tx_num) || (len < 3 + bytes))
+	{
+		return;
+	}
+	memcpy(_tx_missing, &frame[3], bytes);
+	_nack_retries = 0;
+	uint16_t last = _tx_num;
+	for (uint16_t idx = nextBit(_tx_missing, 0, _tx_num); idx < _tx_num; idx = nextBit(_tx_missing, idx + 1, _tx_num))
+	{
+		last = idx;
+	}
+	if (last == _tx_num)
+	{
+		_stats.elapsed = millis() - _tx_first;
+		_tx_status = P2P_FRAG_DONE;
+		MYLOG("frag", "Transfer %d done in %lu ms", _tx_id, (unsigned long)_stats.elapsed);
+		return;
+	}
+	_stats.rounds++;
+	_tx_next = 0;
+	_tx_last = last;
+	_tx_status = P2P_FRAG_SENDING;
+}
+
+bool RUI3P2PTransfer::event(char *line)
+{
+	if (strstr(line, "+EVT:TXP2P DONE") != NULL)
+	{
+		_tx_active = false;
+		_nack_start = millis();
+		if (_receiver != NULL)
+		{
+			_receiver->event(line);
+		}
+		return true;
+	}
+	rx_packet packet;
+	if (!parseRX(line, packet, _frame, sizeof(_frame)) || (packet.window != RX_WINDOW_P2P) || (packet.data == NULL) ||
+		(packet.len < 3))
+	{
+		return false;
+	}
+	switch (_frame[0])
+	{
+	case P2P_FRAG_DATA:
+	case P2P_FRAG_END:
+		fragment(_frame, packet.len);
+		return true;
+	case P2P_FRAG_NACK:
+		nack(_frame, packet.len);
+		return true;
+	default:
+		return false;
+	}
+}
+
+void RUI3P2PTransfer::loop(void)
+{
+	while (_rui3.pollLine())
+	{
+		if (!event(_rui3.ret) && (_receiver != NULL))
+		{
+			_receiver->event(_rui3.ret);
+		}
+	}
+	if (_tx_active)
+	{
+		if ((millis() - _tx_start) < _tx_timeout)
+		{
+			return;
+		}
+		MYLOG("frag", "TX done timeout");
+		_tx_active = false;
+		_nack_start = millis();
+	}
+	if (_nack_pending)
+	{
+		sendNack();
+		return;
+	}
+	if (_tx_status == P2P_FRAG_SENDING)
+	{
+		sendFragment();
+	}
+	else if ((_tx_status == P2P_FRAG_WAITING) && ((millis() - _nack_start) >= _nack_timeout))
+	{
+		_stats.timeouts++;
+		if (++_nack_retries > P2P_FRAG_RETRIES)
+		{
+			MYLOG("frag", "Transfer %d failed, no NACK", _tx_id);
+			_tx_status = P2P_FRAG_FAILED;
+			return;
+		}
+		// Ask for the NACK again with the last fragment of the round
+		_tx_next = _tx_last;
+		_tx_status = P2P_FRAG_SENDING;
+	}
+}
+
+p2p_transfer_stats RUI3P2PTransfer::stats(void)
+{
+	return _stats;
+}
+
+float RUI3P2PTransfer::goodput(void)
+{
+	if ((_tx_status != P2P_FRAG_DONE) || (_stats.elapsed == 0))
+	{
+		return 0.0;
+	}
+	return _stats.len * 1000.0 / _stats.elapsed;
+}
+
+float RUI3P2PTransfer::efficiency(void)
+{
+	if (_stats.bytes == 0)
+	{
+		return 0.0;
+	}
+	return _stats.len * 100.0 / _stats.bytes;
+}
@@ -0,0 +1,397 @@
+/**
+ * @file rui3_p2p_frag.h
+ * @author Bernd Giesecke (bernd@giesecke.tk)
+ * @brief LoRa P2P transfer of data larger than one packet with fragmentation and selective retransmission
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ * @copyright Copyright (c) 2026
+ *
+ * The sender splits the data into numbered fragments and sends them back to back. The last fragment of a round
+ * asks the receiver for a NACK, a bitmap with one bit per missing fragment. Only the missing fragments are sent
+ * again in the next round. A NACK without missing fragments ends the transfer.
+ *
+ * Fragment: type (P2P_FRAG_DATA or P2P_FRAG_END), transfer ID, fragment index, number of fragments, fragment size, data
+ * NACK: type (P2P_FRAG_NACK), transfer ID, number of fragments, bitmap of the missing fragments (bit 0 of byte 0 = fragment 0)
+ */
+#ifndef _RUI3_P2P_FRAG_H_
+#define _RUI3_P2P_FRAG_H_
+#include "rui3_at.h"
+#include "rui3_rx.h"
+#include "rui3_p2p_rx.h"
+
+/** Max number of fragments of a transfer, max 255 */
+#ifndef P2P_FRAG_MAX
+#define P2P_FRAG_MAX 64
+#endif
+
+#if P2P_FRAG_MAX > 255
+#error "P2P_FRAG_MAX must not be larger than 255"
+#endif
+
+/** Default payload of a fragment, max 250 */
+#ifndef P2P_FRAG_SIZE
+#define P2P_FRAG_SIZE 240
+#endif
+
+/** Time the receiver needs from the last fragment to the NACK command in milliseconds, added to the command timeout and the time-on-air of the NACK */
+#ifndef P2P_FRAG_TURNAROUND
+#define P2P_FRAG_TURNAROUND 500
+#endif
+
+/** Number of NACK timeouts before the transfer fails */
+#ifndef P2P_FRAG_RETRIES
+#define P2P_FRAG_RETRIES 5
+#endif
+
+/** Size of the fragment header */
+#define P2P_FRAG_HEADER 5
+
+/** Frame types */
+#define P2P_FRAG_DATA 0xD0
+#define P2P_FRAG_END 0xD1
+#define P2P_FRAG_NACK 0xDA
+
+/** Transfer status */
+#define P2P_FRAG_IDLE 0
+#define P2P_FRAG_SENDING 1
+#define P2P_FRAG_WAITING 2
+#define P2P_FRAG_DONE 3
+#define P2P_FRAG_FAILED 4
+
+/** Statistics of the last transfer */
+typedef struct _p2p_transfer_stats
+{
+	uint32_t len;		  // Data length
+	uint32_t bytes;		  // Bytes sent, including headers and retransmissions
+	uint32_t airtime;	  // Time-on-air of all fragments in microseconds
+	uint32_t elapsed;	  // Time from the first fragment to the final NACK in milliseconds
+	uint16_t fragments;	  // Fragments sent, including retransmissions
+	uint16_t retransmits; // Fragments sent again
+	uint8_t rounds;		  // NACKs with missing fragments
+	uint8_t timeouts;	  // Rounds without NACK
+} p2p_transfer_stats;
+
+/**
+ * @brief LoRa P2P transfer of large data
+ */
+class RUI3P2PTransfer
+{
+public:
+	/**
+	 * @brief Create the transfer
+	 *
+	 * @param rui3 RUI3 instance in P2P mode
+	 */
+	RUI3P2PTransfer(RUI3 &rui3);
+
+	/**
+	 * @brief Start RX, it is kept on after each TX to receive fragments and NACKs
+	 * The flush before each command is disabled (see RUI3::setCmdFlush()), it would drop fragments and NACKs
+	 * The first transfer ID is taken from random(). Call randomSeed() with a value that changes per boot before begin(),
+	 * random() is not seeded by the Arduino cores and returns the same ID after each reset. The receiver takes a
+	 * transfer with the ID of the last transfer as a repeat and answers it only with the final NACK.
+	 *
+	 * ```cpp
+	 * bool begin(void);
+	 * ```
+	 * @return true Success
+	 * @return false No response or error response
+	 *
+	 * @par Usage
+	 * @code
+	 * RUI3 wisduo(Serial1, Serial);
+	 * RUI3P2PTransfer transfer(wisduo);
+	 * uint8_t rx_buffer[8192];
+	 * void setup()
+	 * {
+	 * 	// ... initP2P()
+	 * 	randomSeed(analogRead(A0)); // Any value that changes per boot
+	 * 	transfer.begin();
+	 * 	transfer.listen(rx_buffer, sizeof(rx_buffer));
+	 * }
+	 * @endcode
+	 */
+	bool begin(void);
+
+	/**
+	 * @brief Pass all events that are not part of a transfer to a P2P receiver
+	 *
+	 * ```cpp
+	 * void setReceiver(RUI3P2PReceiver *receiver);
+	 * ```
+	 * @param receiver P2P receiver, NULL to drop the events
+	 */
+	void setReceiver(RUI3P2PReceiver *receiver);
+
+	/**
+	 * @brief Set the payload of the fragments
+	 * Smaller fragments have less time-on-air and lose less data per lost packet
+	 *
+	 * ```cpp
+	 * void setFragmentSize(uint8_t size);
+	 * ```
+	 * @param size payload of a fragment, 1 to 250, default P2P_FRAG_SIZE
+	 */
+	void setFragmentSize(uint8_t size);
+
+	/**
+	 * @brief Start sending data, the data has to stay valid until the transfer is finished
+	 *
+	 * ```cpp
+	 * bool send(const uint8_t *data, uint32_t len);
+	 * ```
+	 * @param data data
+	 * @param len data length, max P2P_FRAG_MAX fragments
+	 * @return true Transfer started
+	 * @return false Transfer active or data too long
+	 *
+	 * @par Usage
+	 * @code
+	 * transfer.send(config_blob, sizeof(config_blob));
+	 * while ((transfer.status() == P2P_FRAG_SENDING) || (transfer.status() == P2P_FRAG_WAITING))
+	 * {
+	 * 	transfer.loop();
+	 * }
+	 * if (transfer.status() == P2P_FRAG_DONE)
+	 * {
+	 * 	Serial.printf("%.0f bytes/s\r\n", transfer.goodput());
+	 * }
+	 * @endcode
+	 */
+	bool send(const uint8_t *data, uint32_t len);
+
+	/**
+	 * @brief Get the status of the send transfer
+	 *
+	 * ```cpp
+	 * uint8_t status(void);
+	 * ```
+	 * @return uint8_t P2P_FRAG_IDLE, P2P_FRAG_SENDING, P2P_FRAG_WAITING, P2P_FRAG_DONE or P2P_FRAG_FAILED
+	 */
+	uint8_t status(void);
+
+	/**
+	 * @brief Set the buffer for received data and accept a new transfer
+	 *
+	 * ```cpp
+	 * void listen(uint8_t *buffer, uint32_t size);
+	 * ```
+	 * @param buffer buffer for the received data
+	 * @param size buffer size, transfers with more data are ignored
+	 */
+	void listen(uint8_t *buffer, uint32_t size);
+
+	/**
+	 * @brief Get the length of the received data
+	 * After a complete transfer no further transfer is accepted until listen() is called again
+	 *
+	 * ```cpp
+	 * uint32_t available(void);
+	 * ```
+	 * @return uint32_t data length, 0 if no transfer is complete
+	 *
+	 * @par Usage
+	 * @code
+	 * transfer.loop();
+	 * if (transfer.available() != 0)
+	 * {
+	 * 	apply_config(rx_buffer, transfer.available());
+	 * 	transfer.listen(rx_buffer, sizeof(rx_buffer));
+	 * }
+	 * @endcode
+	 */
+	uint32_t available(void);
+
+	/**
+	 * @brief Read the events of the module, send fragments and NACKs
+	 * Has to be called frequently, e.g. from the Arduino loop()
+	 *
+	 * ```cpp
+	 * void loop(void);
+	 * ```
+	 */
+	void loop(void);
+
+	/**
+	 * @brief Handle an event read elsewhere
+	 *
+	 * ```cpp
+	 * bool event(char *line);
+	 * ```
+	 * @param line received line
+	 * @return true Line was a TX done, a fragment or a NACK
+	 * @return false Other line
+	 */
+	bool event(char *line);
+
+	/**
+	 * @brief Get the statistics of the last send transfer
+	 *
+	 * ```cpp
+	 * p2p_transfer_stats stats(void);
+	 * ```
+	 * @return p2p_transfer_stats statistics
+	 */
+	p2p_transfer_stats stats(void);
+
+	/**
+	 * @brief Get the data rate of the last send transfer
+	 *
+	 * ```cpp
+	 * float goodput(void);
+	 * ```
+	 * @return float data bytes per second, from the first fragment to the final NACK
+	 */
+	float goodput(void);
+
+	/**
+	 * @brief Get the share of the data in all bytes sent by the last send transfer
+	 *
+	 * ```cpp
+	 * float efficiency(void);
+	 * ```
+	 * @return float data length in percent of the bytes sent, including headers and retransmissions
+	 */
+	float efficiency(void);
+
+private:
+	/**
+	 * @brief Handle a received fragment
+	 *
+	 * @param frame frame
+	 * @param len frame length
+	 */
+	void fragment(const uint8_t *frame, uint16_t len);
+
+	/**
+	 * @brief Handle a received NACK
+	 *
+	 * @param frame frame
+	 * @param len frame length
+	 */
+	void nack(const uint8_t *frame, uint16_t len);
+
+	/**
+	 * @brief Send the next missing fragment
+	 */
+	void sendFragment(void);
+
+	/**
+	 * @brief Send the NACK for the received transfer
+	 */
+	void sendNack(void);
+
+	/**
+	 * @brief Send the frame in _frame
+	 *
+	 * @param len frame length
+	 * @return true Packet is sent
+	 * @return false No response or error response
+	 */
+	bool transmit(uint16_t len);
+
+	/**
+	 * @brief Find the next bit set in a bitmap
+	 *
+	 * @param bitmap bitmap
+	 * @param from first bit
+	 * @param num number of bits
+	 * @return uint16_t bit number, num if no bit is set
+	 */
+	static uint16_t nextBit(const uint8_t *bitmap, uint16_t from, uint16_t num);
+
+	RUI3 &_rui3;
+
+	/** P2P receiver for other events, NULL if not used */
+	RUI3P2PReceiver *_receiver = NULL;
+
+	/** Frame buffer for sent and received frames */
+	uint8_t _frame[255];
+
+	/** Fragment payload */
+	uint8_t _frag_size = P2P_FRAG_SIZE;
+
+	/** True while a TX is active */
+	bool _tx_active = false;
+
+	/** Start time of the active TX */
+	uint32_t _tx_start = 0;
+
+	/** TX done timeout of the active TX */
+	uint32_t _tx_timeout = 0;
+
+	/** Data of the send transfer */
+	const uint8_t *_tx_data = NULL;
+
+	/** Status of the send transfer */
+	uint8_t _tx_status = P2P_FRAG_IDLE;
+
+	/** ID of the send transfer */
+	uint8_t _tx_id = 0;
+
+	/** Number of fragments of the send transfer */
+	uint8_t _tx_num = 0;
+
+	/** Fragment size of the send transfer */
+	uint8_t _tx_size = 0;
+
+	/** Next fragment to check in the current round */
+	uint16_t _tx_next = 0;
+
+	/** Last fragment of the current round */
+	uint8_t _tx_last = 0;
+
+	/** Fragments still to send, bit set = missing at the receiver */
+	uint8_t _tx_missing[(P2P_FRAG_MAX + 7) / 8];
+
+	/** Fragments sent at least once */
+	uint8_t _tx_sent[(P2P_FRAG_MAX + 7) / 8];
+
+	/** Start of the NACK timeout */
+	uint32_t _nack_start = 0;
+
+	/** NACK timeout */
+	uint32_t _nack_timeout = 0;
+
+	/** NACK timeouts in a row */
+	uint8_t _nack_retries = 0;
+
+	/** Start time of the send transfer */
+	uint32_t _tx_first = 0;
+
+	/** Statistics of the send transfer */
+	p2p_transfer_stats _stats;
+
+	/** Buffer for received data */
+	uint8_t *_rx_buffer = NULL;
+
+	/** Size of the buffer for received data */
+	uint32_t _rx_size = 0;
+
+	/** Length of the received data, 0 while the transfer is not complete */
+	uint32_t _rx_len = 0;
+
+	/** True while a transfer is received */
+	bool _rx_active = false;
+
+	/** ID of the received transfer */
+	uint8_t _rx_id = 0;
+
+	/** Number of fragments of the received transfer */
+	uint8_t _rx_num = 0;
+
+	/** Fragment size of the received transfer */
+	uint8_t _rx_size_frag = 0;
+
+	/** Length of the last fragment, 0 if not received yet */
+	uint8_t _rx_last_len = 0;
+
+	/** Missing fragments of the received transfer */
+	uint8_t _rx_missing[(P2P_FRAG_MAX + 7) / 8];
+
+	/** True if a NACK has to be sent */
+	bool _nack_pending = false;
+};
+
+#endif // _RUI3_P2P_FRAG_H_
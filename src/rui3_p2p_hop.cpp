@@ -0,0 +1,281 @@
+/**
+ * @file rui3_p2p_hop.cpp
+ * @author Bernd Giesecke (bernd@giesecke.tk)
+ * @brief LoRa P2P frequency hopping with a hop schedule from a shared seed
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#include <Arduino.h>
+#include "rui3_p2p_hop.h"
+#include "rui3_no_heap.h"
+
+RUI3P2PHopper::RUI3P2PHopper(RUI3 &rui3) : _rui3(rui3)
+{
+	memset(&_stats, 0, sizeof(_stats));
+	memset(&_settings, 0, sizeof(_settings));
+}
+
+bool RUI3P2PHopper::begin(const uint32_t *channels, uint8_t num, uint32_t seed, bool master)
+{
+	if ((channels == NULL) || (num == 0) || (num > P2P_HOP_MAX_CHANNELS) || !_rui3.getP2PSettings(&_settings))
+	{
+		return false;
+	}
+	_channels = channels;
+	_num = num;
+	_seed = seed;
+	_master = master;
+	_synced = master;
+	_offset = 0;
+	_cycle = 0xFFFFFFFF;
+	_tuned = 0xFF;
+	_tx_pending = false;
+	_tx_active = false;
+	_switch = P2P_HOP_GUARD;
+	_latency = P2P_HOP_GUARD;
+	// The flush before each command would drop packets and take longer than a slot, all events are read by loop()
+	_rui3.setCmdFlush(false);
+	if (_dwell == 0)
+	{
+		// One guard time to change the channel, one to start the TX and one after the TX
+		_dwell = timeOnAir(_settings, P2P_HOP_HEADER + P2P_HOP_PAYLOAD) / 1000 + 1 + 3 * P2P_HOP_GUARD;
+	}
+	MYLOG("hop", "%d channels, dwell %lu ms", _num, (unsigned long)_dwell);
+	return tune(now() / _dwell);
+}
+
+void RUI3P2PHopper::setDwell(uint32_t dwell)
+{
+	_dwell = dwell;
+}
+
+uint32_t RUI3P2PHopper::getDwell(void)
+{
+	return _dwell;
+}
+
+void RUI3P2PHopper::setHandler(p2p_handler handler)
+{
+	_handler = handler;
+}
+
+uint32_t RUI3P2PHopper::now(void)
+{
+	return millis() + _offset;
+}
+
+uint8_t RUI3P2PHopper::channel(uint32_t slot)
+{
+	uint32_t cycle = slot / _num;
+	if (cycle != _cycle)
+	{
+		// Shuffle the channels with a xorshift generator seeded by the shared seed and the cycle
+		uint32_t x = _seed ^ (cycle * 0x9E3779B9UL);
+		if (x == 0)
+		{
+			x = 1;
+		}
+		for (uint8_t idx = 0; idx < _num; idx++)
+		{
+			_order[idx] = idx;
+		}
+		for (uint8_t idx = _num - 1; idx > 0; idx--)
+		{
+			x ^= x << 13;
+			x ^= x >> 17;
+			x ^= x << 5;
+			uint8_t swap = x % (idx + 1);
+			uint8_t tmp = _order[idx];
+			_order[idx] = _order[swap];
+			_order[swap] = tmp;
+		}
+		_cycle = cycle;
+	}
+	return _order[slot % _num];
+}
+
+bool RUI3P2PHopper::tune(uint32_t slot)
+{
+	_slot = slot;
+	// A follower waits on the first channel until it has the time of the master
+	uint8_t idx = _synced ? channel(slot) : 0;
+	if (idx == _tuned)
+	{
+		return true;
+	}
+	_tuned = 0xFF;
+	uint32_t start = millis();
+	if (!_rui3.setP2PReceive(P2P_RX_OFF) || !_rui3.setP2PFrequency(_channels[idx]) ||
+		!_rui3.setP2PReceive(P2P_RX_PERMANENT_TX))
+	{
+		MYLOG("hop", "Channel change failed");
+		return false;
+	}
+	// The peer needs about the same time for its channel change
+	_switch = millis() - start;
+	_tuned = idx;
+	_stats.hops++;
+	return true;
+}
+
+bool RUI3P2PHopper::send(const uint8_t *data, uint16_t len)
+{
+	if (_tx_pending || !_synced || (len > P2P_HOP_PAYLOAD))
+	{
+		return false;
+	}
+	memcpy(&_packet[P2P_HOP_HEADER], data, len);
+	_packet_len = P2P_HOP_HEADER + len;
+	_packet_air = timeOnAir(_settings, _packet_len) / 1000 + 1;
+	_queued = now() / _dwell;
+	_tx_pending = true;
+	return true;
+}
+
+void RUI3P2PHopper::loop(void)
+{
+	while (_rui3.pollLine())
+	{
+		event(_rui3.ret);
+	}
+	if (_tx_active)
+	{
+		if ((millis() - _tx_start) < _tx_timeout)
+		{
+			// No channel change during a TX
+			return;
+		}
+		_tx_active = false;
+	}
+	if (!_master && _synced && ((millis() - _last_rx) > (uint32_t)P2P_HOP_SYNC_CYCLES * _num * _dwell))
+	{
+		MYLOG("hop", "Master lost");
+		_synced = false;
+		_stats.resyncs++;
+		tune(0);
+		return;
+	}
+	if (!_synced)
+	{
+		return;
+	}
+	uint32_t time = now();
+	uint32_t slot = time / _dwell;
+	if ((slot != _slot) || (_tuned != channel(slot)))
+	{
+		tune(slot);
+		return;
+	}
+	if (!_tx_pending)
+	{
+		return;
+	}
+	// The TX starts when the module accepted the command, one command latency from now
+	uint32_t tx_start = time % _dwell + _latency;
+	if ((tx_start < _switch + _latency) || (tx_start + _packet_air + _latency > _dwell))
+	{
+		return;
+	}
+	if (_queued != slot)
+	{
+		_stats.deferred++;
+	}
+	// Slot number and time in the slot at the TX start, LSB first
+	for (uint8_t idx = 0; idx < 4; idx++)
+	{
+		_packet[idx] = slot >> (8 * idx);
+	}
+	_packet[4] = tx_start;
+	_packet[5] = tx_start >> 8;
+	uint32_t start = millis();
+	if (!_rui3.sendP2PData(_packet, _packet_len))
+	{
+		return;
+	}
+	// Smoothed command latency, a single slow response changes it only a little
+	_latency = (3 * _latency + millis() - start) / 4;
+	// Check the slot with the time the module accepted the command
+	time = now();
+	if ((time / _dwell != slot) || (time % _dwell + _packet_air > _dwell))
+	{
+		MYLOG("hop", "TX accepted too late for slot %lu", (unsigned long)slot);
+		_stats.late++;
+	}
+	_tx_pending = false;
+	_tx_active = true;
+	_tx_start = millis();
+	_tx_timeout = _rui3.getTxTimeout();
+	_stats.sent++;
+}
+
+bool RUI3P2PHopper::event(char *line)
+{
+	if (strstr(line, "+EVT:TXP2P DONE") != NULL)
+	{
+		_tx_active = false;
+		return true;
+	}
+	uint32_t rx_time = millis();
+	rx_packet packet;
+	if (!parseRX(line, packet) || (packet.window != RX_WINDOW_P2P) || (packet.len < P2P_HOP_HEADER))
+	{
+		return false;
+	}
+	uint32_t slot = (uint32_t)packet.data[0] | ((uint32_t)packet.data[1] << 8) | ((uint32_t)packet.data[2] << 16) |
+					((uint32_t)packet.data[3] << 24);
+	uint16_t offset = packet.data[4] | (packet.data[5] << 8);
+	if (!_master)
+	{
+		// Time of the master at the RX event
+		uint32_t master_time = slot * _dwell + offset + timeOnAir(_settings, packet.len) / 1000 + P2P_HOP_LATENCY;
+		uint32_t new_offset = master_time - rx_time;
+		_error = (int32_t)(new_offset - _offset);
+		if (!_synced || (_error > (int32_t)_dwell / 2) || (_error < -(int32_t)_dwell / 2))
+		{
+			MYLOG("hop", "Synchronized, error %ld ms", (long)_error);
+			_offset = new_offset;
+			_synced = true;
+		}
+		else
+		{
+			// Follow the drift of the clocks smoothly, a single late RX event moves the clock only a little
+			_offset += _error / 4;
+		}
+		_last_rx = rx_time;
+	}
+	_stats.received++;
+	if (_handler != NULL)
+	{
+		packet.data += P2P_HOP_HEADER;
+		packet.len -= P2P_HOP_HEADER;
+		_handler(packet);
+	}
+	return true;
+}
+
+bool RUI3P2PHopper::synced(void)
+{
+	return _synced;
+}
+
+uint32_t RUI3P2PHopper::frequency(void)
+{
+	if (_tuned >= _num)
+	{
+		return 0;
+	}
+	return _channels[_tuned];
+}
+
+int32_t RUI3P2PHopper::timingError(void)
+{
+	return _error;
+}
+
+p2p_hop_stats RUI3P2PHopper::stats(void)
+{
+	return _stats;
+}
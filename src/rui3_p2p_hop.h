@@ -0,0 +1,324 @@
+/**
+ * @file rui3_p2p_hop.h
+ * @author Bernd Giesecke (bernd@giesecke.tk)
+ * @brief LoRa P2P frequency hopping with a hop schedule from a shared seed
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ * @copyright Copyright (c) 2026
+ *
+ * The time is divided into slots of one dwell time, each slot has its own channel. The channels are visited in a
+ * random order that is calculated from the shared seed, every channel is used once per cycle of num channels slots.
+ * The dwell time is the time-on-air of the longest packet plus three guard times, for the channel change, the TX start
+ * and after the TX. A packet is sent only if the TX starts one TX command latency after the measured time of a channel
+ * change and ends one TX command latency before the end of the slot. The TX start is one measured TX command latency
+ * after the command.
+ * The flush before each command is disabled (see RUI3::setCmdFlush()).
+ *
+ * The master defines the time. Each packet starts with the slot number and the time in the slot when it was sent.
+ * A follower calculates the time of the master from the RX time minus the time-on-air and corrects its clock with
+ * each packet from the master. Until the first packet is received the follower stays on the first channel, the master
+ * uses it once per cycle.
+ */
+#ifndef _RUI3_P2P_HOP_H_
+#define _RUI3_P2P_HOP_H_
+#include "rui3_at.h"
+#include "rui3_rx.h"
+#include "rui3_p2p_rx.h"
+
+/** Max number of channels */
+#ifndef P2P_HOP_MAX_CHANNELS
+#define P2P_HOP_MAX_CHANNELS 16
+#endif
+
+/** Max payload of a packet without the hop header */
+#ifndef P2P_HOP_PAYLOAD
+#define P2P_HOP_PAYLOAD 64
+#endif
+
+/** Guard time for the default dwell time in milliseconds, used as TX command latency and channel change time until they are measured */
+#ifndef P2P_HOP_GUARD
+#define P2P_HOP_GUARD 50
+#endif
+
+/** Time from the TX start to the RX event after the time-on-air in milliseconds */
+#ifndef P2P_HOP_LATENCY
+#define P2P_HOP_LATENCY 10
+#endif
+
+/** Number of cycles without a packet from the master before a follower falls back to the first channel */
+#ifndef P2P_HOP_SYNC_CYCLES
+#define P2P_HOP_SYNC_CYCLES 4
+#endif
+
+/** Size of the hop header, slot number and time in the slot */
+#define P2P_HOP_HEADER 6
+
+/** Statistics of the hopping */
+typedef struct _p2p_hop_stats
+{
+	uint32_t hops;	   // Channel changes
+	uint32_t sent;	   // Packets sent
+	uint32_t received; // Packets received
+	uint32_t deferred; // Packets that waited for the next slot
+	uint32_t resyncs;  // Follower lost the master and went back to the first channel
+	uint32_t late;	   // Packets accepted by the module too late, the TX did not fit into the slot
+} p2p_hop_stats;
+
+/**
+ * @brief LoRa P2P frequency hopping
+ */
+class RUI3P2PHopper
+{
+public:
+	/**
+	 * @brief Create the hopper
+	 *
+	 * @param rui3 RUI3 instance in P2P mode
+	 */
+	RUI3P2PHopper(RUI3 &rui3);
+
+	/**
+	 * @brief Start hopping, RX is kept on in all slots
+	 * Both ends need the same channel list, seed and P2P settings, one end is the master
+	 *
+	 * ```cpp
+	 * bool begin(const uint32_t *channels, uint8_t num, uint32_t seed, bool master);
+	 * ```
+	 * @param channels frequencies in Hz, the list has to stay valid
+	 * @param num number of channels, 1 to P2P_HOP_MAX_CHANNELS
+	 * @param seed shared seed of the hop schedule
+	 * @param master true for the end that defines the time
+	 * @return true Success
+	 * @return false Wrong channel list, P2P settings not known or the module did not accept the first channel
+	 *
+	 * @par Usage
+	 * @code
+	 * RUI3 wisduo(Serial1, Serial);
+	 * RUI3P2PHopper hopper(wisduo);
+	 * uint32_t channels[] = {916100000, 916300000, 916500000, 916700000, 916900000};
+	 * void setup()
+	 * {
+	 * 	// ... initP2P()
+	 * 	hopper.setHandler(p2p_packet);
+	 * 	hopper.begin(channels, 5, 0x12345678, true);
+	 * }
+	 * @endcode
+	 */
+	bool begin(const uint32_t *channels, uint8_t num, uint32_t seed, bool master);
+
+	/**
+	 * @brief Set the dwell time, both ends need the same dwell time
+	 * The default is the time-on-air of P2P_HOP_PAYLOAD bytes plus three guard times
+	 *
+	 * ```cpp
+	 * void setDwell(uint32_t dwell);
+	 * ```
+	 * @param dwell time per channel in milliseconds
+	 */
+	void setDwell(uint32_t dwell);
+
+	/**
+	 * @brief Get the dwell time
+	 *
+	 * ```cpp
+	 * uint32_t getDwell(void);
+	 * ```
+	 * @return uint32_t time per channel in milliseconds
+	 */
+	uint32_t getDwell(void);
+
+	/**
+	 * @brief Set the handler for received packets
+	 * The packet data starts after the hop header, it is valid until the next command or event
+	 *
+	 * ```cpp
+	 * void setHandler(p2p_handler handler);
+	 * ```
+	 * @param handler handler, NULL to remove
+	 */
+	void setHandler(p2p_handler handler);
+
+	/**
+	 * @brief Send a packet in the current slot, or in the next slot if the packet does not fit into the rest of the slot
+	 *
+	 * ```cpp
+	 * bool send(const uint8_t *data, uint16_t len);
+	 * ```
+	 * @param data payload, it is copied
+	 * @param len payload length, max P2P_HOP_PAYLOAD
+	 * @return true Packet accepted
+	 * @return false Payload too long, a packet is waiting or a follower is not synchronized
+	 */
+	bool send(const uint8_t *data, uint16_t len);
+
+	/**
+	 * @brief Read the events of the module, change the channel at the slot start and send waiting packets
+	 * Has to be called frequently, e.g. from the Arduino loop()
+	 *
+	 * ```cpp
+	 * void loop(void);
+	 * ```
+	 */
+	void loop(void);
+
+	/**
+	 * @brief Handle an event read elsewhere
+	 *
+	 * ```cpp
+	 * bool event(char *line);
+	 * ```
+	 * @param line received line
+	 * @return true Line was a TX done or a hop packet
+	 * @return false Other line
+	 */
+	bool event(char *line);
+
+	/**
+	 * @brief Check if the hop schedule is synchronized, the master is always synchronized
+	 *
+	 * ```cpp
+	 * bool synced(void);
+	 * ```
+	 * @return true Synchronized
+	 * @return false Follower waits for a packet from the master on the first channel
+	 */
+	bool synced(void);
+
+	/**
+	 * @brief Get the frequency of the current slot
+	 *
+	 * ```cpp
+	 * uint32_t frequency(void);
+	 * ```
+	 * @return uint32_t frequency in Hz
+	 */
+	uint32_t frequency(void);
+
+	/**
+	 * @brief Get the last clock correction of a follower
+	 *
+	 * ```cpp
+	 * int32_t timingError(void);
+	 * ```
+	 * @return int32_t difference between the expected and the measured time of the master in milliseconds
+	 */
+	int32_t timingError(void);
+
+	/**
+	 * @brief Get the statistics
+	 *
+	 * ```cpp
+	 * p2p_hop_stats stats(void);
+	 * ```
+	 * @return p2p_hop_stats statistics
+	 */
+	p2p_hop_stats stats(void);
+
+private:
+	/**
+	 * @brief Get the channel of a slot
+	 *
+	 * @param slot slot number
+	 * @return uint8_t index into the channel list
+	 */
+	uint8_t channel(uint32_t slot);
+
+	/**
+	 * @brief Change to the channel of a slot, RX is stopped during the change
+	 *
+	 * @param slot slot number
+	 * @return true Success
+	 * @return false Module did not accept a command
+	 */
+	bool tune(uint32_t slot);
+
+	/**
+	 * @brief Get the time of the master
+	 *
+	 * @return uint32_t time in milliseconds
+	 */
+	uint32_t now(void);
+
+	RUI3 &_rui3;
+
+	/** Channel list */
+	const uint32_t *_channels = NULL;
+
+	/** Number of channels */
+	uint8_t _num = 0;
+
+	/** Seed of the hop schedule */
+	uint32_t _seed = 0;
+
+	/** True for the master */
+	bool _master = true;
+
+	/** True if the follower is synchronized */
+	bool _synced = false;
+
+	/** Time per channel */
+	uint32_t _dwell = 0;
+
+	/** Difference from the local time to the time of the master */
+	uint32_t _offset = 0;
+
+	/** Last clock correction */
+	int32_t _error = 0;
+
+	/** Slot the module is tuned to */
+	uint32_t _slot = 0;
+
+	/** Channel the module is tuned to, index into the channel list */
+	uint8_t _tuned = 0;
+
+	/** Local time of the last packet from the master */
+	uint32_t _last_rx = 0;
+
+	/** Cycle of the channel order in _order */
+	uint32_t _cycle = 0xFFFFFFFF;
+
+	/** Channel order of the current cycle */
+	uint8_t _order[P2P_HOP_MAX_CHANNELS];
+
+	/** True while a TX is active */
+	bool _tx_active = false;
+
+	/** Start time of the active TX */
+	uint32_t _tx_start = 0;
+
+	/** TX done timeout of the active TX */
+	uint32_t _tx_timeout = 0;
+
+	/** True if a packet is waiting */
+	bool _tx_pending = false;
+
+	/** Packet with hop header */
+	uint8_t _packet[P2P_HOP_HEADER + P2P_HOP_PAYLOAD];
+
+	/** Packet length with hop header */
+	uint16_t _packet_len = 0;
+
+	/** Slot in which the waiting packet was queued */
+	uint32_t _queued = 0;
+
+	/** Time-on-air of the waiting packet in milliseconds */
+	uint32_t _packet_air = 0;
+
+	/** P2P settings for the time-on-air */
+	p2p_settings _settings;
+
+	/** Measured time of the last channel change in milliseconds */
+	uint32_t _switch = P2P_HOP_GUARD;
+
+	/** Smoothed time from sending the TX command until the module accepted it in milliseconds */
+	uint32_t _latency = P2P_HOP_GUARD;
+
+	/** Handler for received packets */
+	p2p_handler _handler = NULL;
+
+	/** Statistics */
+	p2p_hop_stats _stats;
+};
+
+#endif // _RUI3_P2P_HOP_H_
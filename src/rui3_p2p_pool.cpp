@@ -0,0 +1,109 @@
+/**
+ * @file rui3_p2p_pool.cpp
+ * @author Bernd Giesecke (bernd@giesecke.tk)
+ * @brief Fixed pool of received LoRa P2P packets
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#include <Arduino.h>
+#include "rui3_at.h"
+#include "rui3_p2p_pool.h"
+#include "rui3_no_heap.h"
+
+#if P2P_POOL_SIZE > 32
+#error P2P_POOL_SIZE must not be larger than 32
+#endif
+
+RUI3PacketPool::RUI3PacketPool(void)
+{
+	_free = P2P_POOL_SIZE == 32 ? 0xFFFFFFFF : ((uint32_t)1 << P2P_POOL_SIZE) - 1;
+	resetStats();
+}
+
+bool RUI3PacketPool::put(const char *line)
+{
+	rx_packet packet;
+	if (_free == 0)
+	{
+		// Only check if it is a packet
+		if (parseRX(line, packet, NULL, 0) && (packet.window == RX_WINDOW_P2P))
+		{
+			MYLOG("pool", "Overrun");
+			_stats.overruns++;
+			return true;
+		}
+		return false;
+	}
+	uint8_t slot = 0;
+	while (!(_free & ((uint32_t)1 << slot)))
+	{
+		slot++;
+	}
+	if (!parseRX(line, packet, _slots[slot].data, P2P_POOL_PACKET) || (packet.window != RX_WINDOW_P2P))
+	{
+		return false;
+	}
+	if (packet.data == NULL)
+	{
+		_stats.too_long++;
+		return true;
+	}
+	_slots[slot].time = millis();
+	_slots[slot].rssi = packet.rssi;
+	_slots[slot].snr = packet.snr;
+	_slots[slot].len = packet.len;
+	_free &= ~((uint32_t)1 << slot);
+	_fifo[(_head + _count) % P2P_POOL_SIZE] = slot;
+	_count++;
+	_stats.received++;
+
+	uint8_t used = P2P_POOL_SIZE;
+	for (uint32_t bits = _free; bits != 0; bits &= bits - 1)
+	{
+		used--;
+	}
+	if (used > _stats.peak)
+	{
+		_stats.peak = used;
+	}
+	return true;
+}
+
+p2p_packet *RUI3PacketPool::receive(void)
+{
+	if (_count == 0)
+	{
+		return NULL;
+	}
+	p2p_packet *packet = &_slots[_fifo[_head]];
+	_head = (_head + 1) % P2P_POOL_SIZE;
+	_count--;
+	return packet;
+}
+
+void RUI3PacketPool::release(p2p_packet *packet)
+{
+	if ((packet < _slots) || (packet >= &_slots[P2P_POOL_SIZE]))
+	{
+		return;
+	}
+	_free |= (uint32_t)1 << (packet - _slots);
+}
+
+uint8_t RUI3PacketPool::available(void)
+{
+	return _count;
+}
+
+const p2p_pool_stats &RUI3PacketPool::stats(void)
+{
+	return _stats;
+}
+
+void RUI3PacketPool::resetStats(void)
+{
+	memset(&_stats, 0, sizeof(_stats));
+}
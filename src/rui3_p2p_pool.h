@@ -0,0 +1,148 @@
+/**
+ * @file rui3_p2p_pool.h
+ * @author Bernd Giesecke (bernd@giesecke.tk)
+ * @brief Fixed pool of received LoRa P2P packets
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ * @copyright Copyright (c) 2026
+ *
+ * The payload of a received packet is decoded from the RX event directly into a free slot of the pool.
+ * The application takes the packets in the order they were received and releases them when done,
+ * the packets are not copied. If no slot is free, the packet is dropped and counted as overrun.
+ */
+#ifndef _RUI3_P2P_POOL_H_
+#define _RUI3_P2P_POOL_H_
+#include <stdint.h>
+#include "rui3_rx.h"
+
+/** Number of packet slots, max 32 */
+#ifndef P2P_POOL_SIZE
+#define P2P_POOL_SIZE 4
+#endif
+
+/** Max payload of a packet slot */
+#ifndef P2P_POOL_PACKET
+#define P2P_POOL_PACKET 255
+#endif
+
+/** Received P2P packet */
+typedef struct _p2p_packet
+{
+	uint32_t time;				   // Receive time in milliseconds
+	int16_t rssi;				   // RSSI in dBm
+	int8_t snr;					   // SNR in dB
+	uint16_t len;				   // Payload length
+	uint8_t data[P2P_POOL_PACKET]; // Payload
+} p2p_packet;
+
+/** Statistics of the packet pool */
+typedef struct _p2p_pool_stats
+{
+	uint32_t received; // Packets put into the pool
+	uint32_t overruns; // Packets dropped because no slot was free
+	uint32_t too_long; // Packets dropped because the payload was longer than P2P_POOL_PACKET
+	uint8_t peak;	   // Max number of slots in use at the same time
+} p2p_pool_stats;
+
+/**
+ * @brief Fixed pool of received LoRa P2P packets
+ */
+class RUI3PacketPool
+{
+public:
+	RUI3PacketPool(void);
+
+	/**
+	 * @brief Parse an RX event and put the packet into a free slot
+	 *
+	 * ```cpp
+	 * bool put(const char *line);
+	 * ```
+	 * @param line received line or lines, e.g. RUI3::ret, the line is not changed
+	 * @return true Line contained a P2P packet, it was put into the pool or dropped (see stats())
+	 * @return false No P2P packet
+	 */
+	bool put(const char *line);
+
+	/**
+	 * @brief Take the oldest received packet
+	 * The packet stays valid until it is released
+	 *
+	 * ```cpp
+	 * p2p_packet *receive(void);
+	 * ```
+	 * @return p2p_packet* packet, NULL if no packet is waiting
+	 *
+	 * @par Usage
+	 * @code
+	 * p2p_packet *packet;
+	 * while ((packet = pool.receive()) != NULL)
+	 * {
+	 * 	Serial.printf("%d bytes RSSI %d\r\n", packet->len, packet->rssi);
+	 * 	pool.release(packet);
+	 * }
+	 * @endcode
+	 */
+	p2p_packet *receive(void);
+
+	/**
+	 * @brief Give a packet back to the pool
+	 *
+	 * ```cpp
+	 * void release(p2p_packet *packet);
+	 * ```
+	 * @param packet packet from receive()
+	 */
+	void release(p2p_packet *packet);
+
+	/**
+	 * @brief Get the number of packets waiting
+	 *
+	 * ```cpp
+	 * uint8_t available(void);
+	 * ```
+	 * @return uint8_t number of packets that can be taken with receive()
+	 */
+	uint8_t available(void);
+
+	/**
+	 * @brief Get the statistics
+	 *
+	 * ```cpp
+	 * const p2p_pool_stats &stats(void);
+	 * ```
+	 * @return const p2p_pool_stats& statistics
+	 */
+	const p2p_pool_stats &stats(void);
+
+	/**
+	 * @brief Reset the statistics
+	 *
+	 * ```cpp
+	 * void resetStats(void);
+	 * ```
+	 */
+	void resetStats(void);
+
+private:
+	/** Packet slots */
+	p2p_packet _slots[P2P_POOL_SIZE];
+
+	/** Free slots, bit 0 = _slots[0] */
+	uint32_t _free;
+
+	/** Indices of the waiting packets in receive order */
+	uint8_t _fifo[P2P_POOL_SIZE];
+
+	/** Index of the oldest waiting packet in _fifo */
+	uint8_t _head = 0;
+
+	/** Number of waiting packets */
+	uint8_t _count = 0;
+
+	/** Statistics */
+	p2p_pool_stats _stats;
+};
+
+#endif // _RUI3_P2P_POOL_H_
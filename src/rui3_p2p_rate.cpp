@@ -0,0 +1,238 @@
+/**
+ * @file rui3_p2p_rate.cpp
+ * @author Bernd Giesecke (bernd@giesecke.tk)
+ * @brief Adaptive data rate for LoRa P2P links from the link margin reported by the peer
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#include <Arduino.h>
+#include <math.h>
+#include "rui3_p2p_rate.h"
+#include "rui3_airtime.h"
+#include "rui3_no_heap.h"
+
+RUI3P2PRate::RUI3P2PRate(RUI3 &rui3) : _rui3(rui3)
+{
+	memset(&_stats, 0, sizeof(_stats));
+}
+
+bool RUI3P2PRate::begin(const p2p_rate_step *steps, uint8_t num)
+{
+	p2p_settings settings;
+	if (!_rui3.getP2PSettings(&settings))
+	{
+		return false;
+	}
+	if (steps == NULL)
+	{
+		// SF12 to SF7 with the current bandwidth
+		_num = 6;
+		for (uint8_t idx = 0; idx < _num; idx++)
+		{
+			_steps[idx].sf = 12 - idx;
+			_steps[idx].bw = settings.bw;
+		}
+	}
+	else
+	{
+		if ((num == 0) || (num > P2P_RATE_MAX_STEPS))
+		{
+			return false;
+		}
+		for (uint8_t idx = 0; idx < num; idx++)
+		{
+			if ((steps[idx].sf < 5) || (steps[idx].sf > 12) || (p2pBandwidthHz(steps[idx].bw) == 0))
+			{
+				return false;
+			}
+		}
+		memcpy(_steps, steps, num * sizeof(p2p_rate_step));
+		_num = num;
+	}
+	_txp = settings.txp;
+	_reports = 0;
+	_missed = 0;
+	for (uint8_t idx = 0; idx < _num; idx++)
+	{
+		if ((_steps[idx].sf == settings.sf) && (_steps[idx].bw == settings.bw))
+		{
+			_step = _next = idx;
+			return true;
+		}
+	}
+	return apply(0);
+}
+
+void RUI3P2PRate::setMargin(int8_t margin, uint8_t hysteresis)
+{
+	_margin = margin;
+	_hysteresis = hysteresis;
+}
+
+void RUI3P2PRate::setPowerRange(uint16_t min, uint16_t max)
+{
+	if (min > max)
+	{
+		return;
+	}
+	_txp_min = min;
+	_txp_max = max;
+}
+
+int8_t RUI3P2PRate::margin(int8_t snr)
+{
+	// Demodulation limit is -2.5 dB per SF above SF4, rounded down to full dB
+	int16_t half_db = 2 * snr + 5 * (_steps[_step].sf - 4);
+	return half_db >= 0 ? half_db / 2 : (half_db - 1) / 2;
+}
+
+int16_t RUI3P2PRate::project(int16_t margin, uint8_t step)
+{
+	// 2.5 dB per SF and less SNR with a wider bandwidth because of the higher noise
+	float value = margin + 2.5 * ((int16_t)_steps[step].sf - (int16_t)_steps[_step].sf) -
+				  10.0 * log10((float)p2pBandwidthHz(_steps[step].bw) / p2pBandwidthHz(_steps[_step].bw));
+	return (int16_t)floor(value);
+}
+
+void RUI3P2PRate::power(uint16_t txp)
+{
+	txp = txp < _txp_min ? _txp_min : (txp > _txp_max ? _txp_max : txp);
+	if ((txp == _txp) || !_rui3.setP2PTXPower(txp))
+	{
+		return;
+	}
+	MYLOG("rate", "TX power %d", txp);
+	_txp = txp;
+	_stats.power++;
+	_reports = 0;
+}
+
+bool RUI3P2PRate::report(int8_t margin)
+{
+	_stats.reports++;
+	_missed = 0;
+	if ((_num == 0) || (_next != _step))
+	{
+		// The peer does not know the new rate step yet
+		return _next != _step;
+	}
+	if ((_reports == 0) || (margin < _lowest))
+	{
+		_lowest = margin;
+	}
+	if (_reports < 255)
+	{
+		_reports++;
+	}
+	int16_t headroom = _txp_max - _txp;
+	if (margin < _margin)
+	{
+		// Not enough margin, first more TX power, then a slower rate step
+		if (margin + headroom >= _margin)
+		{
+			// Up to the middle of the hysteresis band, not back to the limit
+			power(_txp + _margin + _hysteresis - margin);
+			return false;
+		}
+		uint8_t step = _step;
+		while ((step > 0) && (project(margin, step) + headroom < _margin))
+		{
+			step--;
+		}
+		// The new rate step is announced with the current rate step, with full TX power
+		power(_txp_max);
+		_next = step;
+		_reports = 0;
+		return _next != _step;
+	}
+	if (_reports < P2P_RATE_REPORTS)
+	{
+		return false;
+	}
+	// Next group of reports
+	_reports = 0;
+	if (_lowest < _margin + _hysteresis)
+	{
+		return false;
+	}
+	// Enough margin in all recent reports, first a faster rate step, then less TX power
+	uint8_t step = _step;
+	while ((step + 1 < _num) && (project(_lowest, step + 1) + headroom >= _margin + _hysteresis))
+	{
+		step++;
+	}
+	int16_t txp = _txp + _margin + _hysteresis - project(_lowest, step);
+	if ((step == _step) || (txp > _txp))
+	{
+		power(txp < 0 ? 0 : txp);
+	}
+	_next = step;
+	return _next != _step;
+}
+
+bool RUI3P2PRate::missed(void)
+{
+	if (++_missed < P2P_RATE_MISSED)
+	{
+		return false;
+	}
+	_missed = 0;
+	if ((_step == 0) && (_next == 0) && (_txp == _txp_max))
+	{
+		return false;
+	}
+	MYLOG("rate", "Packets missing, fallback");
+	_stats.fallbacks++;
+	power(_txp_max);
+	apply(0);
+	return true;
+}
+
+bool RUI3P2PRate::apply(uint8_t step)
+{
+	if (step >= _num)
+	{
+		return false;
+	}
+	if (!_rui3.setP2PSF(_steps[step].sf) || !_rui3.setP2PBandwidth(_steps[step].bw))
+	{
+		MYLOG("rate", "Rate step %d not set", step);
+		return false;
+	}
+	if (step > _step)
+	{
+		_stats.faster++;
+	}
+	else if (step < _step)
+	{
+		_stats.slower++;
+	}
+	MYLOG("rate", "Rate step %d: SF%d BW %d", step, _steps[step].sf, _steps[step].bw);
+	_step = _next = step;
+	_reports = 0;
+	_missed = 0;
+	return true;
+}
+
+uint8_t RUI3P2PRate::step(void)
+{
+	return _step;
+}
+
+uint8_t RUI3P2PRate::next(void)
+{
+	return _next;
+}
+
+uint16_t RUI3P2PRate::txPower(void)
+{
+	return _txp;
+}
+
+p2p_rate_stats RUI3P2PRate::stats(void)
+{
+	return _stats;
+}
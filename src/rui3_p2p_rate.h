@@ -0,0 +1,291 @@
+/**
+ * @file rui3_p2p_rate.h
+ * @author Bernd Giesecke (bernd@giesecke.tk)
+ * @brief Adaptive data rate for LoRa P2P links from the link margin reported by the peer
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ * @copyright Copyright (c) 2026
+ *
+ * The peer measures the SNR of the received packets and reports the link margin, the SNR above the demodulation
+ * limit of the spreading factor. From the margin the controller calculates the margin of the other rate steps and
+ * of other TX powers. It selects the fastest rate step with at least the target margin and then the lowest TX power.
+ *
+ * A missing margin is covered first by the TX power and then by a slower rate step, this is done with the last report.
+ * A faster rate step or a lower TX power is checked after each group of P2P_RATE_REPORTS reports, the lowest report
+ * of the group needs at least the target margin plus the hysteresis.
+ *
+ * The TX power is only used by the sender and is set at once. Both ends need the same spreading factor and bandwidth,
+ * the application sends the new rate step to the peer with the old settings and both ends call apply().
+ * If packets are missing, both ends fall back to the most robust rate step.
+ */
+#ifndef _RUI3_P2P_RATE_H_
+#define _RUI3_P2P_RATE_H_
+#include "rui3_at.h"
+
+/** Max number of rate steps */
+#ifndef P2P_RATE_MAX_STEPS
+#define P2P_RATE_MAX_STEPS 12
+#endif
+
+/** Default target link margin in dB */
+#ifndef P2P_RATE_MARGIN
+#define P2P_RATE_MARGIN 5
+#endif
+
+/** Default hysteresis in dB for a faster rate step or a lower TX power */
+#ifndef P2P_RATE_HYSTERESIS
+#define P2P_RATE_HYSTERESIS 3
+#endif
+
+/** Number of reports in a group, a faster rate step or a lower TX power is checked after each group */
+#ifndef P2P_RATE_REPORTS
+#define P2P_RATE_REPORTS 10
+#endif
+
+/** Number of missing packets in a row before the fallback to the most robust rate step */
+#ifndef P2P_RATE_MISSED
+#define P2P_RATE_MISSED 3
+#endif
+
+/** Rate step */
+typedef struct _p2p_rate_step
+{
+	uint16_t sf; // Spreading factor 6 - 12
+	uint16_t bw; // Bandwidth, same values as p2p_settings.bw
+} p2p_rate_step;
+
+/** Statistics of the controller */
+typedef struct _p2p_rate_stats
+{
+	uint32_t reports;	// Margin reports
+	uint32_t faster;	// Changes to a faster rate step
+	uint32_t slower;	// Changes to a slower rate step
+	uint32_t power;		// TX power changes
+	uint32_t fallbacks; // Fallbacks to the most robust rate step
+} p2p_rate_stats;
+
+/**
+ * @brief Adaptive data rate for LoRa P2P links
+ */
+class RUI3P2PRate
+{
+public:
+	/**
+	 * @brief Create the controller
+	 *
+	 * @param rui3 RUI3 instance in P2P mode
+	 */
+	RUI3P2PRate(RUI3 &rui3);
+
+	/**
+	 * @brief Start the controller with the current P2P settings
+	 * The default rate steps are SF12 to SF7 with the current bandwidth. If the current settings are not a rate step,
+	 * the most robust rate step is set.
+	 *
+	 * ```cpp
+	 * bool begin(const p2p_rate_step *steps = NULL, uint8_t num = 0);
+	 * ```
+	 * @param steps rate steps from the most robust to the fastest, the list is copied, NULL for the default steps
+	 * @param num number of rate steps, max P2P_RATE_MAX_STEPS
+	 * @return true Success
+	 * @return false Wrong rate steps, P2P settings not known or the module did not accept the settings
+	 *
+	 * @par Usage
+	 * @code
+	 * RUI3 wisduo(Serial1, Serial);
+	 * RUI3P2PRate rate(wisduo);
+	 * void setup()
+	 * {
+	 * 	// ... initP2P() with SF12
+	 * 	rate.begin();
+	 * }
+	 * @endcode
+	 */
+	bool begin(const p2p_rate_step *steps = NULL, uint8_t num = 0);
+
+	/**
+	 * @brief Set the target link margin and the hysteresis
+	 *
+	 * ```cpp
+	 * void setMargin(int8_t margin, uint8_t hysteresis = P2P_RATE_HYSTERESIS);
+	 * ```
+	 * @param margin target link margin in dB
+	 * @param hysteresis additional margin in dB for a faster rate step or a lower TX power
+	 */
+	void setMargin(int8_t margin, uint8_t hysteresis = P2P_RATE_HYSTERESIS);
+
+	/**
+	 * @brief Set the TX power range
+	 *
+	 * ```cpp
+	 * void setPowerRange(uint16_t min, uint16_t max);
+	 * ```
+	 * @param min lowest TX power, 5 - 22
+	 * @param max highest TX power, 5 - 22
+	 */
+	void setPowerRange(uint16_t min, uint16_t max);
+
+	/**
+	 * @brief Calculate the link margin of a received packet, used by the peer for the report
+	 *
+	 * ```cpp
+	 * int8_t margin(int8_t snr);
+	 * ```
+	 * @param snr SNR of the packet in dB
+	 * @return int8_t SNR above the demodulation limit of the current spreading factor in dB
+	 */
+	int8_t margin(int8_t snr);
+
+	/**
+	 * @brief Handle a link margin reported by the peer
+	 * A new TX power is set at once, a new rate step is returned by next()
+	 *
+	 * ```cpp
+	 * bool report(int8_t margin);
+	 * ```
+	 * @param margin link margin of a packet sent with the current settings in dB
+	 * @return true A new rate step is waiting, send next() to the peer and call apply()
+	 * @return false No change of the rate step
+	 *
+	 * @par Usage
+	 * @code
+	 * void p2p_packet(const rx_packet &packet)
+	 * {
+	 * 	// Payload of the peer: link margin, data
+	 * 	if ((packet.len > 0) && rate.report((int8_t)packet.data[0]))
+	 * 	{
+	 * 		uint8_t step = rate.next();
+	 * 		// ... send step to the peer with the current settings
+	 * 		rate.apply(step);
+	 * 	}
+	 * }
+	 * @endcode
+	 */
+	bool report(int8_t margin);
+
+	/**
+	 * @brief Handle a missing packet, after P2P_RATE_MISSED missing packets in a row the most robust rate step is set
+	 * Both ends have to call it for the same missing packets
+	 *
+	 * ```cpp
+	 * bool missed(void);
+	 * ```
+	 * @return true Fallback to the most robust rate step
+	 * @return false No change
+	 */
+	bool missed(void);
+
+	/**
+	 * @brief Set a rate step, called by both ends
+	 * Only the changed settings are sent to the module
+	 *
+	 * ```cpp
+	 * bool apply(uint8_t step);
+	 * ```
+	 * @param step rate step
+	 * @return true Success
+	 * @return false Invalid rate step or the module did not accept the settings
+	 */
+	bool apply(uint8_t step);
+
+	/**
+	 * @brief Get the current rate step
+	 *
+	 * ```cpp
+	 * uint8_t step(void);
+	 * ```
+	 * @return uint8_t rate step, 0 is the most robust
+	 */
+	uint8_t step(void);
+
+	/**
+	 * @brief Get the rate step selected by the last report
+	 *
+	 * ```cpp
+	 * uint8_t next(void);
+	 * ```
+	 * @return uint8_t rate step, same as step() if no change is waiting
+	 */
+	uint8_t next(void);
+
+	/**
+	 * @brief Get the current TX power
+	 *
+	 * ```cpp
+	 * uint16_t txPower(void);
+	 * ```
+	 * @return uint16_t TX power
+	 */
+	uint16_t txPower(void);
+
+	/**
+	 * @brief Get the statistics
+	 *
+	 * ```cpp
+	 * p2p_rate_stats stats(void);
+	 * ```
+	 * @return p2p_rate_stats statistics
+	 */
+	p2p_rate_stats stats(void);
+
+private:
+	/**
+	 * @brief Calculate the link margin of a rate step from the margin of the current rate step
+	 *
+	 * @param margin margin of the current rate step
+	 * @param step rate step
+	 * @return int16_t margin of the rate step at the current TX power
+	 */
+	int16_t project(int16_t margin, uint8_t step);
+
+	/**
+	 * @brief Set the TX power
+	 *
+	 * @param txp TX power
+	 */
+	void power(uint16_t txp);
+
+	RUI3 &_rui3;
+
+	/** Rate steps */
+	p2p_rate_step _steps[P2P_RATE_MAX_STEPS];
+
+	/** Number of rate steps */
+	uint8_t _num = 0;
+
+	/** Current rate step */
+	uint8_t _step = 0;
+
+	/** Rate step selected by the last report */
+	uint8_t _next = 0;
+
+	/** Current TX power */
+	uint16_t _txp = 22;
+
+	/** Lowest TX power */
+	uint16_t _txp_min = 5;
+
+	/** Highest TX power */
+	uint16_t _txp_max = 22;
+
+	/** Target link margin */
+	int8_t _margin = P2P_RATE_MARGIN;
+
+	/** Hysteresis */
+	uint8_t _hysteresis = P2P_RATE_HYSTERESIS;
+
+	/** Reports in the current group */
+	uint8_t _reports = 0;
+
+	/** Lowest margin of the current group */
+	int8_t _lowest = 0;
+
+	/** Missing packets in a row */
+	uint8_t _missed = 0;
+
+	/** Statistics */
+	p2p_rate_stats _stats;
+};
+
+#endif // _RUI3_P2P_RATE_H_
@@ -0,0 +1,188 @@
+/**
+ * @file rui3_p2p_rx.cpp
+ * @author Bernd Giesecke (bernd@giesecke.tk)
+ * @brief Continuous LoRa P2P RX that tracks the RX state of the module from its events
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#include <Arduino.h>
+#include "rui3_p2p_rx.h"
+#include "rui3_no_heap.h"
+
+RUI3P2PReceiver::RUI3P2PReceiver(RUI3 &rui3) : _rui3(rui3)
+{
+}
+
+bool RUI3P2PReceiver::begin(uint16_t mode)
+{
+	if (mode == P2P_RX_OFF)
+	{
+		return stop();
+	}
+	if (_mode == P2P_RX_OFF)
+	{
+		// The flush before each command would drop the events, they are all read by loop()
+		_cmd_flush = _rui3.getCmdFlush();
+		_rui3.setCmdFlush(false);
+	}
+	_mode = mode;
+	_rx_on = false;
+	return rearm();
+}
+
+bool RUI3P2PReceiver::stop(void)
+{
+	if (_mode != P2P_RX_OFF)
+	{
+		_rui3.setCmdFlush(_cmd_flush);
+	}
+	_mode = P2P_RX_OFF;
+	if (!_rui3.setP2PReceive(P2P_RX_OFF))
+	{
+		return false;
+	}
+	_rx_on = false;
+	return true;
+}
+
+void RUI3P2PReceiver::setHandler(p2p_handler handler)
+{
+	_handler = handler;
+}
+
+void RUI3P2PReceiver::setPool(RUI3PacketPool *pool)
+{
+	_pool = pool;
+}
+
+bool RUI3P2PReceiver::send(const uint8_t *data, uint16_t len)
+{
+	if (_tx_active)
+	{
+		return false;
+	}
+	if (_rx_on && (_mode != P2P_RX_PERMANENT_TX))
+	{
+		// The module does not send while it is in RX
+		if (!_rui3.setP2PReceive(P2P_RX_OFF))
+		{
+			return false;
+		}
+		_rx_on = false;
+	}
+	if (!_rui3.sendP2PData(data, len))
+	{
+		return false;
+	}
+	_tx_active = true;
+	_tx_start = millis();
+	_tx_timeout = _rui3.getTxTimeout();
+	return true;
+}
+
+void RUI3P2PReceiver::loop(void)
+{
+	while (_rui3.pollLine())
+	{
+		event(_rui3.ret);
+	}
+	if (_tx_active && ((millis() - _tx_start) >= _tx_timeout))
+	{
+		// TX done missed, the RX state is not known
+		MYLOG("p2p_rx", "TX done timeout");
+		_tx_active = false;
+		_rx_on = false;
+	}
+	rearm();
+}
+
+bool RUI3P2PReceiver::event(char *line)
+{
+	if (strstr(line, "+EVT:TXP2P DONE") != NULL)
+	{
+		_tx_active = false;
+		if (_rx_on && (_mode == P2P_RX_PERMANENT_TX))
+		{
+			_saved++;
+		}
+		else
+		{
+			_rx_on = false;
+		}
+		return true;
+	}
+	if (strstr(line, "+EVT:RXP2P_RECEIVE_TIMEOUT") != NULL)
+	{
+		_rx_on = false;
+		return true;
+	}
+	rx_packet packet;
+	if (_pool != NULL)
+	{
+		if (!_pool->put(line))
+		{
+			return false;
+		}
+	}
+	else
+	{
+		if (!parseRX(line, packet) || (packet.window != RX_WINDOW_P2P))
+		{
+			return false;
+		}
+		if (_handler != NULL)
+		{
+			_handler(packet);
+		}
+	}
+	_received++;
+	if ((_mode != P2P_RX_PERMANENT_TX) && (_mode != P2P_RX_PERMANENT))
+	{
+		// Single and timed RX end with the packet
+		_rx_on = false;
+	}
+	return true;
+}
+
+bool RUI3P2PReceiver::rearm(void)
+{
+	if (_rx_on)
+	{
+		return true;
+	}
+	if ((_mode == P2P_RX_OFF) || _tx_active)
+	{
+		return false;
+	}
+	if (!_rui3.setP2PReceive(_mode))
+	{
+		return false;
+	}
+	MYLOG("p2p_rx", "RX started");
+	_rx_on = true;
+	_rearms++;
+	return true;
+}
+
+bool RUI3P2PReceiver::receiving(void)
+{
+	return _rx_on;
+}
+
+uint32_t RUI3P2PReceiver::rearms(void)
+{
+	return _rearms;
+}
+
+uint32_t RUI3P2PReceiver::saved(void)
+{
+	return _saved;
+}
+
+uint32_t RUI3P2PReceiver::received(void)
+{
+	return _received;
+}
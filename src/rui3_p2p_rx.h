@@ -0,0 +1,235 @@
+/**
+ * @file rui3_p2p_rx.h
+ * @author Bernd Giesecke (bernd@giesecke.tk)
+ * @brief Continuous LoRa P2P RX that tracks the RX state of the module from its events
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ * @copyright Copyright (c) 2026
+ *
+ * The module leaves RX after a TX (except in P2P_RX_PERMANENT_TX mode), after an RX timeout and after
+ * a packet in single or timed RX mode. The RX state is followed from the events, RX is started again with one
+ * AT+PRECV command only if the module left RX. Querying the state with AT+PRECV=? is never needed.
+ * While RX is on, the flush before each command is disabled (see RUI3::setCmdFlush()), events that arrive during
+ * a command are kept by RUI3 and read by loop().
+ */
+#ifndef _RUI3_P2P_RX_H_
+#define _RUI3_P2P_RX_H_
+#include "rui3_at.h"
+#include "rui3_rx.h"
+#include "rui3_p2p_pool.h"
+
+/** Handler for received P2P packets */
+typedef void (*p2p_handler)(const rx_packet &packet);
+
+/**
+ * @brief Continuous LoRa P2P RX
+ */
+class RUI3P2PReceiver
+{
+public:
+	/**
+	 * @brief Create the receiver
+	 *
+	 * @param rui3 RUI3 instance in P2P mode
+	 */
+	RUI3P2PReceiver(RUI3 &rui3);
+
+	/**
+	 * @brief Start RX, RX is kept on until stop()
+	 *
+	 * ```cpp
+	 * bool begin(uint16_t mode = P2P_RX_PERMANENT_TX);
+	 * ```
+	 * @param mode P2P_RX_PERMANENT_TX, P2P_RX_PERMANENT, P2P_RX_SINGLE or RX time in milliseconds 1 to 65532
+	 * @return true Success
+	 * @return false No response or error response
+	 *
+	 * @par Usage
+	 * @code
+	 * RUI3 wisduo(Serial1, Serial);
+	 * RUI3P2PReceiver p2p_rx(wisduo);
+	 * void setup()
+	 * {
+	 * 	// ... initP2P()
+	 * 	p2p_rx.setHandler(p2p_packet);
+	 * 	p2p_rx.begin();
+	 * }
+	 * @endcode
+	 */
+	bool begin(uint16_t mode = P2P_RX_PERMANENT_TX);
+
+	/**
+	 * @brief Stop RX
+	 *
+	 * ```cpp
+	 * bool stop(void);
+	 * ```
+	 * @return true Success
+	 * @return false No response or error response
+	 */
+	bool stop(void);
+
+	/**
+	 * @brief Set the handler for received packets
+	 * The packet points into RUI3::ret, it is valid until the next command or event
+	 *
+	 * ```cpp
+	 * void setHandler(p2p_handler handler);
+	 * ```
+	 * @param handler handler, NULL to remove
+	 */
+	void setHandler(p2p_handler handler);
+
+	/**
+	 * @brief Put received packets into a packet pool instead of passing them to the handler
+	 *
+	 * ```cpp
+	 * void setPool(RUI3PacketPool *pool);
+	 * ```
+	 * @param pool packet pool, NULL to use the handler
+	 *
+	 * @par Usage
+	 * @code
+	 * RUI3PacketPool pool;
+	 * p2p_rx.setPool(&pool);
+	 * @endcode
+	 */
+	void setPool(RUI3PacketPool *pool);
+
+	/**
+	 * @brief Send a packet, RX is stopped first if the RX mode does not allow TX
+	 *
+	 * ```cpp
+	 * bool send(const uint8_t *data, uint16_t len);
+	 * ```
+	 * @param data payload
+	 * @param len payload length
+	 * @return true Packet is sent, TX done is handled by loop()
+	 * @return false TX active, no response or error response
+	 */
+	bool send(const uint8_t *data, uint16_t len);
+
+	/**
+	 * @brief Read the events of the module and start RX again if needed
+	 * Has to be called frequently, e.g. from the Arduino loop()
+	 *
+	 * ```cpp
+	 * void loop(void);
+	 * ```
+	 */
+	void loop(void);
+
+	/**
+	 * @brief Follow the RX state from an event read elsewhere, e.g. after waitTxDone() or recvRX()
+	 * Received packets are put into the packet pool or passed to the handler, the payload is decoded in place
+	 *
+	 * ```cpp
+	 * bool event(char *line);
+	 * ```
+	 * @param line received line or lines
+	 * @return true Line contained a TX done, RX timeout or RX event
+	 * @return false Other line
+	 */
+	bool event(char *line);
+
+	/**
+	 * @brief Start RX again if the module left RX
+	 *
+	 * ```cpp
+	 * bool rearm(void);
+	 * ```
+	 * @return true RX is on
+	 * @return false RX is stopped, a TX is active or the module did not accept the command
+	 *
+	 * @par Usage
+	 * @code
+	 * if (wisduo.sendP2PData(payload, sizeof(payload)) && wisduo.waitTxDone())
+	 * {
+	 * 	p2p_rx.event(wisduo.ret);
+	 * }
+	 * p2p_rx.rearm(); // Sends AT+PRECV only if the module left RX
+	 * @endcode
+	 */
+	bool rearm(void);
+
+	/**
+	 * @brief Check if the module is in RX
+	 *
+	 * ```cpp
+	 * bool receiving(void);
+	 * ```
+	 * @return true RX is on
+	 * @return false RX is off
+	 */
+	bool receiving(void);
+
+	/**
+	 * @brief Get the number of RX starts, including the start by begin()
+	 *
+	 * ```cpp
+	 * uint32_t rearms(void);
+	 * ```
+	 * @return uint32_t number of AT+PRECV commands sent by rearm()
+	 */
+	uint32_t rearms(void);
+
+	/**
+	 * @brief Get the number of RX restarts that were not needed
+	 * Counted after each TX that the module left in RX, without tracking these would be AT+PRECV=? and an RX restart
+	 *
+	 * ```cpp
+	 * uint32_t saved(void);
+	 * ```
+	 * @return uint32_t number of saved RX restarts
+	 */
+	uint32_t saved(void);
+
+	/**
+	 * @brief Get the number of received packets
+	 *
+	 * ```cpp
+	 * uint32_t received(void);
+	 * ```
+	 * @return uint32_t number of packets
+	 */
+	uint32_t received(void);
+
+private:
+	RUI3 &_rui3;
+
+	/** RX mode, P2P_RX_OFF if stopped */
+	uint16_t _mode = P2P_RX_OFF;
+
+	/** True while the module is in RX */
+	bool _rx_on = false;
+
+	/** True while a TX is active */
+	bool _tx_active = false;
+
+	/** Start time of the active TX */
+	uint32_t _tx_start = 0;
+
+	/** TX done timeout of the active TX */
+	uint32_t _tx_timeout = 0;
+
+	/** Handler for received packets */
+	p2p_handler _handler = NULL;
+
+	/** Packet pool, NULL if not used */
+	RUI3PacketPool *_pool = NULL;
+
+	/** RX restarts */
+	uint32_t _rearms = 0;
+
+	/** RX restarts not needed */
+	uint32_t _saved = 0;
+
+	/** Received packets */
+	uint32_t _received = 0;
+
+	/** Flush setting before begin(), restored by stop() */
+	bool _cmd_flush = true;
+};
+
+#endif // _RUI3_P2P_RX_H_
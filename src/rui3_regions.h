@@ -0,0 +1,259 @@
+/**
+ * @file rui3_regions.h
+ * @author Bernd Giesecke (bernd@giesecke.tk)
+ * @brief Compile-time LoRaWAN regional parameters
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ * @copyright Copyright (c) 2026
+ *
+ * Values from the LoRaWAN Regional Parameters RP002-1.0.3.
+ * The tables are constexpr, with a constant region and datarate the lookup functions are evaluated
+ * by the compiler and the tables are not linked at all. Used at runtime they stay in flash.
+ * Maximum payload sizes are the application payload N without FOpts and without dwell time limit.
+ */
+#ifndef _RUI3_REGIONS_H_
+#define _RUI3_REGIONS_H_
+#include <stdint.h>
+#include <stddef.h>
+
+/** Number of regions, same order as the region numbers EU433 ... LA915 */
+#define RUI3_NUM_REGIONS 13
+
+/** Datarate parameters */
+typedef struct _region_dr
+{
+	uint8_t sf;			 // Spreading factor, 0 = FSK, LR-FHSS or RFU
+	uint16_t bw;		 // Bandwidth in kHz, 0 = FSK, LR-FHSS or RFU
+	uint8_t max_payload; // Max application payload in bytes, 0 = datarate not available
+} region_dr;
+
+/** Duty cycle sub-band */
+typedef struct _duty_band
+{
+	uint32_t freq_min; // Lowest frequency of the sub-band in Hz
+	uint32_t freq_max; // Highest frequency of the sub-band in Hz
+	uint16_t duty_div; // Duty cycle as divider, 100 = 1%, 1000 = 0.1%, 1 = no duty cycle limit
+} duty_band;
+
+/** Parameters of a region */
+typedef struct _region_params
+{
+	const char *name;		// Region name as used by RUI3
+	uint8_t num_dr;			// Number of entries in dr
+	const region_dr *dr;	// Datarates, indexed by DR
+	uint8_t num_ch;			// Number of default channels (fixed channel plans: number of 125 kHz channels)
+	const uint32_t *ch;		// Default channel frequencies in Hz, NULL if the channels are on a grid
+	uint32_t ch_base;		// Frequency of the first channel on the grid in Hz
+	uint32_t ch_step;		// Channel spacing on the grid in Hz
+	uint8_t num_bands;		// Number of entries in bands
+	const duty_band *bands; // Duty cycle sub-bands
+	uint8_t rx2_dr;			// Default datarate of RX2
+} region_params;
+
+namespace rui3_detail
+{
+	/** EU868, EU433 and RU864, DR7 is FSK */
+	constexpr region_dr dr_eu[] = {{12, 125, 51}, {11, 125, 51}, {10, 125, 51}, {9, 125, 115}, {8, 125, 242}, {7, 125, 242}, {7, 250, 242}, {0, 0, 242}};
+	/** AS923 without dwell time limit, DR7 is FSK */
+	constexpr region_dr dr_as923[] = {{12, 125, 51}, {11, 125, 51}, {10, 125, 51}, {9, 125, 115}, {8, 125, 242}, {7, 125, 242}, {7, 250, 242}, {0, 0, 242}};
+	/** CN470, KR920 */
+	constexpr region_dr dr_125[] = {{12, 125, 51}, {11, 125, 51}, {10, 125, 51}, {9, 125, 115}, {8, 125, 242}, {7, 125, 242}};
+	/** IN865, DR6 is RFU, DR7 is FSK */
+	constexpr region_dr dr_in865[] = {{12, 125, 51}, {11, 125, 51}, {10, 125, 51}, {9, 125, 115}, {8, 125, 242}, {7, 125, 242}, {0, 0, 0}, {0, 0, 242}};
+	/** US915, DR5 and DR6 are LR-FHSS, DR7 is RFU, DR8 to DR13 are downlink only */
+	constexpr region_dr dr_us915[] = {{10, 125, 11}, {9, 125, 53}, {8, 125, 125}, {7, 125, 242}, {8, 500, 242}, {0, 0, 0}, {0, 0, 0}, {0, 0, 0}, {12, 500, 53}, {11, 500, 129}, {10, 500, 242}, {9, 500, 242}, {8, 500, 242}, {7, 500, 242}};
+	/** AU915 and LA915, DR7 is LR-FHSS, DR8 to DR13 are downlink only */
+	constexpr region_dr dr_au915[] = {{12, 125, 51}, {11, 125, 51}, {10, 125, 51}, {9, 125, 115}, {8, 125, 242}, {7, 125, 242}, {8, 500, 242}, {0, 0, 0}, {12, 500, 53}, {11, 500, 129}, {10, 500, 242}, {9, 500, 242}, {8, 500, 242}, {7, 500, 242}};
+
+	constexpr uint32_t ch_in865[] = {865062500, 865402500, 865985000};
+
+	/** ETSI sub-bands g to g4, 863 - 865 MHz shares the 0.1% limit */
+	constexpr duty_band bands_eu868[] = {{863000000, 865000000, 1000}, {865000000, 868000000, 100}, {868000000, 868600000, 100}, {868700000, 869200000, 1000}, {869400000, 869650000, 10}, {869700000, 870000000, 100}};
+	constexpr duty_band bands_eu433[] = {{433175000, 434665000, 100}};
+	constexpr duty_band bands_ru864[] = {{864000000, 870000000, 100}};
+	constexpr duty_band bands_as923[] = {{915000000, 928000000, 100}};
+	constexpr duty_band bands_cn470[] = {{470000000, 510000000, 1}};
+	constexpr duty_band bands_in865[] = {{865000000, 867000000, 1}};
+	constexpr duty_band bands_us915[] = {{902000000, 928000000, 1}};
+	constexpr duty_band bands_au915[] = {{915000000, 928000000, 1}};
+	constexpr duty_band bands_kr920[] = {{920900000, 923300000, 1}};
+
+#define RUI3_REGION(name, dr, num_ch, ch, base, step, bands, rx2_dr) \
+	{name, sizeof(dr) / sizeof(dr[0]), dr, num_ch, ch, base, step, sizeof(bands) / sizeof(bands[0]), bands, rx2_dr}
+
+	/** Indexed by the region number */
+	constexpr region_params regions[RUI3_NUM_REGIONS] = {
+		RUI3_REGION("EU433", dr_eu, 3, NULL, 433175000, 200000, bands_eu433, 0),
+		RUI3_REGION("CN470", dr_125, 96, NULL, 470300000, 200000, bands_cn470, 1),
+		RUI3_REGION("RU864", dr_eu, 2, NULL, 868900000, 200000, bands_ru864, 0),
+		RUI3_REGION("IN865", dr_in865, 3, ch_in865, 0, 0, bands_in865, 2),
+		RUI3_REGION("EU868", dr_eu, 3, NULL, 868100000, 200000, bands_eu868, 0),
+		RUI3_REGION("US915", dr_us915, 64, NULL, 902300000, 200000, bands_us915, 8),
+		RUI3_REGION("AU915", dr_au915, 64, NULL, 915200000, 200000, bands_au915, 8),
+		RUI3_REGION("KR920", dr_125, 3, NULL, 922100000, 200000, bands_kr920, 0),
+		RUI3_REGION("AS923-1", dr_as923, 2, NULL, 923200000, 200000, bands_as923, 2),
+		RUI3_REGION("AS923-2", dr_as923, 2, NULL, 921400000, 200000, bands_as923, 2),
+		RUI3_REGION("AS923-3", dr_as923, 2, NULL, 916600000, 200000, bands_as923, 2),
+		RUI3_REGION("AS923-4", dr_as923, 2, NULL, 917300000, 200000, bands_as923, 2),
+		RUI3_REGION("LA915", dr_au915, 64, NULL, 915200000, 200000, bands_au915, 8)};
+
+#undef RUI3_REGION
+
+	constexpr const region_dr *region_dr_ptr(uint8_t region, uint8_t dr)
+	{
+		return ((region < RUI3_NUM_REGIONS) && (dr < regions[region].num_dr)) ? &regions[region].dr[dr] : NULL;
+	}
+
+	constexpr int8_t find_sub_band(const region_params &params, uint32_t freq, uint8_t idx)
+	{
+		return (idx >= params.num_bands) ? -1
+			   : ((freq >= params.bands[idx].freq_min) && (freq <= params.bands[idx].freq_max))
+				   ? idx
+				   : find_sub_band(params, freq, idx + 1);
+	}
+}
+
+/**
+ * @brief Get the parameters of a region
+ *
+ * ```cpp
+ * constexpr const region_params *regionParams(uint8_t region);
+ * ```
+ * @param region region 0 to 12, e.g. EU868
+ * @return const region_params* region parameters, NULL if the region is invalid
+ *
+ * @par Usage
+ * @code
+ * const region_params *params = regionParams(wisduo.getRegion());
+ * if (params != NULL)
+ * {
+ * 	Serial.printf("Region %s has %d datarates\r\n", params->name, params->num_dr);
+ * }
+ * @endcode
+ */
+constexpr const region_params *regionParams(uint8_t region)
+{
+	return (region < RUI3_NUM_REGIONS) ? &rui3_detail::regions[region] : NULL;
+}
+
+/**
+ * @brief Get the spreading factor of a datarate
+ *
+ * ```cpp
+ * constexpr uint8_t regionSF(uint8_t region, uint8_t dr);
+ * ```
+ * @param region region 0 to 12, e.g. EU868
+ * @param dr datarate
+ * @return uint8_t spreading factor, 0 if the datarate is invalid or not LoRa
+ */
+constexpr uint8_t regionSF(uint8_t region, uint8_t dr)
+{
+	return rui3_detail::region_dr_ptr(region, dr) != NULL ? rui3_detail::region_dr_ptr(region, dr)->sf : 0;
+}
+
+/**
+ * @brief Get the bandwidth of a datarate
+ *
+ * ```cpp
+ * constexpr uint16_t regionBW(uint8_t region, uint8_t dr);
+ * ```
+ * @param region region 0 to 12, e.g. EU868
+ * @param dr datarate
+ * @return uint16_t bandwidth in kHz, 0 if the datarate is invalid or not LoRa
+ */
+constexpr uint16_t regionBW(uint8_t region, uint8_t dr)
+{
+	return rui3_detail::region_dr_ptr(region, dr) != NULL ? rui3_detail::region_dr_ptr(region, dr)->bw : 0;
+}
+
+/**
+ * @brief Get the max application payload of a datarate
+ *
+ * ```cpp
+ * constexpr uint8_t regionMaxPayload(uint8_t region, uint8_t dr);
+ * ```
+ * @param region region 0 to 12, e.g. EU868
+ * @param dr datarate
+ * @return uint8_t max payload in bytes, 0 if the datarate is invalid
+ *
+ * @par Usage
+ * @code
+ * static_assert(regionMaxPayload(EU868, 0) == 51, "Payload does not fit into DR0");
+ * uint8_t max_len = regionMaxPayload(wisduo.getRegion(), wisduo.getDataRate());
+ * @endcode
+ */
+constexpr uint8_t regionMaxPayload(uint8_t region, uint8_t dr)
+{
+	return rui3_detail::region_dr_ptr(region, dr) != NULL ? rui3_detail::region_dr_ptr(region, dr)->max_payload : 0;
+}
+
+/**
+ * @brief Get the default datarate of the RX2 window
+ *
+ * ```cpp
+ * constexpr uint8_t regionRX2DR(uint8_t region);
+ * ```
+ * @param region region 0 to 12, e.g. EU868
+ * @return uint8_t datarate, 0 if the region is invalid
+ */
+constexpr uint8_t regionRX2DR(uint8_t region)
+{
+	return (region < RUI3_NUM_REGIONS) ? rui3_detail::regions[region].rx2_dr : 0;
+}
+
+/**
+ * @brief Get the frequency of a default channel
+ * For US915, AU915, LA915 and CN470 this is the frequency of a 125 kHz channel of the fixed channel plan
+ *
+ * ```cpp
+ * constexpr uint32_t regionChannelFreq(uint8_t region, uint8_t channel);
+ * ```
+ * @param region region 0 to 12, e.g. EU868
+ * @param channel channel number
+ * @return uint32_t frequency in Hz, 0 if the channel is invalid
+ */
+constexpr uint32_t regionChannelFreq(uint8_t region, uint8_t channel)
+{
+	return ((region >= RUI3_NUM_REGIONS) || (channel >= rui3_detail::regions[region].num_ch)) ? 0
+		   : (rui3_detail::regions[region].ch != NULL)
+			   ? rui3_detail::regions[region].ch[channel]
+			   : rui3_detail::regions[region].ch_base + channel * rui3_detail::regions[region].ch_step;
+}
+
+/**
+ * @brief Get the duty cycle sub-band of a frequency
+ *
+ * ```cpp
+ * constexpr int8_t regionSubBand(uint8_t region, uint32_t freq);
+ * ```
+ * @param region region 0 to 12, e.g. EU868
+ * @param freq frequency in Hz
+ * @return int8_t index into region_params.bands, -1 if the frequency is outside of the region
+ */
+constexpr int8_t regionSubBand(uint8_t region, uint32_t freq)
+{
+	return (region < RUI3_NUM_REGIONS) ? rui3_detail::find_sub_band(rui3_detail::regions[region], freq, 0) : -1;
+}
+
+/**
+ * @brief Get the duty cycle limit of a frequency
+ *
+ * ```cpp
+ * constexpr uint16_t regionDutyDiv(uint8_t region, uint32_t freq);
+ * ```
+ * @param region region 0 to 12, e.g. EU868
+ * @param freq frequency in Hz
+ * @return uint16_t duty cycle as divider, 100 = 1%, 1 = no limit, 0 if the frequency is outside of the region
+ *
+ * @par Usage
+ * @code
+ * static_assert(regionDutyDiv(EU868, 869525000) == 10, "10% sub-band");
+ * @endcode
+ */
+constexpr uint16_t regionDutyDiv(uint8_t region, uint32_t freq)
+{
+	return regionSubBand(region, freq) < 0 ? 0 : rui3_detail::regions[region].bands[regionSubBand(region, freq)].duty_div;
+}
+
+#endif // _RUI3_REGIONS_H_
@@ -0,0 +1,243 @@
+/**
+ * @file rui3_rx.cpp
+ * @author Bernd Giesecke (bernd@giesecke.tk)
+ * @brief Parser for RX events and LoRaWAN downlink dispatch by fPort
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#include <Arduino.h>
+#include "rui3_at.h"
+#include "rui3_rx.h"
+#include "rui3_no_heap.h"
+
+/**
+ * @brief Parse a decimal value followed by a colon
+ *
+ * @param str string to parse, set behind the colon
+ * @param value parsed value
+ * @return true Value and colon found
+ * @return false Invalid format
+ */
+static bool parse_field(const char *&str, int32_t &value)
+{
+	char *end_ptr;
+	value = strtol(str, &end_ptr, 10);
+	if ((end_ptr == str) || (*end_ptr != ':'))
+	{
+		return false;
+	}
+	str = end_ptr + 1;
+	return true;
+}
+
+/**
+ * @brief Parse the fields of an RX event before the payload
+ *
+ * @param line received line or lines
+ * @param packet parsed packet without payload
+ * @return const char* start of the HEX payload, NULL if no RX event was found
+ */
+static const char *parse_header(const char *line, rx_packet &packet)
+{
+	const char *str = strstr(line, "+EVT:RX");
+	if (str == NULL)
+	{
+		return NULL;
+	}
+	str += 7;
+	packet.port = 0;
+	packet.snr = 0;
+	packet.multicast = false;
+	bool fsk = false;
+	if (strncmp(str, "P2P:", 4) == 0)
+	{
+		packet.window = RX_WINDOW_P2P;
+		str += 4;
+	}
+	else if (strncmp(str, "FSK:", 4) == 0)
+	{
+		// FSK packets have no SNR
+		packet.window = RX_WINDOW_P2P;
+		fsk = true;
+		str += 4;
+	}
+	else if ((str[0] == '_') && (str[1] != 0) && (strchr("12BC", str[1]) != NULL) && (str[2] == ':'))
+	{
+		packet.window = str[1];
+		str += 3;
+	}
+	else
+	{
+		// e.g. +EVT:RXP2P_RECEIVE_TIMEOUT
+		return NULL;
+	}
+
+	int32_t value;
+	if (!parse_field(str, value))
+	{
+		return NULL;
+	}
+	packet.rssi = value;
+	if (fsk)
+	{
+		return str;
+	}
+	if (!parse_field(str, value))
+	{
+		return NULL;
+	}
+	packet.snr = value;
+	if (packet.window != RX_WINDOW_P2P)
+	{
+		if (strncmp(str, "MULTICAST:", 10) == 0)
+		{
+			packet.multicast = true;
+			str += 10;
+		}
+		else if (strncmp(str, "UNICAST:", 8) == 0)
+		{
+			str += 8;
+		}
+		else
+		{
+			return NULL;
+		}
+		char *end_ptr;
+		value = strtol(str, &end_ptr, 10);
+		if ((end_ptr == str) || (value < 0) || (value > 255))
+		{
+			return NULL;
+		}
+		packet.port = value;
+		// Downlinks without payload have no payload field
+		str = *end_ptr == ':' ? end_ptr + 1 : end_ptr;
+	}
+	return str;
+}
+
+bool parseRX(char *line, rx_packet &packet)
+{
+	char *str = (char *)parse_header(line, packet);
+	if (str == NULL)
+	{
+		return false;
+	}
+	// Decode in place, the bytes never overtake the HEX characters
+	int16_t len = at_parse_hex(str, (uint8_t *)str, 0xFFFF);
+	if (len < 0)
+	{
+		return false;
+	}
+	packet.data = (const uint8_t *)str;
+	packet.len = len;
+	return true;
+}
+
+bool parseRX(const char *line, rx_packet &packet, uint8_t *buffer, uint16_t size)
+{
+	const char *str = parse_header(line, packet);
+	if (str == NULL)
+	{
+		return false;
+	}
+	uint16_t hex_len = 0;
+	while (isxdigit(str[hex_len]))
+	{
+		hex_len++;
+	}
+	packet.len = hex_len / 2;
+	if ((hex_len % 2) != 0)
+	{
+		return false;
+	}
+	if (packet.len > size)
+	{
+		packet.data = NULL;
+		return true;
+	}
+	at_parse_hex(str, buffer, size);
+	packet.data = buffer;
+	return true;
+}
+
+bool RUI3Downlink::on(uint8_t port, downlink_handler handler)
+{
+	int8_t slot = -1;
+	for (uint8_t idx = 0; idx < DOWNLINK_MAX_HANDLERS; idx++)
+	{
+		if ((_handlers[idx] != NULL) && (_ports[idx] == port))
+		{
+			slot = idx;
+			break;
+		}
+		if ((_handlers[idx] == NULL) && (slot < 0))
+		{
+			slot = idx;
+		}
+	}
+	if (slot < 0)
+	{
+		MYLOG("downlink", "Handler table full");
+		return false;
+	}
+	_ports[slot] = port;
+	_handlers[slot] = handler;
+	return true;
+}
+
+void RUI3Downlink::off(uint8_t port)
+{
+	for (uint8_t idx = 0; idx < DOWNLINK_MAX_HANDLERS; idx++)
+	{
+		if ((_handlers[idx] != NULL) && (_ports[idx] == port))
+		{
+			_handlers[idx] = NULL;
+		}
+	}
+}
+
+void RUI3Downlink::onDefault(downlink_handler handler)
+{
+	_default = handler;
+}
+
+bool RUI3Downlink::dispatch(char *line)
+{
+	rx_packet packet;
+	if (!parseRX(line, packet) || (packet.window == RX_WINDOW_P2P))
+	{
+		return false;
+	}
+	_received++;
+	for (uint8_t idx = 0; idx < DOWNLINK_MAX_HANDLERS; idx++)
+	{
+		if ((_handlers[idx] != NULL) && (_ports[idx] == packet.port))
+		{
+			_handlers[idx](packet);
+			return true;
+		}
+	}
+	if (_default != NULL)
+	{
+		_default(packet);
+	}
+	else
+	{
+		MYLOG("downlink", "No handler for fPort %d", packet.port);
+		_unhandled++;
+	}
+	return true;
+}
+
+uint32_t RUI3Downlink::received(void)
+{
+	return _received;
+}
+
+uint32_t RUI3Downlink::unhandled(void)
+{
+	return _unhandled;
+}
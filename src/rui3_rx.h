@@ -0,0 +1,190 @@
+/**
+ * @file rui3_rx.h
+ * @author Bernd Giesecke (bernd@giesecke.tk)
+ * @brief Parser for RX events and LoRaWAN downlink dispatch by fPort
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ * @copyright Copyright (c) 2026
+ *
+ * RX events of RUI3 V4:
+ * +EVT:RX_1:-70:8:UNICAST:2:1234 LoRaWAN RX window 1, 2, B or C, RSSI, SNR, unicast or multicast, fPort, payload
+ * +EVT:RXP2P:-112:1:1234 LoRa P2P, RSSI, SNR, payload
+ * +EVT:RXFSK:-85:1234 FSK P2P, RSSI, payload
+ * The payload is decoded in place, the parsed packet points into the line buffer and is valid until the buffer is reused.
+ */
+#ifndef _RUI3_RX_H_
+#define _RUI3_RX_H_
+#include <stdint.h>
+
+/** Max number of fPort handlers of RUI3Downlink */
+#ifndef DOWNLINK_MAX_HANDLERS
+#define DOWNLINK_MAX_HANDLERS 8
+#endif
+
+/** RX window of a LoRa or FSK P2P packet */
+#define RX_WINDOW_P2P 'P'
+
+/** Parsed RX event */
+typedef struct _rx_packet
+{
+	const uint8_t *data; // Payload, points into the line buffer
+	uint16_t len;		 // Payload length
+	int16_t rssi;		 // RSSI in dBm
+	int8_t snr;			 // SNR in dB, 0 for FSK
+	uint8_t port;		 // fPort, 0 for P2P
+	char window;		 // LoRaWAN RX window '1', '2', 'B' or 'C', RX_WINDOW_P2P for LoRa and FSK P2P
+	bool multicast;		 // LoRaWAN multicast downlink
+} rx_packet;
+
+/** Downlink handler */
+typedef void (*downlink_handler)(const rx_packet &packet);
+
+/**
+ * @brief Parse an RX event, the payload is decoded in place
+ *
+ * ```cpp
+ * bool parseRX(char *line, rx_packet &packet);
+ * ```
+ * @param line received line or lines, e.g. RUI3::ret, the RX event is searched in the buffer
+ * @param packet parsed packet
+ * @return true RX event found
+ * @return false No RX event or invalid format
+ *
+ * @par Usage
+ * @code
+ * wisduo.recvRX(30000);
+ * rx_packet packet;
+ * if (parseRX(wisduo.ret, packet))
+ * {
+ * 	Serial.printf("%d bytes, RSSI %d SNR %d\r\n", packet.len, packet.rssi, packet.snr);
+ * }
+ * @endcode
+ */
+bool parseRX(char *line, rx_packet &packet);
+
+/**
+ * @brief Parse an RX event and decode the payload into a buffer, the line is not changed
+ *
+ * ```cpp
+ * bool parseRX(const char *line, rx_packet &packet, uint8_t *buffer, uint16_t size);
+ * ```
+ * @param line received line or lines, the RX event is searched in the buffer
+ * @param packet parsed packet, data is NULL and len the payload length if the payload does not fit into the buffer
+ * @param buffer buffer for the payload
+ * @param size size of the buffer
+ * @return true RX event found
+ * @return false No RX event or invalid format
+ */
+bool parseRX(const char *line, rx_packet &packet, uint8_t *buffer, uint16_t size);
+
+/**
+ * @brief Dispatch of LoRaWAN downlinks to handlers by fPort
+ */
+class RUI3Downlink
+{
+public:
+	/**
+	 * @brief Register a handler for an fPort, replaces an existing handler of the fPort
+	 *
+	 * ```cpp
+	 * bool on(uint8_t port, downlink_handler handler);
+	 * ```
+	 * @param port fPort number (0-255)
+	 * @param handler handler
+	 * @return true Success
+	 * @return false Table is full
+	 *
+	 * @par Usage
+	 * @code
+	 * void config_handler(const rx_packet &packet)
+	 * {
+	 * 	// packet.data[0] ... packet.data[packet.len - 1]
+	 * }
+	 *
+	 * RUI3Downlink downlink;
+	 * downlink.on(10, config_handler);
+	 * @endcode
+	 */
+	bool on(uint8_t port, downlink_handler handler);
+
+	/**
+	 * @brief Remove the handler of an fPort
+	 *
+	 * ```cpp
+	 * void off(uint8_t port);
+	 * ```
+	 * @param port fPort number (0-255)
+	 */
+	void off(uint8_t port);
+
+	/**
+	 * @brief Set the handler for fPorts without a registered handler
+	 *
+	 * ```cpp
+	 * void onDefault(downlink_handler handler);
+	 * ```
+	 * @param handler handler, NULL to ignore these downlinks
+	 */
+	void onDefault(downlink_handler handler);
+
+	/**
+	 * @brief Parse a received line and call the handler of its fPort
+	 * P2P packets are ignored
+	 *
+	 * ```cpp
+	 * bool dispatch(char *line);
+	 * ```
+	 * @param line received line or lines, e.g. RUI3::ret, the payload is decoded in place
+	 * @return true Line contained a LoRaWAN downlink
+	 * @return false No downlink
+	 *
+	 * @par Usage
+	 * @code
+	 * if (wisduo.sendData(2, payload))
+	 * {
+	 * 	wisduo.waitTxDone();
+	 * 	downlink.dispatch(wisduo.ret);
+	 * }
+	 * @endcode
+	 */
+	bool dispatch(char *line);
+
+	/**
+	 * @brief Get the number of received downlinks
+	 *
+	 * ```cpp
+	 * uint32_t received(void);
+	 * ```
+	 * @return uint32_t number of downlinks
+	 */
+	uint32_t received(void);
+
+	/**
+	 * @brief Get the number of downlinks without handler
+	 *
+	 * ```cpp
+	 * uint32_t unhandled(void);
+	 * ```
+	 * @return uint32_t number of downlinks
+	 */
+	uint32_t unhandled(void);
+
+private:
+	/** fPorts of the handlers */
+	uint8_t _ports[DOWNLINK_MAX_HANDLERS];
+
+	/** Handlers, NULL = free entry */
+	downlink_handler _handlers[DOWNLINK_MAX_HANDLERS] = {NULL};
+
+	/** Handler for fPorts without handler */
+	downlink_handler _default = NULL;
+
+	/** Received downlinks */
+	uint32_t _received = 0;
+
+	/** Downlinks without handler */
+	uint32_t _unhandled = 0;
+};
+
+#endif // _RUI3_RX_H_
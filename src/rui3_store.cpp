@@ -0,0 +1,247 @@
+/**
+ * @file rui3_store.cpp
+ * @author Bernd Giesecke (bernd@giesecke.tk)
+ * @brief Persistent FIFO of pending uplinks with pluggable storage backends
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#include <Arduino.h>
+#include "rui3_at.h"
+#include "rui3_store.h"
+#include "rui3_no_heap.h"
+
+/**
+ * @brief CRC16 CCITT
+ *
+ * @param crc start value or CRC of the previous block
+ * @param data data
+ * @param len number of bytes
+ * @return uint16_t CRC
+ */
+static uint16_t crc16(uint16_t crc, const uint8_t *data, uint16_t len)
+{
+	while (len--)
+	{
+		crc ^= (uint16_t)*data++ << 8;
+		for (uint8_t bit = 0; bit < 8; bit++)
+		{
+			crc = (crc & 0x8000) ? (crc << 1) ^ 0x1021 : crc << 1;
+		}
+	}
+	return crc;
+}
+
+/**
+ * @brief CRC of a record
+ *
+ * @param record record
+ * @return uint16_t CRC of seq, port, len and data
+ */
+static uint16_t record_crc(const store_record &record)
+{
+	uint16_t crc = crc16(0xFFFF, (const uint8_t *)&record.seq, sizeof(record.seq));
+	crc = crc16(crc, &record.port, 1);
+	crc = crc16(crc, &record.len, 1);
+	return crc16(crc, record.data, record.len);
+}
+
+RUI3StoreRAM::RUI3StoreRAM(uint8_t *buffer, uint32_t size) : _buffer(buffer), _size(size)
+{
+}
+
+uint32_t RUI3StoreRAM::size(void)
+{
+	return _size;
+}
+
+bool RUI3StoreRAM::read(uint32_t addr, void *data, uint16_t len)
+{
+	if (addr + len > _size)
+	{
+		return false;
+	}
+	memcpy(data, &_buffer[addr], len);
+	return true;
+}
+
+bool RUI3StoreRAM::write(uint32_t addr, const void *data, uint16_t len)
+{
+	if (addr + len > _size)
+	{
+		return false;
+	}
+	memcpy(&_buffer[addr], data, len);
+	return true;
+}
+
+RUI3Store::RUI3Store(RUI3StoreBackend &backend) : _backend(backend)
+{
+}
+
+bool RUI3Store::begin(void)
+{
+	_slots = _backend.size() / sizeof(store_record);
+	uint32_t page = _backend.pageSize();
+	if ((_slots < 2) || ((page != 0) && ((page % sizeof(store_record)) != 0)))
+	{
+		MYLOG("store", "Storage too small or wrong page size");
+		_slots = 0;
+		return false;
+	}
+
+	bool found = false;
+	bool found_pending = false;
+	uint32_t last = 0;
+	uint32_t first_pending = 0;
+	_count = 0;
+	_dropped = 0;
+	store_record record;
+	for (uint32_t slot = 0; slot < _slots; slot++)
+	{
+		if (!_backend.read(slot * sizeof(store_record), &record, sizeof(store_record)))
+		{
+			_slots = 0;
+			return false;
+		}
+		if (((record.state != STORE_PENDING) && (record.state != STORE_SENT)) || (record.len > STORE_RECORD_PAYLOAD) ||
+			(record.crc != record_crc(record)))
+		{
+			continue;
+		}
+		if (!found || ((int32_t)(record.seq - _seq) > 0))
+		{
+			found = true;
+			_seq = record.seq;
+			last = slot;
+		}
+		if (record.state == STORE_PENDING)
+		{
+			if (!found_pending || ((int32_t)(record.seq - first_pending) < 0))
+			{
+				found_pending = true;
+				first_pending = record.seq;
+				_head = slot;
+			}
+			_count++;
+		}
+	}
+	if (found)
+	{
+		_seq++;
+		_tail = (last + 1) % _slots;
+	}
+	else
+	{
+		_seq = 0;
+		_tail = 0;
+	}
+	if (!found_pending)
+	{
+		_head = _tail;
+	}
+	MYLOG("store", "%lu of %lu records pending", (unsigned long)_count, (unsigned long)_slots);
+	return true;
+}
+
+bool RUI3Store::inRange(uint32_t slot, uint32_t first, uint32_t num)
+{
+	return ((slot + _slots - first) % _slots) < num;
+}
+
+bool RUI3Store::push(uint8_t port, const uint8_t *data, uint8_t len)
+{
+	if ((_slots == 0) || (len > STORE_RECORD_PAYLOAD))
+	{
+		return false;
+	}
+	uint32_t addr = _tail * sizeof(store_record);
+	uint32_t page = _backend.pageSize();
+	// Slots that are overwritten, a whole page if the storage has to be erased
+	uint32_t num = 1;
+	if ((page != 0) && ((addr % page) == 0))
+	{
+		num = page / sizeof(store_record);
+	}
+	else
+	{
+		page = 0;
+	}
+	while ((_count != 0) && inRange(_head, _tail, num))
+	{
+		_head = (_head + 1) % _slots;
+		_count--;
+		_dropped++;
+	}
+	if ((page != 0) && !_backend.erase(addr))
+	{
+		return false;
+	}
+
+	store_record record;
+	record.seq = _seq;
+	record.state = STORE_PENDING;
+	record.port = port;
+	record.len = len;
+	memcpy(record.data, data, len);
+	record.crc = record_crc(record);
+	// Unused payload bytes are not written
+	if (!_backend.write(addr, &record, sizeof(store_record) - STORE_RECORD_PAYLOAD + len))
+	{
+		return false;
+	}
+	if (_count == 0)
+	{
+		_head = _tail;
+	}
+	_seq++;
+	_tail = (_tail + 1) % _slots;
+	_count++;
+	return true;
+}
+
+bool RUI3Store::peek(store_record &record, uint32_t offset)
+{
+	if (offset >= _count)
+	{
+		return false;
+	}
+	uint32_t addr = ((_head + offset) % _slots) * sizeof(store_record);
+	return _backend.read(addr, &record, sizeof(store_record)) && (record.state == STORE_PENDING);
+}
+
+bool RUI3Store::pop(uint32_t num)
+{
+	if (num > _count)
+	{
+		return false;
+	}
+	const uint8_t state = STORE_SENT;
+	while (num--)
+	{
+		if (!_backend.write(_head * sizeof(store_record) + offsetof(store_record, state), &state, 1))
+		{
+			return false;
+		}
+		_head = (_head + 1) % _slots;
+		_count--;
+	}
+	return true;
+}
+
+uint32_t RUI3Store::pending(void)
+{
+	return _count;
+}
+
+uint32_t RUI3Store::capacity(void)
+{
+	return _slots;
+}
+
+uint32_t RUI3Store::dropped(void)
+{
+	return _dropped;
+}
@@ -0,0 +1,262 @@
+/**
+ * @file rui3_store.h
+ * @author Bernd Giesecke (bernd@giesecke.tk)
+ * @brief Persistent FIFO of pending uplinks with pluggable storage backends
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ * @copyright Copyright (c) 2026
+ *
+ * The storage is divided into slots of fixed size records. New records are appended in a ring over all slots,
+ * every slot is written equally often. A sent record is only marked in its state byte, the marker clears bits only,
+ * so it can be written to flash without erasing the page.
+ * The head and tail of the FIFO are not stored, begin() finds them from the sequence numbers of the records.
+ */
+#ifndef _RUI3_STORE_H_
+#define _RUI3_STORE_H_
+#include <stdint.h>
+
+/** Max payload of a stored record, the record size is 9 bytes more */
+#ifndef STORE_RECORD_PAYLOAD
+#define STORE_RECORD_PAYLOAD 55
+#endif
+
+/** Record states, the state only goes from erased to pending to sent */
+#define STORE_EMPTY 0xFF
+#define STORE_PENDING 0xA5
+#define STORE_SENT 0x00
+
+/** Stored uplink */
+typedef struct _store_record
+{
+	uint32_t seq;						// Sequence number, the FIFO order
+	uint16_t crc;						// CRC16 of seq, port, len and data
+	uint8_t state;						// STORE_EMPTY, STORE_PENDING or STORE_SENT
+	uint8_t port;						// fPort
+	uint8_t len;						// Payload length
+	uint8_t data[STORE_RECORD_PAYLOAD]; // Payload
+} store_record;
+
+/**
+ * @brief Storage backend interface
+ * Addresses are relative to the start of the storage area
+ */
+class RUI3StoreBackend
+{
+public:
+	virtual ~RUI3StoreBackend() {}
+
+	/**
+	 * @brief Get the size of the storage area
+	 *
+	 * @return uint32_t size in bytes
+	 */
+	virtual uint32_t size(void) = 0;
+
+	/**
+	 * @brief Get the erase unit of the storage
+	 *
+	 * @return uint32_t page size in bytes, multiple of sizeof(store_record), 0 if no erase is needed
+	 */
+	virtual uint32_t pageSize(void) { return 0; }
+
+	/**
+	 * @brief Read from the storage
+	 *
+	 * @param addr address
+	 * @param data buffer
+	 * @param len number of bytes
+	 * @return true Success
+	 * @return false Read error
+	 */
+	virtual bool read(uint32_t addr, void *data, uint16_t len) = 0;
+
+	/**
+	 * @brief Write to the storage
+	 *
+	 * @param addr address
+	 * @param data data
+	 * @param len number of bytes
+	 * @return true Success
+	 * @return false Write error
+	 */
+	virtual bool write(uint32_t addr, const void *data, uint16_t len) = 0;
+
+	/**
+	 * @brief Erase a page, only called if pageSize() is not 0
+	 *
+	 * @param addr start address of the page
+	 * @return true Success
+	 * @return false Erase error
+	 */
+	virtual bool erase(uint32_t addr)
+	{
+		(void)addr;
+		return true;
+	}
+};
+
+/**
+ * @brief RAM storage backend
+ * The content survives a reset only if the buffer is placed in a RAM section that is not initialized at boot
+ */
+class RUI3StoreRAM : public RUI3StoreBackend
+{
+public:
+	/**
+	 * @brief Use a buffer as storage
+	 *
+	 * @param buffer buffer
+	 * @param size size of the buffer in bytes
+	 */
+	RUI3StoreRAM(uint8_t *buffer, uint32_t size);
+
+	uint32_t size(void);
+	bool read(uint32_t addr, void *data, uint16_t len);
+	bool write(uint32_t addr, const void *data, uint16_t len);
+
+private:
+	uint8_t *_buffer;
+	uint32_t _size;
+};
+
+/**
+ * @brief Persistent FIFO of pending uplinks
+ */
+class RUI3Store
+{
+public:
+	/**
+	 * @brief Create the FIFO
+	 *
+	 * @param backend storage backend
+	 */
+	RUI3Store(RUI3StoreBackend &backend);
+
+	/**
+	 * @brief Find the pending records in the storage
+	 * Reads all slots once, records with a wrong CRC (e.g. from a reset during a write) are ignored
+	 *
+	 * ```cpp
+	 * bool begin(void);
+	 * ```
+	 * @return true Success
+	 * @return false Storage too small, page size no multiple of the record size or read error
+	 *
+	 * @par Usage
+	 * @code
+	 * uint8_t store_buffer[4096];
+	 * RUI3StoreRAM store_ram(store_buffer, sizeof(store_buffer));
+	 * RUI3Store store(store_ram);
+	 * void setup()
+	 * {
+	 * 	store.begin();
+	 * 	Serial.printf("%ld uplinks pending\r\n", store.pending());
+	 * }
+	 * @endcode
+	 */
+	bool begin(void);
+
+	/**
+	 * @brief Append a record
+	 * If the storage is full, the oldest pending records are overwritten
+	 *
+	 * ```cpp
+	 * bool push(uint8_t port, const uint8_t *data, uint8_t len);
+	 * ```
+	 * @param port fPort number (1-223)
+	 * @param data payload
+	 * @param len payload length, max STORE_RECORD_PAYLOAD
+	 * @return true Success
+	 * @return false Payload too long or write error
+	 */
+	bool push(uint8_t port, const uint8_t *data, uint8_t len);
+
+	/**
+	 * @brief Read a pending record without removing it
+	 *
+	 * ```cpp
+	 * bool peek(store_record &record, uint32_t offset = 0);
+	 * ```
+	 * @param record record
+	 * @param offset position in the FIFO, 0 = oldest record
+	 * @return true Success
+	 * @return false No record at the offset or read error
+	 */
+	bool peek(store_record &record, uint32_t offset = 0);
+
+	/**
+	 * @brief Remove the oldest records, they are marked as sent
+	 *
+	 * ```cpp
+	 * bool pop(uint32_t num = 1);
+	 * ```
+	 * @param num number of records
+	 * @return true Success
+	 * @return false Less records pending or write error
+	 */
+	bool pop(uint32_t num = 1);
+
+	/**
+	 * @brief Get the number of pending records
+	 *
+	 * ```cpp
+	 * uint32_t pending(void);
+	 * ```
+	 * @return uint32_t number of records
+	 */
+	uint32_t pending(void);
+
+	/**
+	 * @brief Get the number of record slots of the storage
+	 *
+	 * ```cpp
+	 * uint32_t capacity(void);
+	 * ```
+	 * @return uint32_t number of records
+	 */
+	uint32_t capacity(void);
+
+	/**
+	 * @brief Get the number of pending records that were overwritten because the storage was full
+	 *
+	 * ```cpp
+	 * uint32_t dropped(void);
+	 * ```
+	 * @return uint32_t number of records since begin()
+	 */
+	uint32_t dropped(void);
+
+private:
+	/**
+	 * @brief Check if a slot is within a range of slots
+	 *
+	 * @param slot slot
+	 * @param first first slot of the range
+	 * @param num number of slots of the range
+	 * @return true slot is within the range
+	 */
+	bool inRange(uint32_t slot, uint32_t first, uint32_t num);
+
+	RUI3StoreBackend &_backend;
+
+	/** Number of record slots */
+	uint32_t _slots = 0;
+
+	/** Slot of the oldest pending record */
+	uint32_t _head = 0;
+
+	/** Slot of the next record */
+	uint32_t _tail = 0;
+
+	/** Number of pending records */
+	uint32_t _count = 0;
+
+	/** Sequence number of the next record */
+	uint32_t _seq = 0;
+
+	/** Overwritten pending records */
+	uint32_t _dropped = 0;
+};
+
+#endif // _RUI3_STORE_H_
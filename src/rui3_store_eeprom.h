@@ -0,0 +1,80 @@
+/**
+ * @file rui3_store_eeprom.h
+ * @author Bernd Giesecke (bernd@giesecke.tk)
+ * @brief EEPROM storage backend for RUI3Store
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ * @copyright Copyright (c) 2026
+ *
+ * Header only, the EEPROM library is only needed if this file is included.
+ * On platforms that emulate the EEPROM in flash (ESP32, ESP8266, RP2040) EEPROM.begin() has to be called
+ * before RUI3Store::begin(), every write is committed.
+ */
+#ifndef _RUI3_STORE_EEPROM_H_
+#define _RUI3_STORE_EEPROM_H_
+#include <EEPROM.h>
+#include "rui3_store.h"
+
+/**
+ * @brief EEPROM storage backend
+ */
+class RUI3StoreEEPROM : public RUI3StoreBackend
+{
+public:
+	/**
+	 * @brief Use an area of the EEPROM as storage
+	 *
+	 * @param start start address in the EEPROM
+	 * @param size size of the area in bytes
+	 *
+	 * @par Usage
+	 * @code
+	 * #include <rui3_store_eeprom.h>
+	 * RUI3StoreEEPROM store_eeprom(0, 2048);
+	 * RUI3Store store(store_eeprom);
+	 * @endcode
+	 */
+	RUI3StoreEEPROM(uint32_t start, uint32_t size) : _start(start), _size(size) {}
+
+	uint32_t size(void)
+	{
+		return _size;
+	}
+
+	bool read(uint32_t addr, void *data, uint16_t len)
+	{
+		if (addr + len > _size)
+		{
+			return false;
+		}
+		for (uint16_t idx = 0; idx < len; idx++)
+		{
+			((uint8_t *)data)[idx] = EEPROM.read(_start + addr + idx);
+		}
+		return true;
+	}
+
+	bool write(uint32_t addr, const void *data, uint16_t len)
+	{
+		if (addr + len > _size)
+		{
+			return false;
+		}
+		for (uint16_t idx = 0; idx < len; idx++)
+		{
+			EEPROM.write(_start + addr + idx, ((const uint8_t *)data)[idx]);
+		}
+#if defined(ESP32) || defined(ESP8266) || defined(ARDUINO_ARCH_RP2040)
+		return EEPROM.commit();
+#else
+		return true;
+#endif
+	}
+
+private:
+	uint32_t _start;
+	uint32_t _size;
+};
+
+#endif // _RUI3_STORE_EEPROM_H_
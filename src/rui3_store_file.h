@@ -0,0 +1,85 @@
+/**
+ * @file rui3_store_file.h
+ * @author Bernd Giesecke (bernd@giesecke.tk)
+ * @brief File storage backend for RUI3Store, for host builds
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ * @copyright Copyright (c) 2026
+ *
+ * Header only, uses stdio. For builds on a host computer, e.g. a gateway with the module on a serial port.
+ */
+#ifndef _RUI3_STORE_FILE_H_
+#define _RUI3_STORE_FILE_H_
+#include <stdio.h>
+#include <string.h>
+#include "rui3_store.h"
+
+/**
+ * @brief File storage backend
+ */
+class RUI3StoreFile : public RUI3StoreBackend
+{
+public:
+	/**
+	 * @brief Use a file as storage, the file is created if it does not exist
+	 *
+	 * @param path file name
+	 * @param size size of the storage in bytes
+	 *
+	 * @par Usage
+	 * @code
+	 * #include <rui3_store_file.h>
+	 * RUI3StoreFile store_file("uplinks.bin", 65536);
+	 * RUI3Store store(store_file);
+	 * @endcode
+	 */
+	RUI3StoreFile(const char *path, uint32_t size) : _size(size)
+	{
+		_file = fopen(path, "r+b");
+		if (_file == NULL)
+		{
+			_file = fopen(path, "w+b");
+		}
+	}
+
+	~RUI3StoreFile()
+	{
+		if (_file != NULL)
+		{
+			fclose(_file);
+		}
+	}
+
+	uint32_t size(void)
+	{
+		return _file == NULL ? 0 : _size;
+	}
+
+	bool read(uint32_t addr, void *data, uint16_t len)
+	{
+		if ((_file == NULL) || (addr + len > _size) || (fseek(_file, addr, SEEK_SET) != 0))
+		{
+			return false;
+		}
+		size_t num = fread(data, 1, len, _file);
+		// Not yet written parts of the file read as erased
+		memset((uint8_t *)data + num, 0xFF, len - num);
+		return true;
+	}
+
+	bool write(uint32_t addr, const void *data, uint16_t len)
+	{
+		if ((_file == NULL) || (addr + len > _size) || (fseek(_file, addr, SEEK_SET) != 0))
+		{
+			return false;
+		}
+		return (fwrite(data, 1, len, _file) == len) && (fflush(_file) == 0);
+	}
+
+private:
+	FILE *_file;
+	uint32_t _size;
+};
+
+#endif // _RUI3_STORE_FILE_H_
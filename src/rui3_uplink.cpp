@@ -0,0 +1,682 @@
+/**
+ * @file rui3_uplink.cpp
+ * @author Bernd Giesecke (bernd@giesecke.tk)
+ * @brief LoRaWAN uplink scheduler that respects the duty cycle limits of the region
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#include <Arduino.h>
+#include "rui3_uplink.h"
+#include "rui3_no_heap.h"
+
+RUI3Uplink::RUI3Uplink(RUI3 &rui3) : _rui3(rui3)
+{
+	resetStats();
+	memset(&_report, 0, sizeof(_report));
+	_report.result = UPLINK_NONE;
+}
+
+bool RUI3Uplink::begin(void)
+{
+	uint8_t region = _rui3.getRegion();
+	uint8_t dr = _rui3.getDataRate();
+	if ((region == NO_RESPONSE) || (dr == NO_RESPONSE))
+	{
+		return false;
+	}
+	_confirmed = _rui3.getConfirmed() == CONF;
+	_joined = _rui3.getJoinStatus();
+	return begin(region, dr);
+}
+
+bool RUI3Uplink::begin(uint8_t region, uint8_t dr)
+{
+	// The module uses the datarate for the time-on-air and the TX done timeout as well
+	if ((regionParams(region) == NULL) || !_rui3.setDataRate(dr))
+	{
+		return false;
+	}
+	_region = region;
+	_dr = dr;
+	duty.setRegion(region);
+	return true;
+}
+
+bool RUI3Uplink::setDataRate(uint8_t dr)
+{
+	if ((_batch_num != 0) && (_batch.len > regionMaxPayload(_region, dr)))
+	{
+		// Collected readings do not fit into the new datarate
+		flush();
+	}
+	if (!_rui3.setDataRate(dr))
+	{
+		return false;
+	}
+	_dr = dr;
+	return true;
+}
+
+bool RUI3Uplink::setConfirmed(bool confirmed)
+{
+	if (!_rui3.setConfirmed(confirmed ? CONF : UNCONF))
+	{
+		return false;
+	}
+	_confirmed = confirmed;
+	return true;
+}
+
+void RUI3Uplink::setRetry(const uplink_retry &retry)
+{
+	_retry = retry;
+	if (_retry.attempts < 1)
+	{
+		_retry.attempts = 1;
+	}
+	else if (_retry.attempts > UPLINK_MAX_ATTEMPTS)
+	{
+		_retry.attempts = UPLINK_MAX_ATTEMPTS;
+	}
+}
+
+void RUI3Uplink::setCallback(uplink_callback callback)
+{
+	_callback = callback;
+}
+
+void RUI3Uplink::setStore(RUI3Store *store, uint8_t batch)
+{
+	_store = store;
+	_store_batch = batch == 0 ? 1 : batch;
+}
+
+void RUI3Uplink::setDownlink(RUI3Downlink *downlink)
+{
+	_downlink = downlink;
+}
+
+void RUI3Uplink::setJoined(bool joined)
+{
+	_joined = joined;
+}
+
+bool RUI3Uplink::send(uint8_t port, const uint8_t *data, uint8_t len, uint8_t prio, bool supersede)
+{
+	if ((len > regionMaxPayload(_region, _dr)) || (prio >= UPLINK_PRIORITIES))
+	{
+		MYLOG("uplink", "Invalid priority or payload too long");
+		return false;
+	}
+	if ((_store != NULL) && !_joined)
+	{
+		return _store->push(port, data, len);
+	}
+
+	int8_t slot = -1;
+	if (supersede)
+	{
+		for (uint8_t idx = 0; idx < UPLINK_QUEUE_SIZE; idx++)
+		{
+			if ((_used & (1 << idx)) && (idx != _store_slot) && (_queue[idx].port == port) && (_queue[idx].prio == prio))
+			{
+				// Keep the place in the queue, replace the payload
+				_stats[prio].superseded++;
+				slot = idx;
+				break;
+			}
+		}
+	}
+	if (slot < 0)
+	{
+		for (uint8_t idx = 0; idx < UPLINK_QUEUE_SIZE; idx++)
+		{
+			if (!(_used & (1 << idx)) && (idx != _tx_slot) && (idx != _park_slot))
+			{
+				slot = idx;
+				break;
+			}
+		}
+		if (slot < 0)
+		{
+			// Queue is full, push out the oldest frame with the lowest priority
+			for (uint8_t idx = 0; idx < UPLINK_QUEUE_SIZE; idx++)
+			{
+				if ((idx != _tx_slot) && (idx != _park_slot) && (_queue[idx].prio < prio) &&
+					((slot < 0) || (_queue[idx].prio < _queue[slot].prio) ||
+					 ((_queue[idx].prio == _queue[slot].prio) && ((int16_t)(_queue[idx].seq - _queue[slot].seq) < 0))))
+				{
+					slot = idx;
+				}
+			}
+			if (slot < 0)
+			{
+				MYLOG("uplink", "Queue full");
+				return false;
+			}
+			if (slot == _store_slot)
+			{
+				// The records are still in the store
+				_store_slot = -1;
+			}
+			else
+			{
+				MYLOG("uplink", "Drop frame with priority %d", _queue[slot].prio);
+				_stats[_queue[slot].prio].dropped++;
+			}
+		}
+		_queue[slot].seq = _seq++;
+		_queue[slot].port = port;
+		_queue[slot].prio = prio;
+	}
+	_queue[slot].queued = millis();
+	_queue[slot].len = len;
+	memcpy(_queue[slot].data, data, len);
+	_used |= 1 << slot;
+	loop();
+	return true;
+}
+
+bool RUI3Uplink::add(uint8_t port, const uint8_t *data, uint8_t len, uint32_t max_delay, uint8_t prio)
+{
+	uint8_t max_len = regionMaxPayload(_region, _dr);
+	if (len > max_len)
+	{
+		MYLOG("uplink", "Reading too long");
+		return false;
+	}
+	if ((_batch_num != 0) && ((_batch.port != port) || (_batch.prio != prio) || (_batch.len + len > max_len)))
+	{
+		if (!flush())
+		{
+			return false;
+		}
+	}
+	uint32_t now = millis();
+	if (_batch_num == 0)
+	{
+		_batch.port = port;
+		_batch.prio = prio;
+		_batch.len = 0;
+		_batch_deadline = now + max_delay;
+	}
+	else if ((int32_t)(now + max_delay - _batch_deadline) < 0)
+	{
+		_batch_deadline = now + max_delay;
+	}
+	memcpy(&_batch.data[_batch.len], data, len);
+	_batch.len += len;
+	_batch_num++;
+	if (_batch.len == max_len)
+	{
+		flush();
+	}
+	return true;
+}
+
+bool RUI3Uplink::flush(void)
+{
+	if (_batch_num == 0)
+	{
+		return true;
+	}
+	MYLOG("uplink", "Queue %d readings, %d bytes", _batch_num, _batch.len);
+	// Empty the buffer before send(), it calls loop()
+	uint8_t batch_num = _batch_num;
+	_batch_num = 0;
+	if (!send(_batch.port, _batch.data, _batch.len, _batch.prio))
+	{
+		_batch_num = batch_num;
+		return false;
+	}
+	return true;
+}
+
+uint8_t RUI3Uplink::collected(void)
+{
+	return _batch_num;
+}
+
+uint32_t RUI3Uplink::nextUplink(uint8_t len)
+{
+	return duty.waitTime(regionChannelFreq(_region, 0), timeOnAir(_region, _dr, len));
+}
+
+void RUI3Uplink::loop(void)
+{
+	if ((_batch_num != 0) && ((int32_t)(millis() - _batch_deadline) >= 0))
+	{
+		flush();
+	}
+	// Events are read while an uplink is active, stored uplinks wait for the join or downlinks are dispatched
+	if (_tx_active || ((_store != NULL) && !_joined) || (_downlink != NULL))
+	{
+		while (_rui3.pollLine())
+		{
+			if ((_downlink != NULL) && _downlink->dispatch(_rui3.ret))
+			{
+				continue;
+			}
+			if (strstr(_rui3.ret, "+EVT:JOINED") != NULL)
+			{
+				MYLOG("uplink", "Joined");
+				_joined = true;
+				_store_fails = 0;
+				continue;
+			}
+			if (!_tx_active)
+			{
+				continue;
+			}
+			// Confirmed uplinks finish with the ACK, not with TX done
+			if ((!_confirmed && (strstr(_rui3.ret, "+EVT:TX_DONE") != NULL)) || (strstr(_rui3.ret, "+EVT:SEND_CONFIRMED_OK") != NULL))
+			{
+				finish(UPLINK_OK);
+				break;
+			}
+			if (strstr(_rui3.ret, "+EVT:SEND_CONFIRMED_FAILED") != NULL)
+			{
+				finish(UPLINK_FAILED);
+				break;
+			}
+		}
+	}
+	if (_tx_active)
+	{
+		if ((millis() - _tx_start) >= _tx_timeout)
+		{
+			finish(UPLINK_TIMEOUT);
+		}
+		if (_tx_active)
+		{
+			return;
+		}
+	}
+	if (!_retry_wait && (_park_slot >= 0))
+	{
+		// The frame sent during the backoff is finished, continue with the retries of the parked frame
+		resume();
+	}
+	int8_t idx = nextFrame();
+	if (_retry_wait)
+	{
+		// The retries of the active frame go first
+		if (((int32_t)(millis() - _retry_at) >= 0) && (nextUplink(_queue[_tx_slot].len) == 0))
+		{
+			_retry_wait = false;
+			transmit(_tx_slot);
+			return;
+		}
+		// The radio is idle during the backoff, one frame with a higher priority is sent in between
+		if ((_park_slot < 0) && (idx >= 0) && (_queue[idx].prio > _tx_prio) && (nextUplink(_queue[idx].len) == 0))
+		{
+			park();
+			start(idx);
+		}
+		return;
+	}
+	if ((idx < 0) && (_store != NULL) && _joined && (_store_slot < 0) && (_store->pending() != 0) &&
+		((_store_fails == 0) || ((int32_t)(millis() - _store_at) >= 0)))
+	{
+		loadStore();
+		idx = nextFrame();
+	}
+	// Lower priorities have to wait as well, all uplinks use the same sub-band
+	if ((idx >= 0) && (nextUplink(_queue[idx].len) == 0))
+	{
+		start(idx);
+	}
+}
+
+bool RUI3Uplink::busy(void)
+{
+	return _tx_active || _retry_wait || (_park_slot >= 0) || (_used != 0);
+}
+
+uint8_t RUI3Uplink::queued(void)
+{
+	uint8_t num = 0;
+	for (uint8_t idx = 0; idx < UPLINK_QUEUE_SIZE; idx++)
+	{
+		if (_used & (1 << idx))
+		{
+			num++;
+		}
+	}
+	return num;
+}
+
+const uplink_stats &RUI3Uplink::stats(uint8_t prio)
+{
+	return _stats[prio < UPLINK_PRIORITIES ? prio : UPLINK_PRIORITIES - 1];
+}
+
+void RUI3Uplink::resetStats(void)
+{
+	memset(_stats, 0, sizeof(_stats));
+	for (uint8_t prio = 0; prio < UPLINK_PRIORITIES; prio++)
+	{
+		_stats[prio].lat_min = 0xFFFFFFFF;
+	}
+	memset(&_ack, 0, sizeof(_ack));
+	_ack.lat_min = 0xFFFFFFFF;
+}
+
+const uplink_ack_stats &RUI3Uplink::ackStats(void)
+{
+	return _ack;
+}
+
+int8_t RUI3Uplink::nextFrame(void)
+{
+	int8_t next = -1;
+	for (uint8_t idx = 0; idx < UPLINK_QUEUE_SIZE; idx++)
+	{
+		if (!(_used & (1 << idx)))
+		{
+			continue;
+		}
+		if ((next < 0) || (_queue[idx].prio > _queue[next].prio) ||
+			((_queue[idx].prio == _queue[next].prio) && ((int16_t)(_queue[idx].seq - _queue[next].seq) < 0)))
+		{
+			next = idx;
+		}
+	}
+	return next;
+}
+
+uint8_t RUI3Uplink::lastResult(void)
+{
+	return _result;
+}
+
+const uplink_report &RUI3Uplink::lastReport(void)
+{
+	return _report;
+}
+
+void RUI3Uplink::start(uint8_t idx)
+{
+	_used &= ~(1 << idx);
+	// Keep the frame for the retries or the store, unconfirmed frames are sent only once
+	_tx_slot = ((_confirmed && (_retry.attempts > 1)) || (_store != NULL)) ? idx : -1;
+	_tx_prio = _queue[idx].prio;
+	_tx_queued = _queue[idx].queued;
+	_dr_first = _dr;
+	if ((idx == _store_slot) && (_store_dr != _dr) && _rui3.setDataRate(_store_dr))
+	{
+		// Restored with the datarate of the first attempt by complete()
+		_dr = _store_dr;
+	}
+	_report.seq = _queue[idx].seq;
+	_report.port = _queue[idx].port;
+	_report.prio = _queue[idx].prio;
+	_report.result = UPLINK_NONE;
+	_report.attempts = 0;
+	_report.ack_latency = 0;
+	transmit(idx);
+}
+
+void RUI3Uplink::transmit(uint8_t idx)
+{
+	_report.dr[_report.attempts] = _dr;
+	_report.attempts++;
+	if (!_rui3.sendData(_queue[idx].port, _queue[idx].data, _queue[idx].len))
+	{
+		if (strstr(_rui3.ret, "AT_NO_NETWORK_JOINED") != NULL)
+		{
+			_joined = false;
+		}
+		finish(UPLINK_ERROR);
+		return;
+	}
+	// Same time-on-air as nextUplink()
+	duty.consume(regionChannelFreq(_region, 0), timeOnAir(_region, _dr, _queue[idx].len));
+	_tx_active = true;
+	_tx_start = millis();
+	_tx_timeout = _rui3.getTxTimeout();
+}
+
+void RUI3Uplink::finish(uint8_t result)
+{
+	MYLOG("uplink", "Attempt %d finished with %d", _report.attempts, result);
+	_tx_active = false;
+	_report.results[_report.attempts - 1] = result;
+	if ((result == UPLINK_OK) || !_confirmed || (_tx_slot < 0) || !_joined || (_report.attempts >= _retry.attempts))
+	{
+		if ((result == UPLINK_OK) && _confirmed)
+		{
+			_report.ack_latency = millis() - _tx_start;
+		}
+		complete(result);
+		return;
+	}
+
+	// Exponential backoff with jitter, nodes that lost the same downlink should not retry together
+	uint32_t backoff = _retry.backoff;
+	for (uint8_t attempt = 1; (attempt < _report.attempts) && (backoff < _retry.backoff_max); attempt++)
+	{
+		backoff *= 2;
+	}
+	if (backoff > _retry.backoff_max)
+	{
+		backoff = _retry.backoff_max;
+	}
+	backoff += random(backoff / 2 + 1);
+	_retry_at = millis() + backoff;
+	_retry_wait = true;
+	_ack.retries++;
+
+	// A lower datarate has a better range, but only if the frame still fits
+	if ((_retry.dr_step != 0) && ((_report.attempts % _retry.dr_step) == 0) && (_dr > _retry.min_dr) &&
+		(regionMaxPayload(_region, _dr - 1) >= _queue[_tx_slot].len))
+	{
+		if (_rui3.setDataRate(_dr - 1))
+		{
+			_dr--;
+		}
+	}
+	MYLOG("uplink", "Retry in %lu ms with DR%d", (unsigned long)backoff, _dr);
+}
+
+void RUI3Uplink::park(void)
+{
+	MYLOG("uplink", "Retry of frame %d parked", _report.seq);
+	_park_slot = _tx_slot;
+	_park_prio = _tx_prio;
+	_park_queued = _tx_queued;
+	_park_at = _retry_at;
+	_park_dr = _dr;
+	_park_report = _report;
+	_retry_wait = false;
+	_tx_slot = -1;
+	// The frame in between is sent with the datarate of the first attempt
+	if ((_dr != _dr_first) && _rui3.setDataRate(_dr_first))
+	{
+		_dr = _dr_first;
+	}
+}
+
+void RUI3Uplink::resume(void)
+{
+	MYLOG("uplink", "Retry of frame %d resumed", _park_report.seq);
+	_tx_slot = _park_slot;
+	_tx_prio = _park_prio;
+	_tx_queued = _park_queued;
+	_retry_at = _park_at;
+	_report = _park_report;
+	_retry_wait = true;
+	_park_slot = -1;
+	_dr_first = _dr;
+	if ((_park_dr != _dr) && _rui3.setDataRate(_park_dr))
+	{
+		_dr = _park_dr;
+	}
+}
+
+void RUI3Uplink::loadStore(void)
+{
+	int8_t slot = -1;
+	for (uint8_t idx = 0; idx < UPLINK_QUEUE_SIZE; idx++)
+	{
+		if (!(_used & (1 << idx)) && (idx != _tx_slot) && (idx != _park_slot))
+		{
+			slot = idx;
+			break;
+		}
+	}
+	store_record record;
+	if ((slot < 0) || !_store->peek(record))
+	{
+		return;
+	}
+	uint8_t max_len = regionMaxPayload(_region, _dr);
+	_store_dr = _dr;
+	if (record.len > max_len)
+	{
+		// The datarate was lowered after the record was stored, it is sent alone with a faster datarate
+		_store_dr = fitDataRate(record.len);
+		if (_store_dr == NO_RESPONSE)
+		{
+			MYLOG("uplink", "Stored record with %d bytes too long for all datarates, dropped", record.len);
+			_store->pop();
+			_stats[UPLINK_PRIO_LOW].dropped++;
+			return;
+		}
+		max_len = record.len;
+	}
+	uplink_frame &frame = _queue[slot];
+	frame.port = record.port;
+	frame.len = 0;
+	_store_num = 0;
+	// Records of the same fPort are concatenated, like the readings of add()
+	do
+	{
+		if ((record.port != frame.port) || (frame.len + record.len > max_len))
+		{
+			break;
+		}
+		memcpy(&frame.data[frame.len], record.data, record.len);
+		frame.len += record.len;
+		_store_num++;
+	} while ((_store_num < _store_batch) && _store->peek(record, _store_num));
+	frame.seq = _seq++;
+	frame.prio = UPLINK_PRIO_LOW;
+	frame.queued = millis();
+	_used |= 1 << slot;
+	_store_slot = slot;
+	MYLOG("uplink", "Load %d stored records, %d bytes", _store_num, frame.len);
+}
+
+uint8_t RUI3Uplink::fitDataRate(uint8_t len)
+{
+	// Up to the first datarate that is not LoRa, e.g. FSK or not available
+	for (uint8_t dr = _dr + 1; regionSF(_region, dr) != 0; dr++)
+	{
+		if (regionMaxPayload(_region, dr) >= len)
+		{
+			return dr;
+		}
+	}
+	return NO_RESPONSE;
+}
+
+void RUI3Uplink::complete(uint8_t result)
+{
+	if ((_store != NULL) && (_tx_slot >= 0))
+	{
+		if (_tx_slot == _store_slot)
+		{
+			// Stored records are removed only after the uplink succeeded
+			if (result == UPLINK_OK)
+			{
+				_store->pop(_store_num);
+			}
+			_store_slot = -1;
+		}
+		else if ((result != UPLINK_OK) && !_store->push(_queue[_tx_slot].port, _queue[_tx_slot].data, _queue[_tx_slot].len))
+		{
+			MYLOG("uplink", "Frame too long for the store");
+		}
+		// After a failed uplink the stored frames wait, the network is probably not reachable
+		if (result == UPLINK_OK)
+		{
+			_store_fails = 0;
+		}
+		else
+		{
+			uint32_t backoff = STORE_RETRY_BACKOFF;
+			for (uint8_t fail = 0; (fail < _store_fails) && (backoff < STORE_RETRY_BACKOFF_MAX); fail++)
+			{
+				backoff *= 2;
+			}
+			if (backoff > STORE_RETRY_BACKOFF_MAX)
+			{
+				backoff = STORE_RETRY_BACKOFF_MAX;
+			}
+			_store_at = millis() + backoff + random(backoff / 2 + 1);
+			if (_store_fails < 255)
+			{
+				_store_fails++;
+			}
+			MYLOG("uplink", "Store drained again in %lu ms", (unsigned long)(_store_at - millis()));
+		}
+	}
+	_tx_slot = -1;
+	_result = result;
+	_report.result = result;
+	if ((_dr != _dr_first) && _rui3.setDataRate(_dr_first))
+	{
+		_dr = _dr_first;
+	}
+	if (_confirmed)
+	{
+		if (result == UPLINK_OK)
+		{
+			_ack.acked++;
+			_ack.on_attempt[_report.attempts - 1]++;
+			_ack.lat_sum += _report.ack_latency;
+			if (_report.ack_latency < _ack.lat_min)
+			{
+				_ack.lat_min = _report.ack_latency;
+			}
+			if (_report.ack_latency > _ack.lat_max)
+			{
+				_ack.lat_max = _report.ack_latency;
+			}
+		}
+		else
+		{
+			_ack.lost++;
+		}
+	}
+
+	uplink_stats &stats = _stats[_tx_prio];
+	if (result != UPLINK_OK)
+	{
+		stats.failed++;
+	}
+	else
+	{
+		uint32_t latency = millis() - _tx_queued;
+		stats.sent++;
+		stats.lat_sum += latency;
+		if (latency < stats.lat_min)
+		{
+			stats.lat_min = latency;
+		}
+		if (latency > stats.lat_max)
+		{
+			stats.lat_max = latency;
+		}
+	}
+
+	// Last, the callback may queue the next frame
+	if (_callback != NULL)
+	{
+		_callback(_report);
+	}
+}
@@ -0,0 +1,686 @@
+/**
+ * @file rui3_uplink.h
+ * @author Bernd Giesecke (bernd@giesecke.tk)
+ * @brief LoRaWAN uplink scheduler that respects the duty cycle limits of the region
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ * @copyright Copyright (c) 2026
+ *
+ * Uplinks are sent from loop() without blocking. If the duty cycle of the sub-band does not allow an uplink,
+ * the frame is kept until enough credit is available.
+ * Waiting frames are kept in a fixed pool, the frame with the highest priority is sent first, frames with the
+ * same priority in the order they were queued.
+ * Small readings can be collected into one frame up to the max payload of the datarate, this saves the
+ * LoRaWAN overhead and the preamble of each single uplink.
+ * Confirmed uplinks that are not acknowledged are repeated by the retry policy, with backoff and lower datarates.
+ * With a persistent store, uplinks that cannot be sent are kept in the store and sent after the next join.
+ * Downlinks received while loop() reads the events are passed to a downlink dispatch table.
+ * The module selects the uplink channel, all uplinks are accounted to the sub-band of the default channels.
+ */
+#ifndef _RUI3_UPLINK_H_
+#define _RUI3_UPLINK_H_
+#include "rui3_at.h"
+#include "rui3_duty.h"
+#include "rui3_store.h"
+#include "rui3_rx.h"
+
+/** Max payload of an uplink frame */
+#define UPLINK_MAX_PAYLOAD 242
+
+/** Number of frames that can wait, max 16 */
+#ifndef UPLINK_QUEUE_SIZE
+#define UPLINK_QUEUE_SIZE 4
+#endif
+
+/** Max number of attempts of a confirmed uplink */
+#ifndef UPLINK_MAX_ATTEMPTS
+#define UPLINK_MAX_ATTEMPTS 8
+#endif
+
+/** Default max number of stored records sent in one frame */
+#ifndef STORE_DRAIN_BATCH
+#define STORE_DRAIN_BATCH 8
+#endif
+
+/** Wait time before the store is drained again after a failed uplink in milliseconds, doubled for each failure */
+#ifndef STORE_RETRY_BACKOFF
+#define STORE_RETRY_BACKOFF 30000
+#endif
+
+/** Max wait time before the store is drained again in milliseconds */
+#ifndef STORE_RETRY_BACKOFF_MAX
+#define STORE_RETRY_BACKOFF_MAX 600000
+#endif
+
+/** Default max time a reading waits in the coalescing buffer in milliseconds */
+#ifndef UPLINK_COALESCE_DELAY
+#define UPLINK_COALESCE_DELAY 300000
+#endif
+
+/** Uplink priorities, a higher priority is sent first */
+typedef enum
+{
+	UPLINK_PRIO_LOW = 0, // e.g. statistics
+	UPLINK_PRIO_NORMAL,	 // e.g. periodic telemetry
+	UPLINK_PRIO_HIGH,	 // e.g. status changes
+	UPLINK_PRIO_ALARM,	 // Alarms, can push out waiting frames of lower priority
+	UPLINK_PRIORITIES
+} uplink_priority;
+
+/** Result of an uplink */
+typedef enum
+{
+	UPLINK_OK = 0,	 // TX done, or confirmed uplink was acknowledged
+	UPLINK_FAILED,	 // Confirmed uplink was not acknowledged
+	UPLINK_TIMEOUT,	 // No TX done event within the TX done timeout
+	UPLINK_ERROR,	 // Module refused the send command, e.g. not joined
+	UPLINK_NONE = 255 // No uplink finished yet
+} uplink_result;
+
+/** Uplink frame */
+typedef struct _uplink_frame
+{
+	uint32_t queued;					// Time the frame was queued
+	uint16_t seq;						// Queue order within the priority
+	uint8_t port;						// fPort
+	uint8_t prio;						// Priority, see uplink_priority
+	uint8_t len;						// Payload length
+	uint8_t data[UPLINK_MAX_PAYLOAD];	// Payload
+} uplink_frame;
+
+/** Statistics per priority, latency is the time from queuing a frame until its uplink finished */
+typedef struct _uplink_stats
+{
+	uint32_t sent;		 // Uplinks finished with UPLINK_OK
+	uint32_t failed;	 // Uplinks finished with another result
+	uint32_t dropped;	 // Frames pushed out of the queue by a higher priority frame, stored records too long for all datarates
+	uint32_t superseded; // Frames replaced by a newer frame on the same fPort
+	uint32_t lat_min;	 // Min latency of the sent uplinks in milliseconds, 0xFFFFFFFF if nothing was sent
+	uint32_t lat_max;	 // Max latency of the sent uplinks in milliseconds
+	uint32_t lat_sum;	 // Sum of the latencies of the sent uplinks in milliseconds, mean = lat_sum / sent
+} uplink_stats;
+
+/** Retry policy for confirmed uplinks */
+typedef struct _uplink_retry
+{
+	uint8_t attempts;	  // Max attempts including the first one, 1 to UPLINK_MAX_ATTEMPTS, 1 = no retries
+	uint32_t backoff;	  // Wait time before the first retry in milliseconds, doubled for each retry
+	uint32_t backoff_max; // Max wait time before a retry in milliseconds
+	uint8_t dr_step;	  // Lower the datarate by one after this number of failed attempts, 0 = keep the datarate
+	uint8_t min_dr;		  // Lowest datarate used for retries
+} uplink_retry;
+
+/** Report of a finished frame, passed to the completion callback */
+typedef struct _uplink_report
+{
+	uint16_t seq;						  // Queue order of the frame
+	uint8_t port;						  // fPort
+	uint8_t prio;						  // Priority, see uplink_priority
+	uint8_t result;						  // Final result, see uplink_result
+	uint8_t attempts;					  // Number of attempts
+	uint8_t results[UPLINK_MAX_ATTEMPTS]; // Result of each attempt
+	uint8_t dr[UPLINK_MAX_ATTEMPTS];	  // Datarate of each attempt
+	uint32_t ack_latency;				  // Time from the start of the acknowledged attempt until the ACK in milliseconds
+} uplink_report;
+
+/** Statistics of the confirmed uplinks */
+typedef struct _uplink_ack_stats
+{
+	uint32_t acked;							 // Frames that were acknowledged
+	uint32_t lost;							 // Frames that were not acknowledged after all attempts
+	uint32_t retries;						 // Number of retries
+	uint32_t on_attempt[UPLINK_MAX_ATTEMPTS]; // Acknowledged frames per attempt, [0] = first attempt
+	uint32_t lat_min;						 // Min ACK latency in milliseconds, 0xFFFFFFFF if nothing was acknowledged
+	uint32_t lat_max;						 // Max ACK latency in milliseconds
+	uint32_t lat_sum;						 // Sum of the ACK latencies in milliseconds, mean = lat_sum / acked
+} uplink_ack_stats;
+
+/** Completion callback, called once for each frame after the last attempt */
+typedef void (*uplink_callback)(const uplink_report &report);
+
+/**
+ * @brief Duty cycle aware uplink scheduler
+ */
+class RUI3Uplink
+{
+public:
+	/**
+	 * @brief Create the scheduler
+	 *
+	 * @param rui3 RUI3 instance used to send the uplinks
+	 */
+	RUI3Uplink(RUI3 &rui3);
+
+	/**
+	 * @brief Read region, datarate, confirmed mode and join status from the module and start the duty cycle tracking
+	 *
+	 * ```cpp
+	 * bool begin(void);
+	 * ```
+	 * @return true Success
+	 * @return false No response from the module
+	 *
+	 * @par Usage
+	 * @code
+	 * RUI3 wisduo(Serial1, Serial);
+	 * RUI3Uplink uplink(wisduo);
+	 * void setup()
+	 * {
+	 * 	// ... join the network
+	 * 	uplink.begin();
+	 * }
+	 * @endcode
+	 */
+	bool begin(void);
+
+	/**
+	 * @brief Start the duty cycle tracking with a known region and datarate, the datarate of the module is set as well
+	 *
+	 * ```cpp
+	 * bool begin(uint8_t region, uint8_t dr);
+	 * ```
+	 * @param region region 0 to 12, e.g. EU868
+	 * @param dr datarate used for the time-on-air
+	 * @return true Success
+	 * @return false Invalid region, no response or error response
+	 */
+	bool begin(uint8_t region, uint8_t dr);
+
+	/**
+	 * @brief Set the datarate, the datarate of the module is changed as well
+	 *
+	 * ```cpp
+	 * bool setDataRate(uint8_t dr);
+	 * ```
+	 * @param dr datarate
+	 * @return true Success
+	 * @return false Invalid datarate, no response or error response
+	 */
+	bool setDataRate(uint8_t dr);
+
+	/**
+	 * @brief Queue an uplink, it is sent as soon as the duty cycle allows it
+	 * If the uplink is allowed and no other uplink is active, it is sent immediately.
+	 * Otherwise the frame is queued and sent from loop(), frames with higher priority first.
+	 * If the queue is full, the oldest frame with the lowest priority below prio is dropped.
+	 * An active uplink is never interrupted.
+	 *
+	 * ```cpp
+	 * bool send(uint8_t port, const uint8_t *data, uint8_t len, uint8_t prio = UPLINK_PRIO_NORMAL, bool supersede = false);
+	 * ```
+	 * @param port fPort number (1-223)
+	 * @param data payload
+	 * @param len payload length
+	 * @param prio priority, see uplink_priority
+	 * @param supersede true to replace a waiting frame with the same fPort and priority, e.g. for telemetry where only the latest values count
+	 * @return true Uplink was sent, is queued or was appended to the store
+	 * @return false Queue is full or the payload is too long for the datarate or the store
+	 *
+	 * @par Usage
+	 * @code
+	 * uint8_t payload[] = {0x01, 0x74, 0x01, 0x6e};
+	 * uplink.send(1, payload, sizeof(payload), UPLINK_PRIO_NORMAL, true); // Telemetry, keep only the latest
+	 * uint8_t alarm[] = {0x01};
+	 * uplink.send(2, alarm, sizeof(alarm), UPLINK_PRIO_ALARM);
+	 * @endcode
+	 */
+	bool send(uint8_t port, const uint8_t *data, uint8_t len, uint8_t prio = UPLINK_PRIO_NORMAL, bool supersede = false);
+
+	/**
+	 * @brief Set a persistent store for uplinks that cannot be sent
+	 * While the module is not joined, send() appends the frames to the store. Frames that fail after all attempts
+	 * are appended to the store as well. After +EVT:JOINED the store is drained when no other frame is queued,
+	 * up to batch records with the same fPort are sent in one frame, within the max payload of the datarate.
+	 * Records are removed from the store only after their uplink succeeded. After a failed uplink the store is drained
+	 * again after STORE_RETRY_BACKOFF, doubled for each failure up to STORE_RETRY_BACKOFF_MAX.
+	 * A record longer than the max payload of the datarate is sent alone with the slowest datarate it fits into,
+	 * a record too long for all datarates is removed and counted in stats(UPLINK_PRIO_LOW).dropped.
+	 *
+	 * ```cpp
+	 * void setStore(RUI3Store *store, uint8_t batch = STORE_DRAIN_BATCH);
+	 * ```
+	 * @param store persistent FIFO, begin() has to be called before, NULL to remove
+	 * @param batch max number of records in one frame
+	 *
+	 * @par Usage
+	 * @code
+	 * uint8_t store_buffer[4096];
+	 * RUI3StoreRAM store_ram(store_buffer, sizeof(store_buffer));
+	 * RUI3Store store(store_ram);
+	 * void setup()
+	 * {
+	 * 	store.begin();
+	 * 	uplink.begin();
+	 * 	uplink.setStore(&store);
+	 * }
+	 * @endcode
+	 */
+	void setStore(RUI3Store *store, uint8_t batch = STORE_DRAIN_BATCH);
+
+	/**
+	 * @brief Set the downlink dispatch table
+	 * With a dispatch table, loop() reads all events of the module, also while no uplink is active,
+	 * and passes the downlinks to the handlers of their fPort
+	 *
+	 * ```cpp
+	 * void setDownlink(RUI3Downlink *downlink);
+	 * ```
+	 * @param downlink dispatch table, NULL to remove
+	 *
+	 * @par Usage
+	 * @code
+	 * RUI3Downlink downlink;
+	 * void setup()
+	 * {
+	 * 	downlink.on(10, config_handler);
+	 * 	downlink.on(20, command_handler);
+	 * 	uplink.setDownlink(&downlink);
+	 * }
+	 * @endcode
+	 */
+	void setDownlink(RUI3Downlink *downlink);
+
+	/**
+	 * @brief Set the join status, e.g. if the sketch handles the join events itself
+	 * The status is also updated from +EVT:JOINED while uplinks wait in the store and from AT_NO_NETWORK_JOINED
+	 *
+	 * ```cpp
+	 * void setJoined(bool joined);
+	 * ```
+	 * @param joined true if the module is joined
+	 */
+	void setJoined(bool joined);
+
+	/**
+	 * @brief Set confirmed or unconfirmed uplinks, the mode of the module is changed as well
+	 * Confirmed uplinks finish with +EVT:SEND_CONFIRMED_OK or +EVT:SEND_CONFIRMED_FAILED, failed uplinks are
+	 * repeated by the retry policy.
+	 *
+	 * ```cpp
+	 * bool setConfirmed(bool confirmed);
+	 * ```
+	 * @param confirmed true for confirmed uplinks
+	 * @return true Success
+	 * @return false No response or error response
+	 */
+	bool setConfirmed(bool confirmed);
+
+	/**
+	 * @brief Set the retry policy for confirmed uplinks
+	 * A retry is sent after the backoff time (plus a random jitter of up to 50%) and when the duty cycle allows it.
+	 * During the backoff one frame with a higher priority can be sent, e.g. an alarm, the retries continue after it
+	 * finished. Other frames wait until the retries of the active frame are finished.
+	 * The datarate is restored after the last attempt.
+	 * The module can repeat confirmed uplinks itself (AT+RETY) before it reports +EVT:SEND_CONFIRMED_FAILED,
+	 * these repeats are not seen by the retry policy.
+	 *
+	 * ```cpp
+	 * void setRetry(const uplink_retry &retry);
+	 * ```
+	 * @param retry retry policy, default 1 attempt
+	 *
+	 * @par Usage
+	 * @code
+	 * uplink_retry retry = {4, 5000, 60000, 2, 0}; // 4 attempts, 5 s to 60 s backoff, lower the DR after 2 failures
+	 * uplink.setRetry(retry);
+	 * @endcode
+	 */
+	void setRetry(const uplink_retry &retry);
+
+	/**
+	 * @brief Set the completion callback
+	 * The callback is called from loop() once for each frame, after it was acknowledged or after the last attempt
+	 *
+	 * ```cpp
+	 * void setCallback(uplink_callback callback);
+	 * ```
+	 * @param callback completion callback, NULL to remove
+	 *
+	 * @par Usage
+	 * @code
+	 * void uplink_done(const uplink_report &report)
+	 * {
+	 * 	Serial.printf("Frame %d result %d after %d attempts\r\n", report.seq, report.result, report.attempts);
+	 * }
+	 *
+	 * uplink.setCallback(uplink_done);
+	 * @endcode
+	 */
+	void setCallback(uplink_callback callback);
+
+	/**
+	 * @brief Add a reading to the coalescing buffer
+	 * Readings for the same fPort are collected into one frame. The frame is queued with send() when
+	 * - the next reading does not fit into the max payload of the datarate
+	 * - the max delay of one of the readings is reached
+	 * - a reading for another fPort is added
+	 * - flush() is called
+	 * The readings are concatenated without separator, the decoder must be able to split them,
+	 * e.g. fixed size readings or Cayenne LPP.
+	 *
+	 * ```cpp
+	 * bool add(uint8_t port, const uint8_t *data, uint8_t len, uint32_t max_delay = UPLINK_COALESCE_DELAY, uint8_t prio = UPLINK_PRIO_NORMAL);
+	 * ```
+	 * @param port fPort number (1-223)
+	 * @param data reading
+	 * @param len reading length
+	 * @param max_delay max time in milliseconds until the reading is queued
+	 * @param prio priority of the frame, see uplink_priority
+	 * @return true Reading was added
+	 * @return false Reading is too long for the datarate or the collected frame could not be queued
+	 *
+	 * @par Usage
+	 * @code
+	 * uint8_t reading[] = {0x01, 0x67, 0x01, 0x1a}; // Cayenne LPP temperature
+	 * uplink.add(1, reading, sizeof(reading), 600000); // Send within 10 minutes
+	 * @endcode
+	 */
+	bool add(uint8_t port, const uint8_t *data, uint8_t len, uint32_t max_delay = UPLINK_COALESCE_DELAY, uint8_t prio = UPLINK_PRIO_NORMAL);
+
+	/**
+	 * @brief Queue the collected readings now
+	 *
+	 * ```cpp
+	 * bool flush(void);
+	 * ```
+	 * @return true Frame was queued or the coalescing buffer is empty
+	 * @return false Frame could not be queued, it is tried again from loop()
+	 */
+	bool flush(void);
+
+	/**
+	 * @brief Get the time until an uplink is allowed by the duty cycle
+	 *
+	 * ```cpp
+	 * uint32_t nextUplink(uint8_t len);
+	 * ```
+	 * @param len payload length
+	 * @return uint32_t wait time in milliseconds, 0 if the uplink is allowed now, DUTY_NEVER if it is not possible at all
+	 */
+	uint32_t nextUplink(uint8_t len);
+
+	/**
+	 * @brief Handle the uplinks, must be called frequently from the loop()
+	 * Does not block, except for the send command itself
+	 *
+	 * ```cpp
+	 * void loop(void);
+	 * ```
+	 */
+	void loop(void);
+
+	/**
+	 * @brief Get the number of waiting frames
+	 *
+	 * ```cpp
+	 * uint8_t queued(void);
+	 * ```
+	 * @return uint8_t number of frames in the queue
+	 */
+	uint8_t queued(void);
+
+	/**
+	 * @brief Get the statistics of a priority
+	 *
+	 * ```cpp
+	 * const uplink_stats &stats(uint8_t prio);
+	 * ```
+	 * @param prio priority, see uplink_priority
+	 * @return const uplink_stats& statistics
+	 *
+	 * @par Usage
+	 * @code
+	 * const uplink_stats &alarms = uplink.stats(UPLINK_PRIO_ALARM);
+	 * if (alarms.sent != 0)
+	 * {
+	 * 	Serial.printf("Alarm latency min %ld mean %ld max %ld ms\r\n", alarms.lat_min, alarms.lat_sum / alarms.sent, alarms.lat_max);
+	 * }
+	 * @endcode
+	 */
+	const uplink_stats &stats(uint8_t prio);
+
+	/**
+	 * @brief Reset the statistics of all priorities and of the confirmed uplinks
+	 *
+	 * ```cpp
+	 * void resetStats(void);
+	 * ```
+	 */
+	void resetStats(void);
+
+	/**
+	 * @brief Get the statistics of the confirmed uplinks
+	 *
+	 * ```cpp
+	 * const uplink_ack_stats &ackStats(void);
+	 * ```
+	 * @return const uplink_ack_stats& statistics
+	 */
+	const uplink_ack_stats &ackStats(void);
+
+	/**
+	 * @brief Check if an uplink is active or waiting
+	 * Readings in the coalescing buffer are not included, see collected()
+	 *
+	 * ```cpp
+	 * bool busy(void);
+	 * ```
+	 * @return true An uplink is active or waiting for the duty cycle or a retry
+	 * @return false Idle
+	 */
+	bool busy(void);
+
+	/**
+	 * @brief Get the number of readings waiting in the coalescing buffer
+	 *
+	 * ```cpp
+	 * uint8_t collected(void);
+	 * ```
+	 * @return uint8_t number of readings
+	 */
+	uint8_t collected(void);
+
+	/**
+	 * @brief Get the result of the last finished uplink
+	 *
+	 * ```cpp
+	 * uint8_t lastResult(void);
+	 * ```
+	 * @return uint8_t see uplink_result
+	 */
+	uint8_t lastResult(void);
+
+	/**
+	 * @brief Get the report of the last finished frame
+	 *
+	 * ```cpp
+	 * const uplink_report &lastReport(void);
+	 * ```
+	 * @return const uplink_report& report, result is UPLINK_NONE if no frame finished yet
+	 */
+	const uplink_report &lastReport(void);
+
+	/** Duty cycle tracker, e.g. to change the window */
+	RUI3DutyCycle duty;
+
+private:
+	/**
+	 * @brief Get the next frame to send
+	 *
+	 * @return int8_t index into _queue, -1 if the queue is empty
+	 */
+	int8_t nextFrame(void);
+
+	/**
+	 * @brief Take a frame from the queue and send its first attempt
+	 *
+	 * @param idx index into _queue
+	 */
+	void start(uint8_t idx);
+
+	/**
+	 * @brief Send an attempt of the active frame
+	 *
+	 * @param idx index into _queue
+	 */
+	void transmit(uint8_t idx);
+
+	/**
+	 * @brief End the active attempt, schedule a retry if the policy allows it
+	 *
+	 * @param result see uplink_result
+	 */
+	void finish(uint8_t result);
+
+	/**
+	 * @brief End the active frame, update the statistics and call the completion callback
+	 *
+	 * @param result see uplink_result
+	 */
+	void complete(uint8_t result);
+
+	/**
+	 * @brief Put the active frame aside while it waits for a retry, a frame with a higher priority is sent in between
+	 */
+	void park(void);
+
+	/**
+	 * @brief Continue with the retries of the parked frame
+	 */
+	void resume(void);
+
+	/**
+	 * @brief Queue the oldest stored records as one frame
+	 */
+	void loadStore(void);
+
+	/**
+	 * @brief Find the slowest datarate faster than the current one for a payload
+	 *
+	 * @param len payload length
+	 * @return uint8_t datarate, NO_RESPONSE if the payload does not fit into any LoRa datarate
+	 */
+	uint8_t fitDataRate(uint8_t len);
+
+	RUI3 &_rui3;
+
+	/** Region of the module */
+	uint8_t _region = NO_RESPONSE;
+
+	/** Datarate used for the time-on-air */
+	uint8_t _dr = 0;
+
+	/** Frames waiting for the duty cycle or the active uplink */
+	uplink_frame _queue[UPLINK_QUEUE_SIZE];
+
+	/** Used entries of _queue, bit 0 = _queue[0] */
+	uint16_t _used = 0;
+
+	/** Statistics per priority */
+	uplink_stats _stats[UPLINK_PRIORITIES];
+
+	/** Sequence number of the next queued frame */
+	uint16_t _seq = 0;
+
+	/** Priority of the active uplink */
+	uint8_t _tx_prio = 0;
+
+	/** Queue time of the active uplink */
+	uint32_t _tx_queued = 0;
+
+	/** True while the module sends the uplink */
+	bool _tx_active = false;
+
+	/** Start time of the active uplink */
+	uint32_t _tx_start = 0;
+
+	/** TX done timeout of the active uplink */
+	uint32_t _tx_timeout = 0;
+
+	/** Slot of the active frame kept for retries, -1 if none */
+	int8_t _tx_slot = -1;
+
+	/** True if uplinks are confirmed */
+	bool _confirmed = false;
+
+	/** Retry policy of confirmed uplinks */
+	uplink_retry _retry = {1, 0, 0, 0, 0};
+
+	/** True while a retry waits for the backoff time */
+	bool _retry_wait = false;
+
+	/** Time of the next retry */
+	uint32_t _retry_at = 0;
+
+	/** Datarate of the first attempt, restored after the last attempt */
+	uint8_t _dr_first = 0;
+
+	/** Slot of the frame parked during its retry backoff, -1 if none */
+	int8_t _park_slot = -1;
+
+	/** Priority of the parked frame */
+	uint8_t _park_prio = 0;
+
+	/** Queue time of the parked frame */
+	uint32_t _park_queued = 0;
+
+	/** Time of the next retry of the parked frame */
+	uint32_t _park_at = 0;
+
+	/** Datarate of the next retry of the parked frame */
+	uint8_t _park_dr = 0;
+
+	/** Report of the parked frame */
+	uplink_report _park_report;
+
+	/** Report of the active or the last finished frame */
+	uplink_report _report;
+
+	/** Statistics of the confirmed uplinks */
+	uplink_ack_stats _ack;
+
+	/** Completion callback */
+	uplink_callback _callback = NULL;
+
+	/** Persistent store, NULL if not used */
+	RUI3Store *_store = NULL;
+
+	/** Max number of stored records in one frame */
+	uint8_t _store_batch = STORE_DRAIN_BATCH;
+
+	/** Slot of the frame loaded from the store, -1 if none */
+	int8_t _store_slot = -1;
+
+	/** Number of stored records in the frame of _store_slot */
+	uint8_t _store_num = 0;
+
+	/** Datarate of the frame of _store_slot */
+	uint8_t _store_dr = 0;
+
+	/** Failed uplinks in a row while the store is used */
+	uint8_t _store_fails = 0;
+
+	/** Time when the store is drained again after a failed uplink */
+	uint32_t _store_at = 0;
+
+	/** Downlink dispatch table, NULL if not used */
+	RUI3Downlink *_downlink = NULL;
+
+	/** True if the module is joined */
+	bool _joined = true;
+
+	/** Readings collected for one frame */
+	uplink_frame _batch;
+
+	/** Number of readings in _batch, 0 = empty */
+	uint8_t _batch_num = 0;
+
+	/** Time when _batch has to be queued */
+	uint32_t _batch_deadline = 0;
+
+	/** Result of the last uplink */
+	uint8_t _result = UPLINK_NONE;
+};
+
+#endif // _RUI3_UPLINK_H_